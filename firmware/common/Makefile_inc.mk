@@ -40,6 +40,13 @@ HACKRF_OPTS = -D$(BOARD) -DLPC43XX -D$(MCU_PARTNO)
 # comment to disable RF transmission
 HACKRF_OPTS += -DTX_ENABLE
 
+# set to 1 (make -e PERF_COUNTERS=1) for DWT cycle counting in the
+# streaming ISRs, as read by hackrf_perf; it adds to the SGPIO ISR
+PERF_COUNTERS ?= 0
+ifeq ($(PERF_COUNTERS),1)
+	HACKRF_OPTS += -DPERF_COUNTERS
+endif
+
 # automatic git version when working out of git
 VERSION_STRING ?= -D'VERSION_STRING="git-$(shell git log -n 1 --format=%h)"'
 HACKRF_OPTS += $(VERSION_STRING)
@@ -70,6 +77,11 @@ OBJ_M0_S = $(patsubst %.s, $(OBJDIR_M0)/%.o, $(notdir $(SRC_M0_S)))
 LDSCRIPT_M4 += -T$(PATH_HACKRF_FIRMWARE_COMMON)/$(MCU_PARTNO)_M4_memory.ld
 ifeq ($(RUN_FROM),RAM)
 	LDSCRIPT_M4 += -Tlibopencm3_lpc43xx.ld
+else ifeq ($(RUN_FROM),XIP)
+	# execute in place from SPIFI, with RAMFUNC code copied to SRAM
+	LDSCRIPT_M4 += -Tlibopencm3_lpc43xx.ld
+	LDSCRIPT_M4 += -T$(PATH_HACKRF_FIRMWARE_COMMON)/LPC43xx_M4_ramfunc.ld
+	HACKRF_OPTS += -DRAMFUNC_ENABLE
 else
 	LDSCRIPT_M4 += -Tlibopencm3_lpc43xx_rom_to_ram.ld
 endif
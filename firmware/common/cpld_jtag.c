@@ -68,6 +68,7 @@ int cpld_jtag_program(
 	cpld_jtag_setup();
 	xsvf_buffer = buffer;
 	xsvf_buffer_len = buffer_length;
+	xsvf_pos = 0;
         refill_buffer = refill;
 	error = xsvfExecute();
 	cpld_jtag_release();
@@ -77,8 +78,8 @@ int cpld_jtag_program(
 
 /* this gets called by the XAPP058 code */
 unsigned char cpld_jtag_get_next_byte(void) {
-        if (xsvf_pos == xsvf_buffer_len) {
-                refill_buffer();
+        while (xsvf_pos == xsvf_buffer_len) {
+                xsvf_buffer_len = refill_buffer(&xsvf_buffer);
                 xsvf_pos = 0;
         }
 
@@ -24,7 +24,8 @@
 
 #include <stdint.h>
 
-typedef void (*refill_buffer_cb)(void);
+/* Points *buffer at the next block of XSVF data and returns its length. */
+typedef uint32_t (*refill_buffer_cb)(unsigned char** const buffer);
 
 void cpld_jtag_release(void);
 
@@ -32,7 +33,9 @@ void cpld_jtag_release(void);
  *
  * We expect the buffer to be initially full of data. After the entire
  * contents of the buffer has been streamed to the CPLD the given
- * refill_buffer callback will be called. */
+ * refill_buffer callback will be called for the next block, which need not
+ * be in the same buffer, so the caller can fill one while this plays the
+ * other. */
 int cpld_jtag_program(
         const uint32_t buffer_length,
         unsigned char* const buffer,
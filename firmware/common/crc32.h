@@ -0,0 +1,34 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <stdint.h>
+
+/* CRC-32 as used by zlib and Ethernet (reflected, polynomial 0xEDB88320).
+ * Start with crc = 0 and feed the previous result back in to checksum data
+ * in pieces.
+ */
+uint32_t crc32(uint32_t crc, const uint8_t* const data, const uint32_t len);
+
+#endif/*__CRC32_H__*/
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "event_log.h"
+#include "ramfunc.h"
+
+#include <libopencm3/cm3/scs.h>
+
+static volatile bool event_log_frozen = false;
+
+void event_log_init(void) {
+	SCS_DEMCR |= SCS_DEMCR_TRCENA;
+	SCS_DWT_CTRL |= SCS_DWT_CTRL_CYCCNTENA;
+
+	if( event_log.magic == EVENT_LOG_MAGIC ) {
+		event_log.boots++;
+	} else {
+		event_log.index = 0;
+		event_log.dropped = 0;
+		event_log.boots = 0;
+		event_log.magic = EVENT_LOG_MAGIC;
+	}
+	event_log_frozen = false;
+	event_log_write(EVENT_BOOT, event_log.boots, 0);
+}
+
+/* Callable from any context, including from ISRs that preempt each other, so
+ * the slot is claimed and filled with interrupts masked. That is a dozen or
+ * so cycles; PRIMASK is restored rather than blindly re-enabled so callers
+ * that already run with interrupts disabled stay that way.
+ */
+RAMFUNC void event_log_write(const event_log_id_t id, const uint32_t arg0, const uint32_t arg1) {
+	uint32_t primask;
+
+	__asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r" (primask) : : "memory");
+	if( event_log_frozen ) {
+		event_log.dropped++;
+	} else {
+		volatile event_log_entry_t* const entry =
+			&event_log.entries[event_log.index & (EVENT_LOG_LENGTH - 1)];
+		entry->timestamp = SCS_DWT_CYCCNT;
+		entry->id = id;
+		entry->arg[0] = arg0;
+		entry->arg[1] = arg1;
+		event_log.index++;
+	}
+	__asm__ volatile("msr primask, %0" : : "r" (primask) : "memory");
+}
+
+/* While frozen, new events are counted in dropped instead of being written,
+ * so the ring can be sent to the host straight from SRAM without tearing.
+ */
+void event_log_freeze(const bool freeze) {
+	event_log_frozen = freeze;
+}
+
+void event_log_clear(void) {
+	uint32_t primask;
+
+	__asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r" (primask) : : "memory");
+	event_log.index = 0;
+	event_log.dropped = 0;
+	__asm__ volatile("msr primask, %0" : : "r" (primask) : "memory");
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Binary event ring for correlating stream glitches with what the firmware
+ * was doing. Entries are timestamped with the DWT cycle counter, which wraps
+ * every 2^32 CPU cycles (about 21 seconds at 204MHz) and stops while the
+ * core sleeps in WFI.
+ *
+ * The ring sits at a fixed address set in the ldscripts and is not cleared
+ * at startup, so entries logged just before a fault survive a warm reset.
+ */
+
+#define EVENT_LOG_MAGIC (0x474f4c45) /* "ELOG" */
+#define EVENT_LOG_LENGTH (256) /* entries, power of two */
+
+typedef enum {
+	EVENT_BOOT = 1,               /* arg0: boots since the log was created */
+	EVENT_FAULT = 2,              /* arg0: fault, arg1: faulting PC if known */
+	EVENT_USB_BUS_RESET = 3,
+	EVENT_USB_CONFIGURATION = 4,  /* arg0: configuration number */
+	EVENT_USB_TRANSFER_ERROR = 5, /* arg0: endpoint address, arg1: dTD token */
+	EVENT_USB_QUEUE_EXHAUSTED = 6,/* arg0: endpoint address */
+	EVENT_USB_QUEUE_MISSING = 7,  /* arg0: endpoint address */
+	EVENT_TRANSCEIVER_MODE = 8,   /* arg0: transceiver_mode_t */
+	EVENT_SET_FREQ = 9,           /* arg0: MHz, arg1: Hz */
+	EVENT_SET_FREQ_EXPLICIT = 10, /* arg0: IF kHz, arg1: LO kHz */
+	EVENT_SAMPLE_RATE = 11,       /* arg0: Hz, arg1: divider */
+	EVENT_BASEBAND_FILTER = 12,   /* arg0: Hz */
+	EVENT_GAIN = 13,              /* arg0: event_gain_stage_t, arg1: dB */
+	EVENT_SGPIO_OVERRUN = 14,     /* arg0: usb_bulk_buffer offset */
+} event_log_id_t;
+
+typedef enum {
+	EVENT_FAULT_HARD = 0,
+	EVENT_FAULT_MEM_MANAGE = 1,
+	EVENT_FAULT_BUS = 2,
+	EVENT_FAULT_USAGE = 3,
+} event_fault_t;
+
+typedef enum {
+	EVENT_GAIN_LNA = 0,
+	EVENT_GAIN_VGA = 1,
+	EVENT_GAIN_TXVGA = 2,
+} event_gain_stage_t;
+
+typedef struct {
+	uint32_t timestamp;
+	uint32_t id;
+	uint32_t arg[2];
+} event_log_entry_t;
+
+/* Read out over USB as is, so the layout is shared with libhackrf. */
+typedef struct {
+	uint32_t magic;
+	uint32_t index;   /* events written; the next goes to index % EVENT_LOG_LENGTH */
+	uint32_t dropped; /* events discarded while the log was being read out */
+	uint32_t boots;
+	event_log_entry_t entries[EVENT_LOG_LENGTH];
+} event_log_t;
+
+/* Address of event_log is set in ldscripts. */
+extern volatile event_log_t event_log;
+
+void event_log_init(void);
+void event_log_write(const event_log_id_t id, const uint32_t arg0, const uint32_t arg1);
+void event_log_freeze(const bool freeze);
+void event_log_clear(void);
+
+#endif/*__EVENT_LOG_H__*/
@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 #include "fault_handler.h"
+#include "event_log.h"
 
 typedef struct
 {
@@ -70,17 +71,21 @@ __attribute__((used)) void hard_fault_handler_c(uint32_t* args)
 		}
 	}
 	*/
+	event_log_write(EVENT_FAULT, EVENT_FAULT_HARD, hard_fault_stack_pt->pc);
 	while(1);
 }
 
 void mem_manage_handler() {
+	event_log_write(EVENT_FAULT, EVENT_FAULT_MEM_MANAGE, 0);
 	while(1);
 }
 
 void bus_fault_handler() {
+	event_log_write(EVENT_FAULT, EVENT_FAULT_BUS, 0);
 	while(1);
 }
 
 void usage_fault_handler() {
+	event_log_write(EVENT_FAULT, EVENT_FAULT_USAGE, 0);
 	while(1);
 }
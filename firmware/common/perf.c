@@ -0,0 +1,82 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "perf.h"
+
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+volatile perf_stats_t perf_stats;
+
+#ifdef PERF_COUNTERS
+
+static uint32_t perf_start;
+
+static void perf_counter_clear(volatile perf_counter_t* const counter) {
+	counter->count = 0;
+	counter->min = 0xffffffff;
+	counter->max = 0;
+	counter->total = 0;
+}
+
+void perf_init(void) {
+	SCS_DEMCR |= SCS_DEMCR_TRCENA;
+	SCS_DWT_CTRL |= SCS_DWT_CTRL_CYCCNTENA;
+	perf_clear();
+}
+
+void perf_clear(void) {
+	cm_disable_interrupts();
+	perf_counter_clear(&perf_stats.sgpio_isr);
+	perf_counter_clear(&perf_stats.usb_isr);
+	perf_counter_clear(&perf_stats.main_loop);
+	perf_counter_clear(&perf_stats.slack);
+	perf_counter_clear(&perf_stats.latency);
+	perf_stats.overruns = 0;
+	perf_stats.sleeps = 0;
+	perf_start = perf_cycles();
+	cm_enable_interrupts();
+}
+
+void perf_snapshot(perf_stats_t* const snapshot) {
+	/* The SGPIO ISR preempts the USB ISR this runs from, so hold it off for
+	 * the few cycles the copy takes to keep the snapshot consistent.
+	 */
+	cm_disable_interrupts();
+	memcpy(snapshot, (const void*)&perf_stats, sizeof(*snapshot));
+	snapshot->cycles = perf_cycles() - perf_start;
+	cm_enable_interrupts();
+}
+
+#else
+
+void perf_init(void) {
+}
+
+void perf_clear(void) {
+}
+
+void perf_snapshot(perf_stats_t* const snapshot) {
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+#endif
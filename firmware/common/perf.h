@@ -0,0 +1,111 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#include <stdint.h>
+
+#include <libopencm3/cm3/scs.h>
+
+/* Cycle counts are taken from the Cortex-M4 DWT cycle counter, so a window
+ * between perf_clear() calls must stay shorter than 2^32 CPU cycles (about
+ * 21 seconds at 204MHz). The counter stops while the core sleeps in WFI, so
+ * cycles is awake time; compare it against wall time for the sleep share.
+ */
+
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t total;
+} perf_counter_t;
+
+typedef struct {
+	uint32_t cycles;
+	perf_counter_t sgpio_isr;
+	perf_counter_t usb_isr;
+	perf_counter_t main_loop;
+	perf_counter_t slack;
+	uint32_t overruns;
+	uint32_t sleeps;
+	perf_counter_t latency;
+} perf_stats_t;
+
+extern volatile perf_stats_t perf_stats;
+
+#ifdef PERF_COUNTERS
+
+static inline uint32_t perf_cycles(void) {
+	return SCS_DWT_CYCCNT;
+}
+
+static inline void perf_counter_update(volatile perf_counter_t* const counter, const uint32_t value) {
+	counter->count++;
+	counter->total += value;
+	if( value < counter->min ) {
+		counter->min = value;
+	}
+	if( value > counter->max ) {
+		counter->max = value;
+	}
+}
+
+static inline void perf_overrun(void) {
+	perf_stats.overruns++;
+}
+
+static inline void perf_sleep(void) {
+	perf_stats.sleeps++;
+}
+
+static inline void perf_timestamp(volatile uint32_t* const timestamp) {
+	*timestamp = perf_cycles();
+}
+
+#else
+
+static inline uint32_t perf_cycles(void) {
+	return 0;
+}
+
+static inline void perf_counter_update(volatile perf_counter_t* const counter, const uint32_t value) {
+	(void)counter;
+	(void)value;
+}
+
+static inline void perf_overrun(void) {
+}
+
+static inline void perf_sleep(void) {
+}
+
+static inline void perf_timestamp(volatile uint32_t* const timestamp) {
+	(void)timestamp;
+}
+
+#endif
+
+void perf_init(void);
+void perf_clear(void);
+void perf_snapshot(perf_stats_t* const snapshot);
+
+#endif/*__PERF_H__*/
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "ramfunc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <libopencm3/cm3/scb.h>
+
+#ifdef RAMFUNC_ENABLE
+
+/* Defined in LPC43xx_M4_ramfunc.ld */
+extern uint32_t _ramfunc_loadaddr;
+extern uint32_t _ramfunc_start;
+extern uint32_t _ramfunc_end;
+
+/* VTOR needs the table aligned to its size rounded up to a power of two. */
+vector_table_t ram_vector_table __attribute__((aligned(512)));
+
+void ramfunc_init(void) {
+	const uint32_t* src = &_ramfunc_loadaddr;
+	uint32_t* dst;
+
+	for( dst = &_ramfunc_start; dst < &_ramfunc_end; dst++, src++ ) {
+		*dst = *src;
+	}
+
+	memcpy(&ram_vector_table, &vector_table, sizeof(ram_vector_table));
+	__asm__ volatile("dsb");
+	SCB_VTOR = (uint32_t)&ram_vector_table;
+	__asm__ volatile("dsb\n\tisb");
+}
+
+#else
+
+void ramfunc_init(void) {
+}
+
+#endif
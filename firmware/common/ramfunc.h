@@ -0,0 +1,56 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __RAMFUNC_H__
+#define __RAMFUNC_H__
+
+#include <libopencm3/cm3/vector.h>
+
+/* Code that runs on the sample streaming path (SGPIO and USB ISRs, the USB
+ * queue and the main loop that feeds it) is tagged RAMFUNC.
+ *
+ * The usual images already copy all of .text to SRAM at startup, so RAMFUNC
+ * does nothing there. An image built with RUN_FROM=XIP executes in place
+ * from SPIFI, where anything larger than the ~256 byte SPIFI cache runs at a
+ * few MIPS; there RAMFUNC code is linked into the .ramfunc section, which
+ * ramfunc_init() copies to local SRAM together with the vector table.
+ */
+
+#ifdef RAMFUNC_ENABLE
+
+#define RAMFUNC __attribute__((section(".ramfunc")))
+
+/* The vector table in use, writable at run time in every build. */
+extern vector_table_t ram_vector_table;
+#define RAM_VECTOR_TABLE ram_vector_table
+
+#else
+
+#define RAMFUNC
+#define RAM_VECTOR_TABLE vector_table
+
+#endif
+
+/* Must run first thing in main(), before any RAMFUNC code or interrupt. */
+void ramfunc_init(void);
+
+#endif/*__RAMFUNC_H__*/
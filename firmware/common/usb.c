@@ -26,6 +26,9 @@
 #include "usb_type.h"
 #include "usb_queue.h"
 #include "usb_standard_request.h"
+#include "perf.h"
+#include "event_log.h"
+#include "ramfunc.h"
 
 #include <libopencm3/lpc43xx/creg.h>
 #include <libopencm3/lpc43xx/m4/nvic.h>
@@ -38,19 +41,19 @@ usb_queue_head_t usb_qh[12] ATTR_ALIGNED(2048);
 
 #define USB_QH_INDEX(endpoint_address) (((endpoint_address & 0xF) * 2) + ((endpoint_address >> 7) & 1))
 
-usb_queue_head_t* usb_queue_head(
+RAMFUNC usb_queue_head_t* usb_queue_head(
 	const uint_fast8_t endpoint_address
 ) {
 	return &usb_qh[USB_QH_INDEX(endpoint_address)];
 }
 
-static usb_endpoint_t* usb_endpoint_from_address(
+RAMFUNC static usb_endpoint_t* usb_endpoint_from_address(
 	const uint_fast8_t endpoint_address
 ) {
 	return (usb_endpoint_t*)usb_queue_head(endpoint_address)->_reserved_0;
 }
 
-static uint_fast8_t usb_endpoint_address(
+RAMFUNC static uint_fast8_t usb_endpoint_address(
 	const usb_transfer_direction_t direction,
 	const uint_fast8_t number
 ) {
@@ -169,7 +172,7 @@ void usb_endpoint_disable(
 	usb_endpoint_flush(endpoint);
 }
 
-void usb_endpoint_prime(
+RAMFUNC void usb_endpoint_prime(
 	const usb_endpoint_t* const endpoint,
 	usb_transfer_descriptor_t* const first_td	
 ) {
@@ -190,7 +193,7 @@ void usb_endpoint_prime(
 	}
 }
 
-static bool usb_endpoint_is_priming(
+RAMFUNC static bool usb_endpoint_is_priming(
 	const usb_endpoint_t* const endpoint
 ) {
 	const uint_fast8_t endpoint_number = usb_endpoint_number(endpoint->address);
@@ -201,9 +204,11 @@ static bool usb_endpoint_is_priming(
 	}
 }
 
-// Schedule an already filled-in transfer descriptor for execution on
-// the given endpoint, waiting until the endpoint has finished.
-void usb_endpoint_schedule_wait(
+// Schedule an already filled-in transfer descriptor (or chain of them)
+// for execution on the given endpoint, waiting until the endpoint has
+// finished. The user is responsible for setting the TERMINATE bit of the
+// last next_dtd_pointer.
+RAMFUNC void usb_endpoint_schedule_wait(
 	const usb_endpoint_t* const endpoint,
 	usb_transfer_descriptor_t* const td
 ) {
@@ -212,8 +217,6 @@ void usb_endpoint_schedule_wait(
 	// TODO: This should be preceded by a flush?
 	while( usb_endpoint_is_ready(endpoint) );
 
-	td->next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
-
 	usb_endpoint_prime(endpoint, td);
 }
 
@@ -222,7 +225,7 @@ void usb_endpoint_schedule_wait(
 // there are pending TDs. Note that this requires that one knows the
 // tail of the endpoint's TD queue. Moreover, the user is responsible
 // for setting the TERMINATE bit of next_dtd_pointer if needed.
-void usb_endpoint_schedule_append(
+RAMFUNC void usb_endpoint_schedule_append(
 	const usb_endpoint_t* const endpoint,
 	usb_transfer_descriptor_t* const tail_td,
 	usb_transfer_descriptor_t* const new_td
@@ -346,11 +349,11 @@ usb_speed_t usb_speed(
 	}
 }
 
-static void usb_clear_status(const uint32_t status) {
+RAMFUNC static void usb_clear_status(const uint32_t status) {
 	USB0_USBSTS_D = status;
 }
 
-static uint32_t usb_get_status() {
+RAMFUNC static uint32_t usb_get_status() {
     // Mask status flags with enabled flag interrupts.
 	const uint32_t status = USB0_USBSTS_D & USB0_USBINTR_D;
 
@@ -362,19 +365,19 @@ static uint32_t usb_get_status() {
 	return status;
 }
 
-static void usb_clear_endpoint_setup_status(const uint32_t endpoint_setup_status) {
+RAMFUNC static void usb_clear_endpoint_setup_status(const uint32_t endpoint_setup_status) {
 	USB0_ENDPTSETUPSTAT = endpoint_setup_status;
 }
 
-static uint32_t usb_get_endpoint_setup_status() {
+RAMFUNC static uint32_t usb_get_endpoint_setup_status() {
  	return USB0_ENDPTSETUPSTAT;
 }
 
-static void usb_clear_endpoint_complete(const uint32_t endpoint_complete) {
+RAMFUNC static void usb_clear_endpoint_complete(const uint32_t endpoint_complete) {
 	USB0_ENDPTCOMPLETE = endpoint_complete;
 }
 
-static uint32_t usb_get_endpoint_complete() {
+RAMFUNC static uint32_t usb_get_endpoint_complete() {
 	return USB0_ENDPTCOMPLETE;
 }
 
@@ -550,7 +553,7 @@ void usb_endpoint_init(
 	usb_endpoint_enable(endpoint);
 }
 
-static void usb_check_for_setup_events() {
+RAMFUNC static void usb_check_for_setup_events() {
 	const uint32_t endptsetupstat = usb_get_endpoint_setup_status();
 	if( endptsetupstat ) {
 		for( uint_fast8_t i=0; i<6; i++ ) {
@@ -575,7 +578,7 @@ static void usb_check_for_setup_events() {
 	}
 }
 
-static void usb_check_for_transfer_events() {	
+RAMFUNC static void usb_check_for_transfer_events() {	
 	const uint32_t endptcomplete = usb_get_endpoint_complete();
 	if( endptcomplete ) {
 		for( uint_fast8_t i=0; i<6; i++ ) {
@@ -607,7 +610,8 @@ static void usb_check_for_transfer_events() {
 	}
 }
 
-void usb0_isr() {
+RAMFUNC void usb0_isr() {
+	const uint32_t start = perf_cycles();
 	const uint32_t status = usb_get_status();
 	
 	if( status == 0 ) {
@@ -642,6 +646,7 @@ void usb0_isr() {
 
 	if( status & USB0_USBSTS_D_URI ) {
 		// USB reset received.
+		event_log_write(EVENT_USB_BUS_RESET, 0, 0);
 		usb_bus_reset(usb_device_usb0);
 	}
 
@@ -657,4 +662,6 @@ void usb0_isr() {
 		// Both the TX/RX endpoint NAK bit and corresponding TX/RX endpoint
 		// NAK enable bit are set.
 	}
+
+	perf_counter_update(&perf_stats.usb_isr, perf_cycles() - start);
 }
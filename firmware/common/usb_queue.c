@@ -30,16 +30,27 @@
 
 #include "usb.h"
 #include "usb_queue.h"
+#include "event_log.h"
+#include "perf.h"
+#include "ramfunc.h"
 
 usb_queue_t* endpoint_queues[12] = {};
 
+/* Bytes covered by one dTD. Five page pointers reach 20 KiB only when the
+ * buffer starts on a page boundary; 16 KiB fits wherever it starts.
+ */
+#define USB_TRANSFER_SEGMENT_SIZE 0x4000
+
 #define USB_ENDPOINT_INDEX(endpoint_address) (((endpoint_address & 0xF) * 2) + ((endpoint_address >> 7) & 1))
 
-static usb_queue_t* endpoint_queue(
+RAMFUNC static usb_queue_t* endpoint_queue(
         const usb_endpoint_t* const endpoint
 ) {
         uint32_t index = USB_ENDPOINT_INDEX(endpoint->address);
-        if (endpoint_queues[index] == NULL) while (1);
+        if (endpoint_queues[index] == NULL) {
+                event_log_write(EVENT_USB_QUEUE_MISSING, endpoint->address, 0);
+                while (1);
+        }
         return endpoint_queues[index];
 }
 
@@ -60,7 +71,7 @@ void usb_queue_init(
 }
 
 /* Allocate a transfer */
-static usb_transfer_t* allocate_transfer(
+RAMFUNC static usb_transfer_t* allocate_transfer(
         usb_queue_t* const queue
 ) {
         bool aborted;
@@ -77,7 +88,7 @@ static usb_transfer_t* allocate_transfer(
 }
 
 /* Place a transfer in the free list */
-static void free_transfer(usb_transfer_t* const transfer)
+RAMFUNC static void free_transfer(usb_transfer_t* const transfer)
 {
         usb_queue_t* const queue = transfer->queue;
         bool aborted;
@@ -87,33 +98,127 @@ static void free_transfer(usb_transfer_t* const transfer)
         } while (aborted);
 }
 
-/* Add a transfer to the end of an endpoint's queue. Returns the old
- * tail or NULL is the queue was empty
+/* Allocate a chain of count transfers linked through next, or none at all.
+ * The last transfer of the chain is returned through last.
  */
-static usb_transfer_t* endpoint_queue_transfer(
-        usb_transfer_t* const transfer
+RAMFUNC static usb_transfer_t* allocate_transfers(
+        usb_queue_t* const queue,
+        const unsigned int count,
+        usb_transfer_t** const chain_last
 ) {
-        usb_queue_t* const queue = transfer->queue;
-        transfer->next = NULL;
-        if (queue->active != NULL) {
-            usb_transfer_t* t = queue->active;
-            while (t->next != NULL) t = t->next;
-            t->next = transfer;
-            return t;
+        usb_transfer_t* first = NULL;
+        usb_transfer_t* last = NULL;
+        for (unsigned int i=0; i < count; i++) {
+                usb_transfer_t* const transfer = allocate_transfer(queue);
+                if (transfer == NULL) {
+                        while (first != NULL) {
+                                usb_transfer_t* const next = first->next;
+                                free_transfer(first);
+                                first = next;
+                        }
+                        return NULL;
+                }
+                if (last == NULL)
+                        first = transfer;
+                else
+                        last->next = transfer;
+                last = transfer;
+        }
+        *chain_last = last;
+        return first;
+}
+
+/* Add a chain of count transfers, from first to last, to the end of an
+ * endpoint's queue. Returns the old tail or NULL is the queue was empty.
+ * Must be called with interrupts disabled.
+ */
+RAMFUNC static usb_transfer_t* endpoint_queue_transfer(
+        usb_transfer_t* const first,
+        usb_transfer_t* const last,
+        const unsigned int count
+) {
+        usb_queue_t* const queue = first->queue;
+        usb_transfer_t* const tail = queue->tail;
+        if (tail != NULL) {
+                tail->next = first;
         } else {
-            queue->active = transfer;
-            return NULL;
+                queue->active = first;
+        }
+        queue->tail = last;
+
+        queue->stats.depth += count;
+        if (queue->stats.depth > queue->stats.high_water)
+                queue->stats.high_water = queue->stats.depth;
+        return tail;
+}
+
+
+/* Retires every finished transfer at the head of the queue, running the
+ * completion callback of each chain that ends. Must be called with
+ * interrupts disabled or from the USB interrupt.
+ */
+RAMFUNC static void usb_queue_retire(usb_queue_t* const queue)
+{
+        usb_transfer_t* transfer = queue->active;
+
+        while (transfer != NULL) {
+                uint8_t status = transfer->td.total_bytes;
+
+                // Check for failures
+                if (   status & USB_TD_DTD_TOKEN_STATUS_HALTED
+                    || status & USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR
+                    || status & USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR) {
+                        // TODO: Uh oh, do something useful here
+                        event_log_write(EVENT_USB_TRANSFER_ERROR, queue->endpoint->address,
+                                        transfer->td.total_bytes);
+                        while (1);
+                }
+
+                // Still not finished
+                if (status & USB_TD_DTD_TOKEN_STATUS_ACTIVE) 
+                        break;
+
+                // Advance the head. We need to do this before invoking the completion
+                // callback as it might attempt to schedule a new transfer
+                queue->active = transfer->next;
+                usb_transfer_t* next = transfer->next;
+                if (next == NULL)
+                        queue->tail = NULL;
+                queue->stats.depth--;
+
+                // Invoke completion callback once the whole chain is done
+                unsigned int total_bytes = (transfer->td.total_bytes & USB_TD_DTD_TOKEN_TOTAL_BYTES_MASK) >> USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT;
+                queue->chain_transferred += transfer->maximum_length - total_bytes;
+                if (transfer->chain_end) {
+                        const unsigned int transferred = queue->chain_transferred;
+                        queue->chain_transferred = 0;
+                        if (transfer->completion_cb)
+                                transfer->completion_cb(transfer->user_data, transferred);
+                }
+
+                // Advance head and free transfer
+                free_transfer(transfer);
+                transfer = next;
         }
 }
-                
+
+/* Transfers that finished without interrupting are retired, callbacks
+ * included, before the rest are dropped.
+ */
 static void usb_queue_flush_queue(usb_queue_t* const queue)
 {
         cm_disable_interrupts();
+        usb_queue_retire(queue);
         while (queue->active) {
                 usb_transfer_t* transfer = queue->active;
                 queue->active = transfer->next;
                 free_transfer(transfer);
         }
+        queue->tail = NULL;
+        queue->stats.depth = 0;
+        queue->chain_transferred = 0;
+        queue->batch = 0;
+        queue->batch_count = 0;
         cm_enable_interrupts();
 }
 
@@ -122,7 +227,51 @@ void usb_queue_flush_endpoint(const usb_endpoint_t* const endpoint)
         usb_queue_flush_queue(endpoint_queue(endpoint));
 }
 
-int usb_transfer_schedule(
+void usb_queue_stats(
+        const usb_endpoint_t* const endpoint,
+        usb_queue_stats_t* const stats,
+        const bool clear
+) {
+        usb_queue_t* const queue = endpoint_queue(endpoint);
+        cm_disable_interrupts();
+        *stats = queue->stats;
+        if (clear) {
+                queue->stats.high_water = queue->stats.depth;
+                queue->stats.alloc_failures = 0;
+                queue->stats.spin_cycles = 0;
+        }
+        cm_enable_interrupts();
+}
+
+void usb_queue_set_completion_batch(
+        const usb_endpoint_t* const endpoint,
+        const unsigned int batch
+) {
+        usb_queue_t* const queue = endpoint_queue(endpoint);
+        cm_disable_interrupts();
+        queue->batch = batch;
+        queue->batch_count = 0;
+        cm_enable_interrupts();
+}
+
+RAMFUNC bool usb_queue_busy(const usb_endpoint_t* const endpoint)
+{
+        usb_queue_t* const queue = endpoint_queue(endpoint);
+        cm_disable_interrupts();
+        usb_transfer_t* const tail = queue->tail;
+        const bool busy = (tail != NULL)
+                && (tail->td.total_bytes & USB_TD_DTD_TOKEN_STATUS_ACTIVE);
+        cm_enable_interrupts();
+        return busy;
+}
+
+/* Schedule a transfer of up to maximum_length bytes. Transfers longer than
+ * one dTD are split over a chain of dTDs from the queue's pool, with only
+ * the last one interrupting on completion. Returns -1 if the pool is
+ * currently too short of free transfers and -2 if it is too small to ever
+ * hold the chain.
+ */
+RAMFUNC int usb_transfer_schedule(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
 	const uint32_t maximum_length,
@@ -130,55 +279,91 @@ int usb_transfer_schedule(
         void* const user_data
 ) {
         usb_queue_t* const queue = endpoint_queue(endpoint);
-        usb_transfer_t* const transfer = allocate_transfer(queue);
-        if (transfer == NULL) return -1;
-        usb_transfer_descriptor_t* const td = &transfer->td;
-
-	// Configure the transfer descriptor
-        td->next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
-	td->total_bytes =
-		  USB_TD_DTD_TOKEN_TOTAL_BYTES(maximum_length)
-		| USB_TD_DTD_TOKEN_IOC
-		| USB_TD_DTD_TOKEN_MULTO(0)
-		| USB_TD_DTD_TOKEN_STATUS_ACTIVE
-		;
-	td->buffer_pointer_page[0] =  (uint32_t)data;
-	td->buffer_pointer_page[1] = ((uint32_t)data + 0x1000) & 0xfffff000;
-	td->buffer_pointer_page[2] = ((uint32_t)data + 0x2000) & 0xfffff000;
-	td->buffer_pointer_page[3] = ((uint32_t)data + 0x3000) & 0xfffff000;
-	td->buffer_pointer_page[4] = ((uint32_t)data + 0x4000) & 0xfffff000;
-
-        // Fill in transfer fields
-        transfer->maximum_length = maximum_length;
-        transfer->completion_cb = completion_cb;
-        transfer->user_data = user_data;
+        const unsigned int count = (maximum_length == 0) ? 1 :
+                (maximum_length + USB_TRANSFER_SEGMENT_SIZE - 1) / USB_TRANSFER_SEGMENT_SIZE;
+        if (count > queue->pool_size) return -2;
+        usb_transfer_t* last;
+        usb_transfer_t* const first = allocate_transfers(queue, count, &last);
+        if (first == NULL) {
+                queue->stats.alloc_failures++;
+                return -1;
+        }
+
+        // With batching enabled only every batch'th transfer interrupts. The
+        // one that empties the pool always does, so that a caller waiting
+        // for a free transfer is always woken eventually.
+        bool ioc = true;
+        if (queue->batch > 1) {
+                ioc = (++queue->batch_count >= queue->batch)
+                   || (queue->free_transfers == NULL);
+                if (ioc) queue->batch_count = 0;
+        }
+
+        uint32_t offset = 0;
+        for (usb_transfer_t* transfer = first; transfer != NULL; transfer = transfer->next) {
+                usb_transfer_descriptor_t* const td = &transfer->td;
+                const uint32_t address = (uint32_t)data + offset;
+                const uint32_t length = (maximum_length - offset > USB_TRANSFER_SEGMENT_SIZE)
+                        ? USB_TRANSFER_SEGMENT_SIZE : maximum_length - offset;
+                const bool is_last = (transfer->next == NULL);
+
+                // Configure the transfer descriptor
+                td->next_dtd_pointer = is_last
+                        ? USB_TD_NEXT_DTD_POINTER_TERMINATE
+                        : &transfer->next->td;
+                td->total_bytes =
+                          USB_TD_DTD_TOKEN_TOTAL_BYTES(length)
+                        | ((is_last && ioc) ? USB_TD_DTD_TOKEN_IOC : 0)
+                        | USB_TD_DTD_TOKEN_MULTO(0)
+                        | USB_TD_DTD_TOKEN_STATUS_ACTIVE
+                        ;
+                td->buffer_pointer_page[0] =  address;
+                td->buffer_pointer_page[1] = (address + 0x1000) & 0xfffff000;
+                td->buffer_pointer_page[2] = (address + 0x2000) & 0xfffff000;
+                td->buffer_pointer_page[3] = (address + 0x3000) & 0xfffff000;
+                td->buffer_pointer_page[4] = (address + 0x4000) & 0xfffff000;
+
+                // Fill in transfer fields; only the last one reports completion
+                transfer->maximum_length = length;
+                transfer->chain_end = is_last;
+                transfer->completion_cb = is_last ? completion_cb : NULL;
+                transfer->user_data = is_last ? user_data : NULL;
+                offset += length;
+        }
 
         cm_disable_interrupts();
-        usb_transfer_t* tail = endpoint_queue_transfer(transfer);
+        usb_transfer_t* tail = endpoint_queue_transfer(first, last, count);
         if (tail == NULL) {
                 // The queue is currently empty, we need to re-prime
-                usb_endpoint_schedule_wait(queue->endpoint, &transfer->td);
+                usb_endpoint_schedule_wait(queue->endpoint, &first->td);
         } else {
                 // The queue is currently running, try to append
-                usb_endpoint_schedule_append(queue->endpoint, &tail->td, &transfer->td);
+                usb_endpoint_schedule_append(queue->endpoint, &tail->td, &first->td);
         }
         cm_enable_interrupts();
         return 0;
 }
 	
-int usb_transfer_schedule_block(
+RAMFUNC int usb_transfer_schedule_block(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
 	const uint32_t maximum_length,
         const transfer_completion_cb completion_cb,
         void* const user_data
 ) {
-        int ret;
-        do {
-                ret = usb_transfer_schedule(endpoint, data, maximum_length,
-                                            completion_cb, user_data);
-        } while (ret == -1);
-        return 0;
+        int ret = usb_transfer_schedule(endpoint, data, maximum_length,
+                                        completion_cb, user_data);
+        if (ret == -1) {
+                // Every transfer in the pool is in flight; wait for one
+                event_log_write(EVENT_USB_QUEUE_EXHAUSTED, endpoint->address, 0);
+                const uint32_t start = perf_cycles();
+                do {
+                        ret = usb_transfer_schedule(endpoint, data, maximum_length,
+                                                    completion_cb, user_data);
+                } while (ret == -1);
+                endpoint_queue(endpoint)->stats.spin_cycles += perf_cycles() - start;
+        }
+        return ret;
 }
 
 int usb_transfer_schedule_ack(
@@ -187,41 +372,13 @@ int usb_transfer_schedule_ack(
         return usb_transfer_schedule_block(endpoint, 0, 0, NULL, NULL);
 }
 
-/* Called when an endpoint might have completed a transfer */
-void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
+/* Called when an endpoint might have completed a transfer. Retires every
+ * finished transfer at the head of the queue, so one interrupt can complete
+ * several batched transfers.
+ */
+RAMFUNC void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
 {
         usb_queue_t* const queue = endpoint_queue(endpoint);
         if (queue == NULL) while(1); // Uh oh
-        usb_transfer_t* transfer = queue->active;
-
-        while (transfer != NULL) {
-                uint8_t status = transfer->td.total_bytes;
-
-                // Check for failures
-                if (   status & USB_TD_DTD_TOKEN_STATUS_HALTED
-                    || status & USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR
-                    || status & USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR) {
-                        // TODO: Uh oh, do something useful here
-                        while (1);
-                }
-
-                // Still not finished
-                if (status & USB_TD_DTD_TOKEN_STATUS_ACTIVE) 
-                        break;
-
-                // Advance the head. We need to do this before invoking the completion
-                // callback as it might attempt to schedule a new transfer
-                queue->active = transfer->next;
-                usb_transfer_t* next = transfer->next;
-
-                // Invoke completion callback
-                unsigned int total_bytes = (transfer->td.total_bytes & USB_TD_DTD_TOKEN_TOTAL_BYTES_MASK) >> USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT;
-                unsigned int transferred = transfer->maximum_length - total_bytes;
-                if (transfer->completion_cb)
-                        transfer->completion_cb(transfer->user_data, transferred);
-
-                // Advance head and free transfer
-                free_transfer(transfer);
-                transfer = next;
-        }
+        usb_queue_retire(queue);
 }
@@ -23,6 +23,8 @@
 #ifndef __USB_QUEUE_H__
 #define __USB_QUEUE_H__
 
+#include <stdbool.h>
+
 #include <libopencm3/lpc43xx/usb.h>
 
 #include "usb_type.h"
@@ -31,11 +33,23 @@ typedef struct _usb_transfer_t usb_transfer_t;
 typedef struct _usb_queue_t usb_queue_t;
 typedef void (*transfer_completion_cb)(void*, unsigned int);
 
+/* Queue depth counts dTDs handed to the controller and not yet retired.
+ * spin_cycles is the time usb_transfer_schedule_block() spent waiting for
+ * a free transfer, and is only counted in PERF_COUNTERS builds.
+ */
+typedef struct {
+        uint32_t depth;
+        uint32_t high_water;
+        uint32_t alloc_failures;
+        uint32_t spin_cycles;
+} usb_queue_stats_t;
+
 // This is an opaque datatype. Thou shall not touch these members.
 struct _usb_transfer_t {
         struct _usb_transfer_t* next;
         usb_transfer_descriptor_t td ATTR_ALIGNED(64);
         unsigned int maximum_length;
+        bool chain_end;
         struct _usb_queue_t* queue;
         transfer_completion_cb completion_cb;
         void* user_data;
@@ -47,6 +61,11 @@ struct _usb_queue_t {
         const unsigned int pool_size;
         usb_transfer_t* volatile free_transfers;
         usb_transfer_t* volatile active;
+        usb_transfer_t* volatile tail;
+        unsigned int chain_transferred;
+        unsigned int batch;
+        unsigned int batch_count;
+        volatile usb_queue_stats_t stats;
 };
 
 #define USB_DECLARE_QUEUE(endpoint_name)                                \
@@ -59,8 +78,44 @@ struct _usb_queue_t {
                 .pool_size = _pool_size                                 \
         };
 
+/* Drops every queued transfer, after running the callbacks of those that
+ * already finished, and turns completion batching off again.
+ */
 void usb_queue_flush_endpoint(const usb_endpoint_t* const endpoint);
 
+/* Interrupt on completion of only every batch'th transfer scheduled on the
+ * endpoint (0 or 1 interrupts on every transfer). The completion callbacks
+ * of the transfers in between run from the interrupt of the next one that
+ * does, or from usb_queue_flush_endpoint(). Only for queues scheduled from
+ * a single context.
+ */
+void usb_queue_set_completion_batch(
+        const usb_endpoint_t* const endpoint,
+        const unsigned int batch
+);
+
+/* True while the controller has not finished the last transfer queued on
+ * the endpoint, whether or not its completion has been handled yet.
+ */
+bool usb_queue_busy(const usb_endpoint_t* const endpoint);
+
+/* Copies the endpoint's queue statistics, then optionally restarts them
+ * from the current depth.
+ */
+void usb_queue_stats(
+        const usb_endpoint_t* const endpoint,
+        usb_queue_stats_t* const stats,
+        const bool clear
+);
+
+/* Transfers longer than 16 KiB take one pool entry per 16 KiB. A short
+ * packet ends only the dTD it lands in, so OUT transfers spanning several
+ * dTDs must be sized exactly.
+ *
+ * usb_transfer_schedule() never waits: it returns -1 when the pool has no
+ * room, and the caller can retry once a completion interrupt has freed a
+ * transfer. usb_transfer_schedule_block() spins until it succeeds.
+ */
 int usb_transfer_schedule(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
@@ -27,6 +27,7 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include "w25q80bv.h"
 #include "hackrf_core.h"
 #include <libopencm3/lpc43xx/ssp.h>
@@ -34,6 +35,44 @@
 #include <libopencm3/lpc43xx/gpio.h>
 #include <libopencm3/lpc43xx/rgu.h>
 
+/* Set by w25q80bv_setup(), whoever calls it. From then on the flash pins
+ * belong to SSP0 and the SPIFI memory map no longer reads the flash.
+ */
+static bool w25q80bv_ssp = false;
+
+/*
+ * Clock len bytes through SSP0, keeping its 8 entry FIFO topped up rather
+ * than waiting for every byte to come back. Sends 0xFF when tx is NULL and
+ * discards what is received when rx is NULL.
+ */
+static void w25q80bv_transfer_block(const uint8_t* const tx, uint8_t* const rx,
+		const uint32_t len)
+{
+	uint32_t sent = 0;
+	uint32_t received = 0;
+
+	while (received < len) {
+		if ((sent < len) && ((sent - received) < 8) && (SSP0_SR & SSP_SR_TNF)) {
+			SSP0_DR = tx ? tx[sent] : 0xFF;
+			sent++;
+		}
+		if (SSP0_SR & SSP_SR_RNE) {
+			const uint8_t value = SSP0_DR;
+			if (rx)
+				rx[received] = value;
+			received++;
+		}
+	}
+}
+
+static void w25q80bv_send_address(const uint8_t command, const uint32_t addr)
+{
+	const uint8_t header[4] = {
+		command, (addr & 0xFF0000) >> 16, (addr & 0xFF00) >> 8, addr & 0xFF
+	};
+	w25q80bv_transfer_block(header, NULL, sizeof(header));
+}
+
 /*
  * Set up pins for GPIO and SPI control, configure SSP0 peripheral for SPI.
  * SSP0_SSEL is controlled by GPIO in order to handle various transfer lengths.
@@ -85,6 +124,8 @@ void w25q80bv_setup(void)
 			SSP_MASTER,
 			SSP_SLAVE_OUT_ENABLE);
 
+	w25q80bv_ssp = true;
+
 	device_id = 0;
 	while(device_id != W25Q80BV_DEVICE_ID_RES)
 	{
@@ -92,6 +133,12 @@ void w25q80bv_setup(void)
 	}
 }
 
+/* Whether the flash has to be read through SSP0 rather than SPIFI */
+bool w25q80bv_ssp_enabled(void)
+{
+	return w25q80bv_ssp;
+}
+
 uint8_t w25q80bv_get_status(void)
 {
 	uint8_t value;
@@ -161,14 +208,6 @@ void w25q80bv_write_enable(void)
 
 void w25q80bv_chip_erase(void)
 {
-	uint8_t device_id;
-
-	device_id = 0;
-	while(device_id != W25Q80BV_DEVICE_ID_RES)
-	{
-		device_id = w25q80bv_get_device_id();
-	}
-
 	w25q80bv_write_enable();
 	w25q80bv_wait_while_busy();
 	gpio_clear(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
@@ -176,11 +215,32 @@ void w25q80bv_chip_erase(void)
 	gpio_set(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
 }
 
+/* erase the 4 KiB sector containing addr; returns without waiting for it */
+void w25q80bv_sector_erase(const uint32_t addr)
+{
+	w25q80bv_write_enable();
+	w25q80bv_wait_while_busy();
+	gpio_clear(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
+	w25q80bv_send_address(W25Q80BV_SECTOR_ERASE, addr);
+	gpio_set(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
+}
+
+/* read an arbitrary number of bytes */
+void w25q80bv_read(const uint32_t addr, const uint32_t len, uint8_t* const data)
+{
+	if ((len > W25Q80BV_NUM_BYTES) || (addr > (W25Q80BV_NUM_BYTES - len)))
+		return;
+
+	w25q80bv_wait_while_busy();
+	gpio_clear(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
+	w25q80bv_send_address(W25Q80BV_READ_DATA, addr);
+	w25q80bv_transfer_block(NULL, data, len);
+	gpio_set(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
+}
+
 /* write up a 256 byte page or partial page */
 void w25q80bv_page_program(const uint32_t addr, const uint16_t len, const uint8_t* data)
 {
-	int i;
-
 	/* do nothing if asked to write beyond a page boundary */
 	if (((addr & 0xFF) + len) > W25Q80BV_PAGE_LEN)
 		return;
@@ -193,12 +253,8 @@ void w25q80bv_page_program(const uint32_t addr, const uint16_t len, const uint8_
 	w25q80bv_wait_while_busy();
 
 	gpio_clear(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
-	ssp_transfer(SSP0_NUM, W25Q80BV_PAGE_PROGRAM);
-	ssp_transfer(SSP0_NUM, (addr & 0xFF0000) >> 16);
-	ssp_transfer(SSP0_NUM, (addr & 0xFF00) >> 8);
-	ssp_transfer(SSP0_NUM, addr & 0xFF);
-	for (i = 0; i < len; i++)
-		ssp_transfer(SSP0_NUM, data[i]);
+	w25q80bv_send_address(W25Q80BV_PAGE_PROGRAM, addr);
+	w25q80bv_transfer_block(data, NULL, len);
 	gpio_set(PORT_SSP0_SSEL, PIN_SSP0_SSEL);
 }
 
@@ -206,14 +262,7 @@ void w25q80bv_page_program(const uint32_t addr, const uint16_t len, const uint8_
 void w25q80bv_program(uint32_t addr, uint32_t len, const uint8_t* data)
 {
 	uint16_t first_block_len;
-	uint8_t device_id;
 
-	device_id = 0;
-	while(device_id != W25Q80BV_DEVICE_ID_RES)
-	{
-		device_id = w25q80bv_get_device_id();
-	}	
-	
 	/* do nothing if we would overflow the flash */
 	if ((len > W25Q80BV_NUM_BYTES) || (addr > W25Q80BV_NUM_BYTES)
 			|| ((addr + len) > W25Q80BV_NUM_BYTES))
@@ -23,8 +23,13 @@
 #ifndef __W25Q80BV_H__
 #define __W25Q80BV_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define W25Q80BV_PAGE_LEN     256U
 #define W25Q80BV_NUM_PAGES    4096U
+#define W25Q80BV_SECTOR_LEN   4096U
+#define W25Q80BV_NUM_SECTORS  256U
 #define W25Q80BV_NUM_BYTES    1048576U
 
 #define W25Q80BV_WRITE_ENABLE 0x06
@@ -33,6 +38,8 @@
 #define W25Q80BV_PAGE_PROGRAM 0x02
 #define W25Q80BV_DEVICE_ID    0xAB
 #define W25Q80BV_UNIQUE_ID    0x4B
+#define W25Q80BV_READ_DATA    0x03
+#define W25Q80BV_SECTOR_ERASE 0x20
 
 #define W25Q80BV_STATUS_BUSY  0x01
 
@@ -47,8 +54,13 @@ typedef union
 } w25q80bv_unique_id_t;
 
 void w25q80bv_setup(void);
+bool w25q80bv_ssp_enabled(void);
 void w25q80bv_chip_erase(void);
+void w25q80bv_sector_erase(const uint32_t addr);
+void w25q80bv_wait_while_busy(void);
+void w25q80bv_page_program(const uint32_t addr, const uint16_t len, const uint8_t* data);
 void w25q80bv_program(uint32_t addr, uint32_t len, const uint8_t* data);
+void w25q80bv_read(const uint32_t addr, const uint32_t len, uint8_t* const data);
 uint8_t w25q80bv_get_device_id(void);
 void w25q80bv_get_unique_id(w25q80bv_unique_id_t* unique_id);
 
@@ -22,12 +22,16 @@
 
 #include <stddef.h>
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/cm3/vector.h>
 
 #include <libopencm3/lpc43xx/gpio.h>
 #include <libopencm3/lpc43xx/m4/nvic.h>
 
 #include <streaming.h>
+#include <perf.h>
+#include <event_log.h>
+#include <ramfunc.h>
 
 #include "usb.h"
 #include "usb_standard_request.h"
@@ -36,6 +40,8 @@
 #include "usb_endpoint.h"
 #include "usb_api_board_info.h"
 #include "usb_api_cpld.h"
+#include "usb_api_event_log.h"
+#include "usb_api_perf.h"
 #include "usb_api_register.h"
 #include "usb_api_spiflash.h"
 
@@ -54,24 +60,27 @@ void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
 	usb_endpoint_disable(&usb_endpoint_bulk_out);
 	
 	_transceiver_mode = new_transceiver_mode;
+	event_log_write(EVENT_TRANSCEIVER_MODE, new_transceiver_mode, 0);
 	
 	if( _transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		gpio_clear(PORT_LED1_3, PIN_LED3);
 		gpio_set(PORT_LED1_3, PIN_LED2);
 		usb_endpoint_init(&usb_endpoint_bulk_in);
+		usb_queue_set_completion_batch(&usb_endpoint_bulk_in, 2);
 		rf_path_set_direction(RF_PATH_DIRECTION_RX);
-		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
+		RAM_VECTOR_TABLE.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
 	} else if (_transceiver_mode == TRANSCEIVER_MODE_TX) {
 		gpio_clear(PORT_LED1_3, PIN_LED2);
 		gpio_set(PORT_LED1_3, PIN_LED3);
 		usb_endpoint_init(&usb_endpoint_bulk_out);
+		usb_queue_set_completion_batch(&usb_endpoint_bulk_out, 2);
 		rf_path_set_direction(RF_PATH_DIRECTION_TX);
-		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_tx;
+		RAM_VECTOR_TABLE.irq[NVIC_SGPIO_IRQ] = sgpio_isr_tx;
 	} else {
 		gpio_clear(PORT_LED1_3, PIN_LED2);
 		gpio_clear(PORT_LED1_3, PIN_LED3);
 		rf_path_set_direction(RF_PATH_DIRECTION_OFF);
-		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
+		RAM_VECTOR_TABLE.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
 	}
 
 	if( _transceiver_mode != TRANSCEIVER_MODE_OFF ) {
@@ -80,7 +89,7 @@ void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
 	}
 }
 
-transceiver_mode_t transceiver_mode(void) {
+RAMFUNC transceiver_mode_t transceiver_mode(void) {
 	return _transceiver_mode;
 }
 
@@ -134,6 +143,13 @@ static const usb_request_handler_fn vendor_request_handler[] = {
 	NULL,
 #endif
 	usb_vendor_request_set_freq_explicit,
+	usb_vendor_request_read_perf,
+	usb_vendor_request_read_event_log,
+	usb_vendor_request_write_spiflash_bulk,
+	usb_vendor_request_read_spiflash_status,
+	usb_vendor_request_read_spiflash_crc,
+	usb_vendor_request_read_spiflash_bulk,
+	usb_vendor_request_read_cpld_status,
 };
 
 static const uint32_t vendor_request_handler_count =
@@ -165,6 +181,8 @@ const usb_request_handlers_t usb_request_handlers = {
 void usb_configuration_changed(
 	usb_device_t* const device
 ) {
+	event_log_write(EVENT_USB_CONFIGURATION, device->configuration->number, 0);
+
 	/* Reset transceiver to idle state until other commands are received */
 	set_transceiver_mode(TRANSCEIVER_MODE_OFF);
 	if( device->configuration->number == 1 ) {
@@ -183,7 +201,122 @@ void usb_configuration_changed(
 	}
 }
 
+/* Half of usb_bulk_buffer most recently queued on the bulk endpoint. */
+static volatile uint32_t usb_bulk_half_queued;
+
+/* Called when the bulk transfer of one half of usb_bulk_buffer completes.
+ * Records how many bytes the SGPIO ISR still had to go before reaching that
+ * half, or an overrun if it already got there. The bulk queues interrupt
+ * once per pass over the buffer, so the callback of the other half runs only
+ * after the next one is queued and says nothing about when it finished;
+ * streaming_loop() checks that half for overruns instead.
+ */
+RAMFUNC static void usb_bulk_transfer_complete(void* user_data, unsigned int bytes_transferred) {
+	const uint32_t half = (uint32_t)user_data;
+	const uint32_t offset = usb_bulk_buffer_offset;
+	(void)bytes_transferred;
+
+	if( half != usb_bulk_half_queued ) {
+		return;
+	}
+	if( (offset & 0x4000) == half ) {
+		perf_overrun();
+		event_log_write(EVENT_SGPIO_OVERRUN, offset, 0);
+	} else {
+		perf_counter_update(&perf_stats.slack, (half - offset) & usb_bulk_buffer_mask);
+	}
+}
+
+/* Keeps one half of usb_bulk_buffer queued on the bulk endpoint while the
+ * SGPIO ISR works on the other. Driven by usb_bulk_buffer_ready rather than
+ * by polling the buffer offset, and sleeps in WFI whenever there is nothing
+ * to do.
+ */
+RAMFUNC static void streaming_loop(void) {
+	uint32_t handled = usb_bulk_buffer_ready;
+	bool streaming = false;
+	bool deferred = false;
+
+	while(true) {
+		// Interrupts are masked around the check so that an event raised
+		// between it and WFI still wakes the core; the ISR then runs as
+		// soon as they are unmasked. A transfer deferred because the bulk
+		// queue was full can only be retried after a USB completion
+		// interrupt, so that is a reason to sleep too.
+		cm_disable_interrupts();
+		if( !start_cpld_update && !start_spiflash_bulk && !start_spiflash_read
+		    && !start_spiflash_crc && (deferred
+		        || ((streaming == (transceiver_mode() != TRANSCEIVER_MODE_OFF))
+		            && (usb_bulk_buffer_ready == handled))) ) {
+			perf_sleep();
+			__asm__ volatile("wfi");
+		}
+		cm_enable_interrupts();
+
+		// Check whether we need to initiate a CPLD update
+		if (start_cpld_update)
+			cpld_update();
+
+		// Bulk SPI flash transfers share usb_bulk_buffer with streaming
+		if (start_spiflash_bulk) {
+			set_transceiver_mode(TRANSCEIVER_MODE_OFF);
+			spiflash_bulk_write();
+		}
+		if (start_spiflash_read) {
+			set_transceiver_mode(TRANSCEIVER_MODE_OFF);
+			spiflash_bulk_read();
+		}
+		if (start_spiflash_crc) {
+			spiflash_sector_crcs();
+		}
+
+		if( transceiver_mode() == TRANSCEIVER_MODE_OFF ) {
+			streaming = false;
+			deferred = false;
+			handled = usb_bulk_buffer_ready;
+			continue;
+		}
+
+		// On start, queue the half SGPIO is not in straight away (TX needs
+		// it filled); after that, one transfer per half SGPIO finishes.
+		if( !streaming || (usb_bulk_buffer_ready != handled) ) {
+			const uint32_t ready = usb_bulk_buffer_ready;
+			const uint32_t ready_time = usb_bulk_buffer_ready_time;
+			const uint32_t offset = usb_bulk_buffer_offset;
+			const uint32_t half = (offset & 0x4000) ^ 0x4000;
+			const usb_endpoint_t* const endpoint =
+				(transceiver_mode() == TRANSCEIVER_MODE_RX)
+				? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out;
+			const uint32_t start = perf_cycles();
+			if( streaming && !deferred && usb_queue_busy(endpoint) ) {
+				// The half SGPIO just moved into is still on the bus
+				perf_overrun();
+				event_log_write(EVENT_SGPIO_OVERRUN, offset, 0);
+			}
+			usb_bulk_half_queued = half;
+			deferred = (usb_transfer_schedule(
+				endpoint,
+				&usb_bulk_buffer[half],
+				0x4000,
+				usb_bulk_transfer_complete, (void*)half
+			) != 0);
+			perf_counter_update(&perf_stats.main_loop, perf_cycles() - start);
+			if( deferred ) {
+				continue;
+			}
+			if( streaming ) {
+				perf_counter_update(&perf_stats.latency, perf_cycles() - ready_time);
+			}
+			handled = ready;
+			streaming = true;
+		}
+	}
+}
+
 int main(void) {
+	ramfunc_init();
+	event_log_init();
+
 	pin_setup();
 	enable_1v8_power();
 #ifdef HACKRF_ONE
@@ -206,46 +339,15 @@ int main(void) {
 	
 	nvic_set_priority(NVIC_USB0_IRQ, 255);
 
+	perf_init();
+
 	usb_run(&usb_device);
 	
 	ssp1_init();
 
 	rf_path_init();
 
-	unsigned int phase = 0;
-	while(true) {
-		// Check whether we need to initiate a CPLD update
-		if (start_cpld_update)
-			cpld_update();
+	streaming_loop();
 
-		// Set up IN transfer of buffer 0.
-		if ( usb_bulk_buffer_offset >= 16384
-		     && phase == 1
-		     && transceiver_mode() != TRANSCEIVER_MODE_OFF) {
-			usb_transfer_schedule_block(
-				(transceiver_mode() == TRANSCEIVER_MODE_RX)
-				? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-				&usb_bulk_buffer[0x0000],
-				0x4000,
-				NULL, NULL
-				);
-			phase = 0;
-		}
-	
-		// Set up IN transfer of buffer 1.
-		if ( usb_bulk_buffer_offset < 16384
-		     && phase == 0
-		     && transceiver_mode() != TRANSCEIVER_MODE_OFF) {
-			usb_transfer_schedule_block(
-				(transceiver_mode() == TRANSCEIVER_MODE_RX)
-				? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-				&usb_bulk_buffer[0x4000],
-				0x4000,
-				NULL, NULL
-			);
-			phase = 1;
-		}
-	}
-	
 	return 0;
 }
@@ -24,9 +24,13 @@
 
 #include <libopencm3/lpc43xx/sgpio.h>
 
+#include <perf.h>
+#include <ramfunc.h>
+
 #include "usb_bulk_buffer.h"
 
-void sgpio_isr_rx() {
+RAMFUNC void sgpio_isr_rx() {
+	const uint32_t start = perf_cycles();
 	SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
 
 	uint32_t* const p = (uint32_t*)&usb_bulk_buffer[usb_bulk_buffer_offset];
@@ -52,10 +56,17 @@ void sgpio_isr_rx() {
 		  [p] "l" (p)
 		: "r0"
 	);
-	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	const uint32_t offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	usb_bulk_buffer_offset = offset;
+	if( (offset & 0x3fff) == 0 ) {
+		perf_timestamp(&usb_bulk_buffer_ready_time);
+		usb_bulk_buffer_ready++;
+	}
+	perf_counter_update(&perf_stats.sgpio_isr, perf_cycles() - start);
 }
 
-void sgpio_isr_tx() {
+RAMFUNC void sgpio_isr_tx() {
+	const uint32_t start = perf_cycles();
 	SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
 
 	uint32_t* const p = (uint32_t*)&usb_bulk_buffer[usb_bulk_buffer_offset];
@@ -81,5 +92,11 @@ void sgpio_isr_tx() {
 		  [p] "l" (p)
 		: "r0"
 	);
-	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	const uint32_t offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	usb_bulk_buffer_offset = offset;
+	if( (offset & 0x3fff) == 0 ) {
+		perf_timestamp(&usb_bulk_buffer_ready_time);
+		usb_bulk_buffer_ready++;
+	}
+	perf_counter_update(&perf_stats.sgpio_isr, perf_cycles() - start);
 }
@@ -21,6 +21,7 @@
  */
 
 #include "usb_api_board_info.h"
+#include "usb_api_spiflash.h"
 
 #include <hackrf_core.h>
 #include <rom_iap.h>
@@ -64,6 +65,16 @@ usb_request_status_t usb_vendor_request_read_partid_serialno(
 
 	if (stage == USB_TRANSFER_STAGE_SETUP) 
 	{
+		/* Without IAP, iap_cmd_call() reads the flash over SSP0, which
+		 * takes SPIFI away from an XIP image. */
+		if (!iap_is_implemented()) {
+#ifdef RAMFUNC_ENABLE
+			return USB_REQUEST_STATUS_STALL;
+#endif
+			if (spiflash_busy())
+				return USB_REQUEST_STATUS_STALL;
+		}
+
 		/* Read IAP Part Number Identification */
 		iap_cmd_res.cmd_param.command_code = IAP_CMD_READ_PART_ID_NO;
 		iap_cmd_call(&iap_cmd_res);
@@ -26,36 +26,76 @@
 
 #include <hackrf_core.h>
 #include <cpld_jtag.h>
+#include <perf.h>
 #include <usb_queue.h>
 
 #include "usb_endpoint.h"
+#include "usb_bulk_buffer.h"
 
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+/* XSVF arrives in the two halves of usb_bulk_buffer in turn: while the
+ * player shifts one half into the CPLD, USB fills the other.
+ */
+#define CPLD_XSVF_CHUNK_LEN (sizeof(usb_bulk_buffer) / 2)
+
 volatile bool start_cpld_update = false;
-uint8_t cpld_xsvf_buffer[512];
-volatile bool cpld_wait = false;
+static volatile bool cpld_chunk_ready[2];
+static volatile uint32_t cpld_chunk_length[2];
+static uint32_t cpld_half;
+static volatile cpld_update_status_t cpld_status;
+static cpld_update_status_t cpld_status_buffer;
 
-static void cpld_buffer_refilled(void* user_data, unsigned int length)
+static void cpld_chunk_received(void* user_data, unsigned int length)
 {
-	cpld_wait = false;
+	cpld_status.received += length;
+	cpld_chunk_length[(uint32_t)user_data] = length;
+	cpld_chunk_ready[(uint32_t)user_data] = true;
 }
 
-static void refill_cpld_buffer(void)
+static void cpld_receive(const uint32_t half)
 {
-	cpld_wait = true;
-	usb_transfer_schedule(
+	cpld_chunk_ready[half] = false;
+	usb_transfer_schedule_block(
 		&usb_endpoint_bulk_out,
-		cpld_xsvf_buffer,
-		sizeof(cpld_xsvf_buffer),
-		cpld_buffer_refilled,
-		NULL
+		&usb_bulk_buffer[half * CPLD_XSVF_CHUNK_LEN],
+		CPLD_XSVF_CHUNK_LEN,
+		cpld_chunk_received,
+		(void*)half
 		);
+}
+
+static uint32_t cpld_wait_for_chunk(const uint32_t half)
+{
+	const uint32_t start = perf_cycles();
+	while (!cpld_chunk_ready[half]);
+	cpld_status.wait_cycles += perf_cycles() - start;
+	return cpld_chunk_length[half];
+}
+
+/* The player has used up the current half: hand it back to USB and move on
+ * to the other, which has usually arrived already.
+ */
+static uint32_t refill_cpld_buffer(unsigned char** const buffer)
+{
+	cpld_receive(cpld_half);
+	cpld_half ^= 1;
+	*buffer = &usb_bulk_buffer[cpld_half * CPLD_XSVF_CHUNK_LEN];
+	return cpld_wait_for_chunk(cpld_half);
+}
 
-	// Wait until transfer finishes
-	while (cpld_wait);
+usb_request_status_t usb_vendor_request_read_cpld_status(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		cpld_status_buffer = cpld_status;
+		usb_transfer_schedule_block(endpoint->in, &cpld_status_buffer,
+				sizeof(cpld_status_buffer), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
 }
 
 void cpld_update(void)
@@ -64,15 +104,28 @@ void cpld_update(void)
 	#define ALL_LEDS  (PIN_LED1|PIN_LED2|PIN_LED3)
 	int i;
 	int error;
+	uint32_t length;
+	const uint32_t start = perf_cycles();
+
+	cpld_status.state = CPLD_UPDATE_BUSY;
+	cpld_status.error = 0;
+	cpld_status.received = 0;
+	cpld_status.cycles = 0;
+	cpld_status.wait_cycles = 0;
 
 	usb_queue_flush_endpoint(&usb_endpoint_bulk_in);
 	usb_queue_flush_endpoint(&usb_endpoint_bulk_out);
 
-	refill_cpld_buffer();
+	cpld_half = 0;
+	cpld_receive(0);
+	cpld_receive(1);
+	length = cpld_wait_for_chunk(0);
+
+	error = cpld_jtag_program(length, usb_bulk_buffer, refill_cpld_buffer);
 
-	error = cpld_jtag_program(sizeof(cpld_xsvf_buffer),
-				  cpld_xsvf_buffer,
-				  refill_cpld_buffer);
+	cpld_status.cycles = perf_cycles() - start;
+	cpld_status.error = error;
+	cpld_status.state = (error == 0) ? CPLD_UPDATE_DONE : CPLD_UPDATE_ERROR;
 	if(error == 0)
 	{
 		/* blink LED1, LED2, and LED3 on success */
@@ -24,9 +24,35 @@
 #define __USB_API_CPLD_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include <usb_type.h>
+#include <usb_request.h>
+
+typedef enum {
+	CPLD_UPDATE_IDLE = 0,
+	CPLD_UPDATE_BUSY = 1,
+	CPLD_UPDATE_DONE = 2,
+	CPLD_UPDATE_ERROR = 3,
+} cpld_update_state_t;
+
+/* Progress of a CPLD update, read by the host with
+ * HACKRF_VENDOR_REQUEST_CPLD_STATUS. Cycle counts are only kept in
+ * PERF_COUNTERS builds.
+ */
+typedef struct {
+	uint32_t state;
+	uint32_t error;       /* xsvfExecute() result once finished */
+	uint32_t received;    /* XSVF bytes received over USB */
+	uint32_t cycles;      /* since the update started */
+	uint32_t wait_cycles; /* the XSVF player spent waiting for USB */
+} cpld_update_status_t;
 
 extern volatile bool start_cpld_update;
 
 void cpld_update(void);
 
+usb_request_status_t usb_vendor_request_read_cpld_status(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+
 #endif /* end of include guard: __USB_API_CPLD_H__ */
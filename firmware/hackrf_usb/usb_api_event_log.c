@@ -0,0 +1,55 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "usb_api_event_log.h"
+
+#include <event_log.h>
+#include <usb_queue.h>
+
+#include <stddef.h>
+
+/* Sends the whole ring (or the first wLength bytes of it) directly from
+ * SRAM. Logging is frozen until the data stage completes; a nonzero wValue
+ * empties the log once it has been sent.
+ */
+usb_request_status_t usb_vendor_request_read_event_log(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	uint32_t length;
+
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		length = sizeof(event_log);
+		if (endpoint->setup.length < length) {
+			length = endpoint->setup.length;
+		}
+		event_log_freeze(true);
+		usb_transfer_schedule_block(endpoint->in, (void*)&event_log,
+				length, NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		if (endpoint->setup.value) {
+			event_log_clear();
+		}
+		event_log_freeze(false);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "usb_api_perf.h"
+
+#include <perf.h>
+#include <usb_queue.h>
+
+#include "usb_endpoint.h"
+
+#include <stddef.h>
+
+static struct {
+	perf_stats_t perf;
+	usb_queue_stats_t bulk_in;
+	usb_queue_stats_t bulk_out;
+} perf_buffer;
+
+/* Reads the counters and bulk queue statistics accumulated since they were
+ * last cleared. A nonzero wValue clears them after the snapshot so each
+ * read covers one interval.
+ */
+usb_request_status_t usb_vendor_request_read_perf(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		perf_snapshot(&perf_buffer.perf);
+		if (endpoint->setup.value) {
+			perf_clear();
+		}
+		usb_queue_stats(&usb_endpoint_bulk_in, &perf_buffer.bulk_in,
+				endpoint->setup.value != 0);
+		usb_queue_stats(&usb_endpoint_bulk_out, &perf_buffer.bulk_out,
+				endpoint->setup.value != 0);
+		usb_transfer_schedule_block(endpoint->in, &perf_buffer,
+				sizeof(perf_buffer), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
@@ -23,19 +23,107 @@
 #include "usb_api_spiflash.h"
 
 #include "usb_queue.h"
+#include "usb_endpoint.h"
+#include "usb_bulk_buffer.h"
+#include "usb_api_transceiver.h"
 
 #include <stddef.h>
+#include <string.h>
 
+#include <crc32.h>
 #include <w25q80bv.h>
 
+#include <libopencm3/cm3/scs.h>
+
 uint8_t spiflash_buffer[W25Q80BV_PAGE_LEN];
 
+/* The bulk paths use the two halves of usb_bulk_buffer in turn, so one
+ * chunk crosses USB while the flash works on the other.
+ */
+#define SPIFLASH_BULK_CHUNK_LEN (sizeof(usb_bulk_buffer) / 2)
+
+/* How long a bulk transfer may wait for the host before it is abandoned,
+ * in cycles of the DWT counter that event_log_init() starts (5 s at 204MHz).
+ */
+#define SPIFLASH_BULK_TIMEOUT_CYCLES (5 * 204000000)
+
+typedef struct {
+	uint32_t address;
+	uint32_t length;
+} spiflash_bulk_params_t;
+
+static spiflash_bulk_params_t spiflash_bulk_params;
+static spiflash_bulk_params_t spiflash_read_params;
+static volatile spiflash_bulk_status_t spiflash_bulk_status;
+static spiflash_bulk_status_t spiflash_status_buffer;
+static volatile uint32_t spiflash_bulk_done[2];
+volatile bool start_spiflash_bulk = false;
+volatile bool start_spiflash_read = false;
+volatile bool start_spiflash_crc = false;
+
+#define SPIFLASH_CRC_MAX_SECTORS 256
+static uint32_t spiflash_crc_buffer[SPIFLASH_CRC_MAX_SECTORS];
+
+typedef struct {
+	uint32_t first;
+	uint32_t count;
+	uint32_t last_len;
+} spiflash_crc_params_t;
+
+static spiflash_crc_params_t spiflash_crc_params;
+
+/* Reads flash at SPIFI quad speed through the memory map until anything
+ * (this file or rom_iap.c) has moved the flash to SSP0, then through SSP0.
+ * An XIP image refuses every request that would do that, so it always
+ * reads through the memory map.
+ */
+static void spiflash_read(const uint32_t addr, const uint32_t len, uint8_t* const data)
+{
+	if (w25q80bv_ssp_enabled()) {
+		w25q80bv_read(addr, len, data);
+	} else {
+		memcpy(data, (const void*)(addr + SPIFI_DATA_UNCACHED_BASE), len);
+	}
+}
+
+/* CRC-32 of len bytes of flash at addr, however the flash is reachable */
+static uint32_t spiflash_crc(const uint32_t addr, const uint32_t len)
+{
+	uint32_t crc = 0;
+	uint32_t offset;
+
+	if (!w25q80bv_ssp_enabled()) {
+		return crc32(0, (const uint8_t*)(addr + SPIFI_DATA_UNCACHED_BASE), len);
+	}
+	for (offset = 0; offset < len; offset += W25Q80BV_PAGE_LEN) {
+		const uint32_t page_len = ((len - offset) < W25Q80BV_PAGE_LEN)
+				? (len - offset) : W25Q80BV_PAGE_LEN;
+		w25q80bv_read(addr + offset, page_len, spiflash_buffer);
+		crc = crc32(crc, spiflash_buffer, page_len);
+	}
+	return crc;
+}
+
+/* True while the main loop owns SSP0 for a bulk write, bulk read or sector
+ * CRCs. Requests handled in usb0_isr must not touch the flash meanwhile: an
+ * interleaved SSP0 transaction corrupts both, and a write's flash with it.
+ */
+bool spiflash_busy(void)
+{
+	return start_spiflash_bulk || start_spiflash_read || start_spiflash_crc;
+}
+
 usb_request_status_t usb_vendor_request_erase_spiflash(
 		usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
 {
-	//FIXME This should refuse to run if executing from SPI flash.
-
 	if (stage == USB_TRANSFER_STAGE_SETUP) {
+#ifdef RAMFUNC_ENABLE
+		/* An XIP image runs from the flash it would be erasing. */
+		return USB_REQUEST_STATUS_STALL;
+#endif
+		if (spiflash_busy()) {
+			return USB_REQUEST_STATUS_STALL;
+		}
 		w25q80bv_setup();
 		/* only chip erase is implemented */
 		w25q80bv_chip_erase();
@@ -51,12 +139,14 @@ usb_request_status_t usb_vendor_request_write_spiflash(
 	uint32_t addr = 0;
 	uint16_t len = 0;
 
-	//FIXME This should refuse to run if executing from SPI flash.
-
 	if (stage == USB_TRANSFER_STAGE_SETUP) {
+#ifdef RAMFUNC_ENABLE
+		/* w25q80bv_setup() would take SPIFI away from an XIP image. */
+		return USB_REQUEST_STATUS_STALL;
+#endif
 		addr = (endpoint->setup.value << 16) | endpoint->setup.index;
 		len = endpoint->setup.length;
-		if ((len > W25Q80BV_PAGE_LEN) || (addr > W25Q80BV_NUM_BYTES)
+		if (spiflash_busy() || (len > W25Q80BV_PAGE_LEN) || (addr > W25Q80BV_NUM_BYTES)
 				|| ((addr + len) > W25Q80BV_NUM_BYTES)) {
 			return USB_REQUEST_STATUS_STALL;
 		} else {
@@ -86,25 +176,18 @@ usb_request_status_t usb_vendor_request_write_spiflash(
 usb_request_status_t usb_vendor_request_read_spiflash(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
 {
-	uint32_t i;
 	uint32_t addr;
 	uint16_t len;
-	uint8_t* u8_addr_pt;
 
 	if (stage == USB_TRANSFER_STAGE_SETUP) 
 	{
 		addr = (endpoint->setup.value << 16) | endpoint->setup.index;
 		len = endpoint->setup.length;
-		if ((len > W25Q80BV_PAGE_LEN) || (addr > W25Q80BV_NUM_BYTES)
+		if (spiflash_busy() || (len > W25Q80BV_PAGE_LEN) || (addr > W25Q80BV_NUM_BYTES)
 			    || ((addr + len) > W25Q80BV_NUM_BYTES)) {
 			return USB_REQUEST_STATUS_STALL;
 		} else {
-			/* TODO flush SPIFI "cache" before to read the SPIFI memory */
-			u8_addr_pt = (uint8_t*)(addr + SPIFI_DATA_UNCACHED_BASE);
-			for(i=0; i<len; i++)
-			{
-				spiflash_buffer[i] = u8_addr_pt[i];
-			}
+			spiflash_read(addr, len, &spiflash_buffer[0]);
 			usb_transfer_schedule_block(endpoint->in, &spiflash_buffer[0], len,
 						    NULL, NULL);
 			return USB_REQUEST_STATUS_OK;
@@ -129,3 +212,323 @@ usb_request_status_t usb_vendor_request_read_spiflash(
 	}
 }
 
+
+/* Starts a bulk write of spiflash_bulk_params.length bytes, sent on the bulk
+ * OUT endpoint after this request, at the sector aligned
+ * spiflash_bulk_params.address. Only sectors whose content changes are
+ * erased; erasing one clears whatever the write leaves of it untouched.
+ */
+usb_request_status_t usb_vendor_request_write_spiflash_bulk(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+#ifdef RAMFUNC_ENABLE
+		/* An XIP image runs from the flash it would be rewriting. */
+		return USB_REQUEST_STATUS_STALL;
+#else
+		if (spiflash_busy()
+				|| (endpoint->setup.length != sizeof(spiflash_bulk_params))) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_transfer_schedule_block(endpoint->out, &spiflash_bulk_params,
+				sizeof(spiflash_bulk_params), NULL, NULL);
+		return USB_REQUEST_STATUS_OK;
+#endif
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		const uint32_t addr = spiflash_bulk_params.address;
+		const uint32_t len = spiflash_bulk_params.length;
+		if ((addr % W25Q80BV_SECTOR_LEN) || (len == 0)
+				|| (len > W25Q80BV_NUM_BYTES)
+				|| (addr > (W25Q80BV_NUM_BYTES - len))) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		spiflash_bulk_status.state = SPIFLASH_BULK_BUSY;
+		spiflash_bulk_status.address = addr;
+		spiflash_bulk_status.length = len;
+		spiflash_bulk_status.received = 0;
+		spiflash_bulk_status.sectors_erased = 0;
+		spiflash_bulk_status.sectors_unchanged = 0;
+		spiflash_bulk_status.pages_programmed = 0;
+		spiflash_bulk_status.crc_received = 0;
+		spiflash_bulk_status.crc_flash = 0;
+		start_spiflash_bulk = true;
+		usb_transfer_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+usb_request_status_t usb_vendor_request_read_spiflash_status(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		spiflash_status_buffer = spiflash_bulk_status;
+		usb_transfer_schedule_block(endpoint->in, &spiflash_status_buffer,
+				sizeof(spiflash_status_buffer), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+static void spiflash_bulk_chunk_done(void* user_data, unsigned int length)
+{
+	spiflash_bulk_done[(uint32_t)user_data] = length;
+}
+
+/* Waits for the transfer on one half to finish. Gives up if the host goes
+ * quiet, so a host that stops part way cannot hang the main loop.
+ */
+static bool spiflash_bulk_wait(const uint32_t half)
+{
+	const uint32_t start = SCS_DWT_CYCCNT;
+	while (spiflash_bulk_done[half] == 0) {
+		if ((SCS_DWT_CYCCNT - start) > SPIFLASH_BULK_TIMEOUT_CYCLES) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void spiflash_bulk_receive(const uint32_t half, const uint32_t len)
+{
+	spiflash_bulk_done[half] = 0;
+	usb_transfer_schedule_block(&usb_endpoint_bulk_out,
+			&usb_bulk_buffer[half * SPIFLASH_BULK_CHUNK_LEN], len,
+			spiflash_bulk_chunk_done, (void*)half);
+}
+
+/* Bring len bytes of one sector in line with data. Unchanged sectors are
+ * left alone, sectors that only need bits cleared are programmed in place,
+ * and the rest are erased first, after which blank pages are skipped.
+ */
+static void spiflash_update_sector(const uint32_t addr, const uint8_t* const data,
+		const uint32_t len)
+{
+	uint32_t changed_pages = 0;
+	bool needs_erase = false;
+	uint32_t page;
+	uint32_t i;
+
+	for (page = 0; (page < len) && !needs_erase; page += W25Q80BV_PAGE_LEN) {
+		const uint32_t page_len = ((len - page) < W25Q80BV_PAGE_LEN)
+				? (len - page) : W25Q80BV_PAGE_LEN;
+		w25q80bv_read(addr + page, page_len, spiflash_buffer);
+		for (i = 0; i < page_len; i++) {
+			const uint8_t old = spiflash_buffer[i];
+			const uint8_t new = data[page + i];
+			if (old != new) {
+				changed_pages |= 1 << (page / W25Q80BV_PAGE_LEN);
+				if ((old & new) != new) {
+					needs_erase = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (changed_pages == 0) {
+		spiflash_bulk_status.sectors_unchanged++;
+		return;
+	}
+	if (needs_erase) {
+		w25q80bv_sector_erase(addr);
+		spiflash_bulk_status.sectors_erased++;
+	}
+
+	for (page = 0; page < len; page += W25Q80BV_PAGE_LEN) {
+		const uint32_t page_len = ((len - page) < W25Q80BV_PAGE_LEN)
+				? (len - page) : W25Q80BV_PAGE_LEN;
+		bool program = false;
+		if (needs_erase) {
+			for (i = 0; (i < page_len) && !program; i++) {
+				program = (data[page + i] != 0xFF);
+			}
+		} else {
+			program = (changed_pages >> (page / W25Q80BV_PAGE_LEN)) & 1;
+		}
+		if (program) {
+			w25q80bv_page_program(addr + page, page_len, &data[page]);
+			spiflash_bulk_status.pages_programmed++;
+		}
+	}
+}
+
+/* Runs from the main loop once usb_vendor_request_write_spiflash_bulk() has
+ * accepted a write: receives the data, updates the flash sector by sector
+ * and finally checksums what was written.
+ */
+void spiflash_bulk_write(void)
+{
+	const uint32_t addr = spiflash_bulk_status.address;
+	const uint32_t length = spiflash_bulk_status.length;
+	uint32_t offset;
+	uint32_t half = 0;
+
+	usb_queue_flush_endpoint(&usb_endpoint_bulk_in);
+	usb_queue_flush_endpoint(&usb_endpoint_bulk_out);
+	w25q80bv_setup();
+
+	spiflash_bulk_receive(0, (length < SPIFLASH_BULK_CHUNK_LEN)
+			? length : SPIFLASH_BULK_CHUNK_LEN);
+	if (length > SPIFLASH_BULK_CHUNK_LEN) {
+		spiflash_bulk_receive(1, ((length - SPIFLASH_BULK_CHUNK_LEN) < SPIFLASH_BULK_CHUNK_LEN)
+				? (length - SPIFLASH_BULK_CHUNK_LEN) : SPIFLASH_BULK_CHUNK_LEN);
+	}
+
+	for (offset = 0; offset < length; half ^= 1) {
+		const uint8_t* const data = &usb_bulk_buffer[half * SPIFLASH_BULK_CHUNK_LEN];
+		const uint32_t len = ((length - offset) < SPIFLASH_BULK_CHUNK_LEN)
+				? (length - offset) : SPIFLASH_BULK_CHUNK_LEN;
+		uint32_t sector;
+
+		if (!spiflash_bulk_wait(half) || (spiflash_bulk_done[half] != len)) {
+			usb_queue_flush_endpoint(&usb_endpoint_bulk_out);
+			spiflash_bulk_status.state = SPIFLASH_BULK_ERROR;
+			start_spiflash_bulk = false;
+			return;
+		}
+		spiflash_bulk_status.received += len;
+		spiflash_bulk_status.crc_received = crc32(spiflash_bulk_status.crc_received, data, len);
+
+		for (sector = 0; sector < len; sector += W25Q80BV_SECTOR_LEN) {
+			spiflash_update_sector(addr + offset + sector, &data[sector],
+					((len - sector) < W25Q80BV_SECTOR_LEN)
+					? (len - sector) : W25Q80BV_SECTOR_LEN);
+		}
+		offset += len;
+
+		/* This half is free again; refill it with the chunk after next. */
+		if ((length - offset) > SPIFLASH_BULK_CHUNK_LEN) {
+			const uint32_t next = length - offset - SPIFLASH_BULK_CHUNK_LEN;
+			spiflash_bulk_receive(half, (next < SPIFLASH_BULK_CHUNK_LEN)
+					? next : SPIFLASH_BULK_CHUNK_LEN);
+		}
+	}
+
+	spiflash_bulk_status.crc_flash = spiflash_crc(addr, length);
+	spiflash_bulk_status.state = SPIFLASH_BULK_DONE;
+	start_spiflash_bulk = false;
+}
+
+/* Returns one CRC-32 per sector for a run of sectors, so the host can tell
+ * which ones differ from an image without reading the flash back. The low
+ * byte of wValue is the first sector and the high byte the number of
+ * sectors less one; wIndex is how many bytes of the last sector to cover.
+ * A megabyte takes a while to read over SSP0, so the CRCs are computed by
+ * spiflash_sector_crcs() in the main loop and the data stage waits for
+ * them. Stalled while streaming, which the main loop has to keep fed.
+ */
+usb_request_status_t usb_vendor_request_read_spiflash_crc(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		const uint32_t first = endpoint->setup.value & 0xFF;
+		const uint32_t count = (endpoint->setup.value >> 8) + 1;
+		const uint32_t last_len = endpoint->setup.index;
+
+		/* The main loop owns SSP0 during bulk writes and reads. */
+		if (spiflash_busy()
+				|| (transceiver_mode() != TRANSCEIVER_MODE_OFF)
+				|| ((first + count) > W25Q80BV_NUM_SECTORS)
+				|| (last_len == 0) || (last_len > W25Q80BV_SECTOR_LEN)
+				|| (endpoint->setup.length != (count * sizeof(uint32_t)))) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		spiflash_crc_params.first = first;
+		spiflash_crc_params.count = count;
+		spiflash_crc_params.last_len = last_len;
+		start_spiflash_crc = true;
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+/* Runs from the main loop once usb_vendor_request_read_spiflash_crc() has
+ * accepted a request, and completes it.
+ */
+void spiflash_sector_crcs(void)
+{
+	const uint32_t first = spiflash_crc_params.first;
+	const uint32_t count = spiflash_crc_params.count;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		spiflash_crc_buffer[i] = spiflash_crc(
+				(first + i) * W25Q80BV_SECTOR_LEN,
+				(i == (count - 1)) ? spiflash_crc_params.last_len
+				                   : W25Q80BV_SECTOR_LEN);
+	}
+	usb_transfer_schedule_block(&usb_endpoint_control_in, spiflash_crc_buffer,
+			count * sizeof(uint32_t), NULL, NULL);
+	usb_transfer_schedule_ack(&usb_endpoint_control_out);
+	start_spiflash_crc = false;
+}
+
+/* Starts a bulk read of spiflash_read_params.length bytes from
+ * spiflash_read_params.address, sent on the bulk IN endpoint after this
+ * request.
+ */
+usb_request_status_t usb_vendor_request_read_spiflash_bulk(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		if (spiflash_busy()
+				|| (endpoint->setup.length != sizeof(spiflash_read_params))) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_transfer_schedule_block(endpoint->out, &spiflash_read_params,
+				sizeof(spiflash_read_params), NULL, NULL);
+		return USB_REQUEST_STATUS_OK;
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		const uint32_t addr = spiflash_read_params.address;
+		const uint32_t len = spiflash_read_params.length;
+		if ((len == 0) || (len > W25Q80BV_NUM_BYTES)
+				|| (addr > (W25Q80BV_NUM_BYTES - len))) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		start_spiflash_read = true;
+		usb_transfer_schedule_ack(endpoint->in);
+		return USB_REQUEST_STATUS_OK;
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Runs from the main loop once usb_vendor_request_read_spiflash_bulk() has
+ * accepted a read: copies the flash into one half of usb_bulk_buffer while
+ * the other half is sent.
+ */
+void spiflash_bulk_read(void)
+{
+	const uint32_t addr = spiflash_read_params.address;
+	const uint32_t length = spiflash_read_params.length;
+	uint32_t offset;
+	uint32_t half = 0;
+
+	usb_queue_flush_endpoint(&usb_endpoint_bulk_in);
+	usb_queue_flush_endpoint(&usb_endpoint_bulk_out);
+	spiflash_bulk_done[0] = 1;
+	spiflash_bulk_done[1] = 1;
+
+	for (offset = 0; offset < length; half ^= 1) {
+		uint8_t* const data = &usb_bulk_buffer[half * SPIFLASH_BULK_CHUNK_LEN];
+		const uint32_t len = ((length - offset) < SPIFLASH_BULK_CHUNK_LEN)
+				? (length - offset) : SPIFLASH_BULK_CHUNK_LEN;
+
+		/* Wait for the last transfer from this half to go out. */
+		if (!spiflash_bulk_wait(half)) {
+			break;
+		}
+		spiflash_read(addr + offset, len, data);
+		spiflash_bulk_done[half] = 0;
+		usb_transfer_schedule_block(&usb_endpoint_bulk_in, data, len,
+				spiflash_bulk_chunk_done, (void*)half);
+		offset += len;
+	}
+
+	if (!spiflash_bulk_wait(0) || !spiflash_bulk_wait(1)) {
+		/* The host stopped reading; drop what is still queued. */
+		usb_queue_flush_endpoint(&usb_endpoint_bulk_in);
+	}
+	start_spiflash_read = false;
+}
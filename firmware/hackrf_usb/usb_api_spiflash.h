@@ -23,14 +23,58 @@
 #ifndef __USB_API_SPIFLASH_H__
 #define __USB_API_SPIFLASH_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include <usb_type.h>
 #include <usb_request.h>
 
+typedef enum {
+	SPIFLASH_BULK_IDLE = 0,
+	SPIFLASH_BULK_BUSY = 1,
+	SPIFLASH_BULK_DONE = 2,
+	SPIFLASH_BULK_ERROR = 3,
+} spiflash_bulk_state_t;
+
+/* Progress of a bulk SPI flash write, read by the host with
+ * HACKRF_VENDOR_REQUEST_SPIFLASH_STATUS. Both CRCs are CRC-32 over
+ * [address, address + length): one of the data received over USB and one
+ * of the flash read back after programming.
+ */
+typedef struct {
+	uint32_t state;
+	uint32_t address;
+	uint32_t length;
+	uint32_t received;
+	uint32_t sectors_erased;
+	uint32_t sectors_unchanged;
+	uint32_t pages_programmed;
+	uint32_t crc_received;
+	uint32_t crc_flash;
+} spiflash_bulk_status_t;
+
+extern volatile bool start_spiflash_bulk;
+extern volatile bool start_spiflash_read;
+extern volatile bool start_spiflash_crc;
+
+void spiflash_bulk_write(void);
+void spiflash_bulk_read(void);
+void spiflash_sector_crcs(void);
+bool spiflash_busy(void);
+
 usb_request_status_t usb_vendor_request_erase_spiflash(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_write_spiflash(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_read_spiflash(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_write_spiflash_bulk(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_read_spiflash_status(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_read_spiflash_crc(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_read_spiflash_bulk(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 
 #endif /* end of include guard: __USB_API_SPIFLASH_H__ */
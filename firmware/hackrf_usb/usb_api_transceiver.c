@@ -24,6 +24,7 @@
 
 #include <libopencm3/lpc43xx/gpio.h>
 
+#include <event_log.h>
 #include <max2837.h>
 #include <rf_path.h>
 #include <tuning.h>
@@ -62,6 +63,7 @@ usb_request_status_t usb_vendor_request_set_baseband_filter_bandwidth(
 ) {
 	if( stage == USB_TRANSFER_STAGE_SETUP ) {
 		const uint32_t bandwidth = (endpoint->setup.index << 16) | endpoint->setup.value;
+		event_log_write(EVENT_BASEBAND_FILTER, bandwidth, 0);
 		if( baseband_filter_bandwidth_set(bandwidth) ) {
 			usb_transfer_schedule_ack(endpoint->in);
 			return USB_REQUEST_STATUS_OK;
@@ -84,6 +86,7 @@ usb_request_status_t usb_vendor_request_set_freq(
 	} else if (stage == USB_TRANSFER_STAGE_DATA) 
 	{
 		const uint64_t freq = set_freq_params.freq_mhz * 1000000ULL + set_freq_params.freq_hz;
+		event_log_write(EVENT_SET_FREQ, set_freq_params.freq_mhz, set_freq_params.freq_hz);
 		if( set_freq(freq) ) 
 		{
 			usb_transfer_schedule_ack(endpoint->in);
@@ -107,6 +110,8 @@ usb_request_status_t usb_vendor_request_set_sample_rate_frac(
 		return USB_REQUEST_STATUS_OK;
 	} else if (stage == USB_TRANSFER_STAGE_DATA) 
 	{
+		event_log_write(EVENT_SAMPLE_RATE, set_sample_r_params.freq_hz,
+				set_sample_r_params.divider);
 		if( sample_rate_frac_set(set_sample_r_params.freq_hz * 2, set_sample_r_params.divider ) )
 		{
 			usb_transfer_schedule_ack(endpoint->in);
@@ -146,6 +151,7 @@ usb_request_status_t usb_vendor_request_set_lna_gain(
 {
 	if( stage == USB_TRANSFER_STAGE_SETUP ) {
 			const uint8_t value = max2837_set_lna_gain(endpoint->setup.index);
+			event_log_write(EVENT_GAIN, EVENT_GAIN_LNA, endpoint->setup.index);
 			endpoint->buffer[0] = value;
 			usb_transfer_schedule_block(endpoint->in, &endpoint->buffer, 1,
 						    NULL, NULL);
@@ -160,6 +166,7 @@ usb_request_status_t usb_vendor_request_set_vga_gain(
 {
 	if( stage == USB_TRANSFER_STAGE_SETUP ) {
 			const uint8_t value = max2837_set_vga_gain(endpoint->setup.index);
+			event_log_write(EVENT_GAIN, EVENT_GAIN_VGA, endpoint->setup.index);
 			endpoint->buffer[0] = value;
 			usb_transfer_schedule_block(endpoint->in, &endpoint->buffer, 1,
 						    NULL, NULL);
@@ -174,6 +181,7 @@ usb_request_status_t usb_vendor_request_set_txvga_gain(
 {
 	if( stage == USB_TRANSFER_STAGE_SETUP ) {
 			const uint8_t value = max2837_set_txvga_gain(endpoint->setup.index);
+			event_log_write(EVENT_GAIN, EVENT_GAIN_TXVGA, endpoint->setup.index);
 			endpoint->buffer[0] = value;
 			usb_transfer_schedule_block(endpoint->in, &endpoint->buffer, 1,
 						    NULL, NULL);
@@ -213,6 +221,9 @@ usb_request_status_t usb_vendor_request_set_freq_explicit(
 				sizeof(struct set_freq_explicit_params), NULL, NULL);
 		return USB_REQUEST_STATUS_OK;
 	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		event_log_write(EVENT_SET_FREQ_EXPLICIT,
+				(uint32_t)(explicit_params.if_freq_hz / 1000),
+				(uint32_t)(explicit_params.lo_freq_hz / 1000));
 		if (set_freq_explicit(explicit_params.if_freq_hz,
 				explicit_params.lo_freq_hz, explicit_params.path)) {
 			usb_transfer_schedule_ack(endpoint->in);
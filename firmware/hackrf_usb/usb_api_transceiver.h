@@ -27,6 +27,8 @@
 #include <usb_type.h>
 #include <usb_request.h>
 
+transceiver_mode_t transceiver_mode(void);
+
 usb_request_status_t usb_vendor_request_set_transceiver_mode(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage);
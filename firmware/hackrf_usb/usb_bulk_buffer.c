@@ -24,3 +24,5 @@
 
 const uint32_t usb_bulk_buffer_mask = 32768 - 1;
 volatile uint32_t usb_bulk_buffer_offset = 0;
+volatile uint32_t usb_bulk_buffer_ready = 0;
+volatile uint32_t usb_bulk_buffer_ready_time = 0;
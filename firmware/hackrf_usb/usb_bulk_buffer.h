@@ -35,4 +35,11 @@ extern const uint32_t usb_bulk_buffer_mask;
 
 extern volatile uint32_t usb_bulk_buffer_offset;
 
+/* Bumped by the SGPIO ISR each time it moves into the other half of
+ * usb_bulk_buffer, leaving the half it finished ready for USB, along with
+ * the cycle count at that moment.
+ */
+extern volatile uint32_t usb_bulk_buffer_ready;
+extern volatile uint32_t usb_bulk_buffer_ready_time;
+
 #endif/*__USB_BULK_BUFFER_H__*/
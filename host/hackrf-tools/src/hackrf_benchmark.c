@@ -0,0 +1,398 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Offline throughput benchmark for the libhackrf DSP blocks. No device needed. */
+
+#include <hackrf.h>
+#include <hackrf_channelizer.h>
+#include <hackrf_resampler.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <math.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+
+#ifdef _MSC_VER
+int gettimeofday(struct timeval *tv, void* ignored)
+{
+	FILETIME ft;
+	unsigned __int64 tmp = 0;
+	if (NULL != tv) {
+		GetSystemTimeAsFileTime(&ft);
+		tmp |= ft.dwHighDateTime;
+		tmp <<= 32;
+		tmp |= ft.dwLowDateTime;
+		tmp /= 10;
+		tmp -= 11644473600000000Ui64;
+		tv->tv_sec = (long)(tmp / 1000000UL);
+		tv->tv_usec = (long)(tmp % 1000000UL);
+	}
+	return 0;
+}
+#endif
+#endif
+
+#if defined(__GNUC__)
+#include <sys/time.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Same size as the libhackrf USB transfer buffers. */
+#define BLOCK_LENGTH (262144)
+
+#define DEFAULT_DURATION_S (5)
+#define HACKRF_MAX_SAMPLE_RATE_HZ (20000000)
+
+static int8_t block[BLOCK_LENGTH];
+
+static bool verbose = false;
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u32(char* s, uint32_t* const value)
+{
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t ulong_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	ulong_value = strtoul(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = (uint32_t)ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+/* Noise plus a full scale-ish tone at the given fraction of the sample rate. */
+static void fill_block(const double tone)
+{
+	uint32_t i;
+	double phase = 0.0;
+
+	srand(1);
+	for (i = 0; i < BLOCK_LENGTH; i += 2)
+	{
+		const int noise_i = (rand() % 9) - 4;
+		const int noise_q = (rand() % 9) - 4;
+		block[i] = (int8_t)(100.0 * cos(phase) + noise_i);
+		block[i+1] = (int8_t)(100.0 * sin(phase) + noise_q);
+		phase += 2.0 * M_PI * tone;
+		if (phase > M_PI)
+			phase -= 2.0 * M_PI;
+	}
+}
+
+static void report(const char* name, const uint64_t samples, const float seconds,
+		const uint32_t streams, const uint32_t threads)
+{
+	const double msps = samples / seconds / 1e6;
+	printf("%s: %" PRIu64 " samples in %5.3f s = %.2f MS/s (%.2fx %u MS/s)\n",
+			name, samples, seconds, msps,
+			msps / (HACKRF_MAX_SAMPLE_RATE_HZ / 1e6), HACKRF_MAX_SAMPLE_RATE_HZ / 1000000);
+	printf("%s: %u streams x MS/s = %.1f, per core = %.1f\n",
+			name, streams, streams * msps, streams * msps / threads);
+}
+
+typedef struct {
+	uint32_t num_channels;
+	double* power;
+} channel_sink_t;
+
+static int channel_sink(uint32_t channel, const float* samples,
+		uint32_t sample_count, void* ctx)
+{
+	channel_sink_t* const sink = (channel_sink_t*)ctx;
+	double power = 0.0;
+	uint32_t i;
+
+	for (i = 0; i < 2 * sample_count; i++)
+	{
+		power += samples[i] * samples[i];
+	}
+	sink->power[channel] += power;
+	return 0;
+}
+
+static int bench_channelizer(const uint32_t channels, const uint32_t taps,
+		const uint32_t threads, const uint32_t duration)
+{
+	hackrf_channelizer* channelizer = NULL;
+	channel_sink_t sink;
+	struct timeval t_start, t_now;
+	uint64_t samples = 0;
+	float elapsed = 0.0f;
+	uint32_t k;
+	int result;
+
+	sink.num_channels = channels;
+	sink.power = (double*)calloc(channels, sizeof(double));
+	if (sink.power == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	/* Tone in the middle of channel 1. */
+	fill_block(1.0 / channels);
+
+	result = hackrf_channelizer_create(&channelizer, channels, taps, NULL,
+			threads, channel_sink, &sink);
+	if (result != HACKRF_SUCCESS)
+	{
+		fprintf(stderr, "hackrf_channelizer_create() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		free(sink.power);
+		return EXIT_FAILURE;
+	}
+
+	printf("channelizer: %u channels, %u taps per channel, %u threads\n",
+			channels, taps, threads);
+
+	gettimeofday(&t_start, NULL);
+	do {
+		result = hackrf_channelizer_execute(channelizer, block, BLOCK_LENGTH);
+		if (result != HACKRF_SUCCESS)
+		{
+			fprintf(stderr, "hackrf_channelizer_execute() failed: %s (%d)\n",
+					hackrf_error_name(result), result);
+			break;
+		}
+		samples += BLOCK_LENGTH / 2;
+		gettimeofday(&t_now, NULL);
+		elapsed = TimevalDiff(&t_now, &t_start);
+	} while (elapsed < duration);
+
+	report("channelizer", samples, elapsed, channels, threads);
+
+	if (verbose)
+	{
+		for (k = 0; k < channels; k++)
+		{
+			printf("  channel %3u: %6.1f dB\n", k,
+					10.0 * log10(sink.power[k] / sink.power[1] + 1e-30));
+		}
+	}
+
+	hackrf_channelizer_destroy(channelizer);
+	free(sink.power);
+
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+typedef struct {
+	uint64_t samples;
+	double power;
+} resampler_sink_t;
+
+static int resampler_sink(const float* samples, uint32_t sample_count, void* ctx)
+{
+	resampler_sink_t* const sink = (resampler_sink_t*)ctx;
+	uint32_t i;
+
+	for (i = 0; i < 2 * sample_count; i++)
+	{
+		sink->power += samples[i] * samples[i];
+	}
+	sink->samples += sample_count;
+	return 0;
+}
+
+static int bench_resampler(const uint32_t input_rate, const uint32_t output_rate,
+		const uint32_t taps, const uint32_t duration)
+{
+	hackrf_resampler* resampler = NULL;
+	resampler_sink_t sink;
+	struct timeval t_start, t_now;
+	uint64_t samples = 0;
+	float elapsed = 0.0f;
+	int result;
+
+	memset(&sink, 0, sizeof(sink));
+
+	/* Tone well inside the output band. */
+	fill_block(0.1 * output_rate / input_rate);
+
+	result = hackrf_resampler_create(&resampler, input_rate, output_rate, taps,
+			resampler_sink, &sink);
+	if (result != HACKRF_SUCCESS)
+	{
+		fprintf(stderr, "hackrf_resampler_create() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	printf("resampler: %u Hz -> %u Hz\n", input_rate, output_rate);
+
+	gettimeofday(&t_start, NULL);
+	do {
+		result = hackrf_resampler_execute(resampler, block, BLOCK_LENGTH);
+		if (result != HACKRF_SUCCESS)
+		{
+			fprintf(stderr, "hackrf_resampler_execute() failed: %s (%d)\n",
+					hackrf_error_name(result), result);
+			break;
+		}
+		samples += BLOCK_LENGTH / 2;
+		gettimeofday(&t_now, NULL);
+		elapsed = TimevalDiff(&t_now, &t_start);
+	} while (elapsed < duration);
+
+	report("resampler", samples, elapsed, 1, 1);
+	printf("resampler: output %.3f MS/s\n", sink.samples / elapsed / 1e6);
+
+	if (verbose)
+	{
+		printf("  output/input sample ratio: %.9f (expected %.9f)\n",
+				(double)sink.samples / samples, (double)output_rate / input_rate);
+		printf("  output tone power: %.3f\n", sink.power / sink.samples);
+	}
+
+	hackrf_resampler_destroy(resampler);
+
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t-m <mode> # Block to benchmark: channelizer, resampler.\n");
+	printf("\t[-c channels] # Channelizer channels, power of two (default 16).\n");
+	printf("\t[-t taps] # Channelizer taps per channel (default 8), resampler taps per phase.\n");
+	printf("\t[-i rate_hz] # Resampler input rate (default 8000000).\n");
+	printf("\t[-o rate_hz] # Resampler output rate (default 2048000).\n");
+	printf("\t[-j threads] # Worker threads (default 1).\n");
+	printf("\t[-d seconds] # Duration of each run (default %d).\n", DEFAULT_DURATION_S);
+	printf("\t[-v] # Print per-stream signal check.\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	const char* mode = NULL;
+	uint32_t channels = 16;
+	uint32_t taps = 0;
+	uint32_t input_rate = 8000000;
+	uint32_t output_rate = 2048000;
+	uint32_t threads = 1;
+	uint32_t duration = DEFAULT_DURATION_S;
+
+	while( (opt = getopt(argc, argv, "m:c:t:j:d:i:o:v")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'm':
+			mode = optarg;
+			break;
+
+		case 'c':
+			result = parse_u32(optarg, &channels);
+			break;
+
+		case 't':
+			result = parse_u32(optarg, &taps);
+			break;
+
+		case 'j':
+			result = parse_u32(optarg, &threads);
+			break;
+
+		case 'd':
+			result = parse_u32(optarg, &duration);
+			break;
+
+		case 'i':
+			result = parse_u32(optarg, &input_rate);
+			break;
+
+		case 'o':
+			result = parse_u32(optarg, &output_rate);
+			break;
+
+		case 'v':
+			verbose = true;
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (mode == NULL) {
+		printf("specify a block to benchmark with -m\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	if (strcmp(mode, "channelizer") == 0) {
+		return bench_channelizer(channels, (taps == 0) ? 8 : taps, threads, duration);
+	}
+
+	if (strcmp(mode, "resampler") == 0) {
+		return bench_resampler(input_rate, output_rate, taps, duration);
+	}
+
+	printf("unknown mode '%s'\n", mode);
+	usage();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,420 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Own a HackRF and publish its RX stream to any number of local processes
+   through shared memory (see hackrf_shm.h), or attach to such a stream. */
+
+#include <hackrf.h>
+#include <hackrf_shm.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define DEFAULT_FREQ_HZ (900000000ull)
+#define DEFAULT_SAMPLE_RATE_HZ (10000000)
+#define MAX_READERS (64)
+/* Same size as the libhackrf USB transfer buffers. */
+#define BLOCK_LENGTH (262144)
+
+static volatile bool do_exit = false;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stdout, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u32(char* s, uint32_t* const value) {
+	uint64_t u64_value = 0;
+	int result = parse_u64(s, &u64_value);
+	if( (result == HACKRF_SUCCESS) && (u64_value > 0xffffffffull) ) {
+		result = HACKRF_ERROR_INVALID_PARAM;
+	}
+	*value = (uint32_t)u64_value;
+	return result;
+}
+
+/* Consumer: touch every sample so the numbers include reading the data. */
+
+typedef struct {
+	const char* name;
+	pthread_t thread;
+	uint64_t bytes;
+	uint64_t checksum;
+	uint64_t received;
+	uint64_t lost;
+	float elapsed;
+	int result;
+} reader_t;
+
+static void* reader_thread(void* arg)
+{
+	reader_t* const rd = (reader_t*)arg;
+	hackrf_shm_reader* reader = NULL;
+	hackrf_shm_block block;
+	struct timeval t_start, t_end;
+	uint32_t i;
+
+	rd->result = hackrf_shm_reader_open(&reader, rd->name);
+	if (rd->result != HACKRF_SUCCESS)
+	{
+		return NULL;
+	}
+
+	gettimeofday(&t_start, NULL);
+	while (!do_exit)
+	{
+		rd->result = hackrf_shm_reader_next(reader, &block, 1000);
+		if (rd->result == HACKRF_ERROR_NOT_FOUND)
+		{
+			continue;
+		}
+		if (rd->result != HACKRF_SUCCESS)
+		{
+			break;
+		}
+		for (i = 0; i < block.length; i++)
+		{
+			rd->checksum += (uint8_t)block.samples[i];
+		}
+		if (hackrf_shm_reader_release(reader, &block) == HACKRF_SUCCESS)
+		{
+			rd->bytes += block.length;
+		}
+	}
+	gettimeofday(&t_end, NULL);
+	rd->elapsed = TimevalDiff(&t_end, &t_start);
+	hackrf_shm_reader_stats(reader, &rd->received, &rd->lost);
+	hackrf_shm_reader_close(reader);
+	if (rd->result == HACKRF_ERROR_STREAMING_STOPPED)
+	{
+		rd->result = HACKRF_SUCCESS;
+	}
+	return NULL;
+}
+
+static int consume(const char* name)
+{
+	hackrf_shm_reader* reader = NULL;
+	hackrf_capture_metadata metadata;
+	hackrf_shm_block block;
+	struct timeval time_start, time_now;
+	uint64_t bytes = 0, received, lost;
+	int result;
+
+	result = hackrf_shm_reader_open(&reader, name);
+	if (result != HACKRF_SUCCESS) {
+		printf("hackrf_shm_reader_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+	hackrf_shm_reader_metadata(reader, &metadata);
+	printf("attached: %" PRIu64 " Hz, %u S/s\n", metadata.freq_hz, metadata.sample_rate_hz);
+
+	gettimeofday(&time_start, NULL);
+	while (!do_exit) {
+		result = hackrf_shm_reader_next(reader, &block, 1000);
+		if (result == HACKRF_SUCCESS) {
+			if (hackrf_shm_reader_release(reader, &block) == HACKRF_SUCCESS) {
+				bytes += block.length;
+			}
+		} else if (result != HACKRF_ERROR_NOT_FOUND) {
+			break;
+		}
+
+		gettimeofday(&time_now, NULL);
+		if (TimevalDiff(&time_now, &time_start) >= 1.0f) {
+			hackrf_shm_reader_stats(reader, &received, &lost);
+			printf("%4.1f MiB / %5.3f sec, %" PRIu64 " blocks, %" PRIu64 " lost\n",
+					bytes / 1e6f, TimevalDiff(&time_now, &time_start), received, lost);
+			bytes = 0;
+			time_start = time_now;
+		}
+	}
+
+	if (result == HACKRF_ERROR_STREAMING_STOPPED) {
+		printf("publisher stopped\n");
+		result = HACKRF_SUCCESS;
+	}
+	hackrf_shm_reader_close(reader);
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Publisher paced at sample_rate_hz (0 = as fast as possible) from a
+   synthetic block, with in-process readers. */
+static int benchmark(const char* name, const uint32_t seconds,
+		const uint32_t num_readers, const uint32_t slot_count,
+		const uint32_t sample_rate_hz)
+{
+	static int8_t block[BLOCK_LENGTH];
+	static reader_t readers[MAX_READERS];
+	hackrf_shm_publisher* publisher = NULL;
+	struct timeval t_start, t_now;
+	uint64_t published = 0;
+	float elapsed = 0.0f;
+	uint32_t i;
+	int result;
+
+	for (i = 0; i < BLOCK_LENGTH; i++) {
+		block[i] = (int8_t)i;
+	}
+
+	result = hackrf_shm_publisher_create(&publisher, name, BLOCK_LENGTH, slot_count);
+	if (result != HACKRF_SUCCESS) {
+		printf("hackrf_shm_publisher_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < num_readers; i++) {
+		readers[i].name = name;
+		pthread_create(&readers[i].thread, NULL, reader_thread, &readers[i]);
+	}
+	/* Let the readers attach before timing starts. */
+	usleep(100000);
+
+	gettimeofday(&t_start, NULL);
+	while (!do_exit && (elapsed < seconds)) {
+		hackrf_shm_publisher_write(publisher, block, BLOCK_LENGTH);
+		published++;
+		gettimeofday(&t_now, NULL);
+		elapsed = TimevalDiff(&t_now, &t_start);
+		if (sample_rate_hz != 0) {
+			const double due = published * (BLOCK_LENGTH / 2.0) / sample_rate_hz;
+			if (due > elapsed) {
+				usleep((useconds_t)((due - elapsed) * 1e6));
+			}
+		}
+	}
+	hackrf_shm_publisher_destroy(publisher);
+
+	printf("publisher: %.1f MB/s\n", published * (double)BLOCK_LENGTH / elapsed / 1e6);
+	for (i = 0; i < num_readers; i++) {
+		pthread_join(readers[i].thread, NULL);
+		if (readers[i].result != HACKRF_SUCCESS) {
+			printf("reader %u: %s (%d)\n", i, hackrf_error_name(readers[i].result), readers[i].result);
+			continue;
+		}
+		printf("reader %u: %.1f MB/s, %" PRIu64 " blocks, %" PRIu64 " lost\n", i,
+				readers[i].bytes / readers[i].elapsed / 1e6,
+				readers[i].received, readers[i].lost);
+	}
+	return EXIT_SUCCESS;
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-n name] # Shared memory name (default %s).\n", HACKRF_SHM_DEFAULT_NAME);
+	printf("\t[-c] # Attach to a running broker and print stream stats.\n");
+	printf("\t[-S slots] # Ring length in blocks (default %u).\n", HACKRF_SHM_DEFAULT_SLOT_COUNT);
+	printf("\t[-f freq_hz] # Frequency in Hz (default %" PRIu64 ").\n", (uint64_t)DEFAULT_FREQ_HZ);
+	printf("\t[-s sample_rate_hz] # Sample rate in Hz (default %u).\n", DEFAULT_SAMPLE_RATE_HZ);
+	printf("\t[-a amp_enable] # RX RF amplifier 1=Enable, 0=Disable.\n");
+	printf("\t[-l gain_db] # RX LNA (IF) gain, 0-40dB, 8dB steps.\n");
+	printf("\t[-g gain_db] # RX VGA (baseband) gain, 0-62dB, 2dB steps.\n");
+	printf("\t[-B seconds] # Benchmark with a synthetic source at -s rate (0 = unpaced), no device.\n");
+	printf("\t[-r readers] # Benchmark readers (default 4).\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	const char* name = HACKRF_SHM_DEFAULT_NAME;
+	bool consumer = false;
+	uint32_t slot_count = HACKRF_SHM_DEFAULT_SLOT_COUNT;
+	uint64_t freq_hz = DEFAULT_FREQ_HZ;
+	uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+	uint32_t amp_enable = 0;
+	uint32_t lna_gain = 8, vga_gain = 20;
+	uint32_t bench_seconds = 0;
+	uint32_t bench_readers = 4;
+	hackrf_device* device = NULL;
+	hackrf_shm_publisher* publisher = NULL;
+	hackrf_capture_metadata metadata;
+
+	while( (opt = getopt(argc, argv, "n:cS:f:s:a:l:g:B:r:")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'n':
+			name = optarg;
+			break;
+
+		case 'c':
+			consumer = true;
+			break;
+
+		case 'S':
+			result = parse_u32(optarg, &slot_count);
+			break;
+
+		case 'f':
+			result = parse_u64(optarg, &freq_hz);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'a':
+			result = parse_u32(optarg, &amp_enable);
+			break;
+
+		case 'l':
+			result = parse_u32(optarg, &lna_gain);
+			break;
+
+		case 'g':
+			result = parse_u32(optarg, &vga_gain);
+			break;
+
+		case 'B':
+			result = parse_u32(optarg, &bench_seconds);
+			break;
+
+		case 'r':
+			result = parse_u32(optarg, &bench_readers);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( bench_readers > MAX_READERS ) {
+		printf("argument error: at most %u readers\n", MAX_READERS);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+
+	if( consumer ) {
+		return consume(name);
+	}
+	if( bench_seconds > 0 ) {
+		return benchmark(name, bench_seconds, bench_readers, slot_count, sample_rate_hz);
+	}
+
+	result = hackrf_shm_publisher_create(&publisher, name, 0, slot_count);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_shm_publisher_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.freq_hz = freq_hz;
+	metadata.sample_rate_hz = sample_rate_hz;
+	metadata.lna_gain = (uint8_t)lna_gain;
+	metadata.vga_gain = (uint8_t)vga_gain;
+	metadata.amp_enable = (uint8_t)amp_enable;
+	hackrf_shm_publisher_set_metadata(publisher, &metadata);
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_shm_publisher_destroy(publisher);
+		return EXIT_FAILURE;
+	}
+	result = hackrf_open(&device);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_shm_publisher_destroy(publisher);
+		hackrf_exit();
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_set_sample_rate(device, sample_rate_hz);
+	result |= hackrf_set_baseband_filter_bandwidth(device,
+			hackrf_compute_baseband_filter_bw_round_down_lt(sample_rate_hz));
+	result |= hackrf_set_freq(device, freq_hz);
+	result |= hackrf_set_amp_enable(device, (uint8_t)amp_enable);
+	result |= hackrf_set_vga_gain(device, vga_gain);
+	result |= hackrf_set_lna_gain(device, lna_gain);
+	result |= hackrf_start_rx(device, hackrf_shm_publisher_rx_callback, publisher);
+	if( result != HACKRF_SUCCESS ) {
+		printf("device setup failed: %s (%d)\n", hackrf_error_name(result), result);
+	} else {
+		printf("publishing on %s, stop with Ctrl-C\n", name);
+		while( (hackrf_is_streaming(device) == HACKRF_TRUE) && (do_exit == false) ) {
+			sleep(1);
+		}
+		hackrf_stop_rx(device);
+	}
+
+	hackrf_close(device);
+	hackrf_exit();
+	hackrf_shm_publisher_destroy(publisher);
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
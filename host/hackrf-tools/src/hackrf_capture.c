@@ -0,0 +1,281 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Inspect .hrfc captures written by hackrf_transfer -C and cut samples out of
+   them by time or sample offset without reading the rest of the file. */
+
+#include <hackrf.h>
+#include <hackrf_capture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static void print_block(const uint64_t block, const hackrf_capture_metadata* m,
+		const uint64_t t0_ns)
+{
+	printf("block %" PRIu64 ": sample %" PRIu64 ", +%.6f s, %" PRIu64 " Hz, %u S/s,"
+			" lna %u, vga %u, txvga %u, amp %u, %u bytes\n",
+			block, m->sample_offset, (m->timestamp_ns - t0_ns) / 1e9, m->freq_hz,
+			m->sample_rate_hz, m->lna_gain, m->vga_gain, m->txvga_gain,
+			m->amp_enable, m->length);
+}
+
+/* Copy num_samples starting at sample_offset into out, 0 = to the end. */
+static int extract(hackrf_capture_reader* reader, FILE* out,
+		const uint64_t sample_offset, const uint64_t num_samples)
+{
+	const uint32_t block_size = hackrf_capture_reader_block_size(reader);
+	const uint64_t block_count = hackrf_capture_reader_block_count(reader);
+	hackrf_capture_metadata m;
+	uint64_t block;
+	uint64_t skip;
+	uint64_t remaining = num_samples * 2;
+	uint64_t n;
+	int8_t* buffer;
+	int result;
+
+	result = hackrf_capture_reader_find_sample(reader, sample_offset, &block);
+	if (result != HACKRF_SUCCESS) {
+		return result;
+	}
+	buffer = (int8_t*)malloc(block_size);
+	if (buffer == NULL) {
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	skip = (sample_offset * 2) % block_size;
+	for (; (block < block_count) && ((num_samples == 0) || (remaining > 0)); block++) {
+		result = hackrf_capture_reader_read_block(reader, block, &m, buffer);
+		if (result != HACKRF_SUCCESS) {
+			break;
+		}
+		if (skip >= m.length) {
+			break;
+		}
+		n = m.length - skip;
+		if ((num_samples != 0) && (n > remaining)) {
+			n = remaining;
+		}
+		if (fwrite(&buffer[skip], 1, (size_t)n, out) != n) {
+			result = HACKRF_ERROR_OTHER;
+			break;
+		}
+		remaining -= (num_samples != 0) ? n : 0;
+		skip = 0;
+	}
+
+	free(buffer);
+	return result;
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t-i <filename> # Input .hrfc capture.\n");
+	printf("\t[-l] # List the metadata of every block.\n");
+	printf("\t[-t ms] # Seek to this time after the start of the capture.\n");
+	printf("\t[-s sample] # Seek to this sample offset.\n");
+	printf("\t[-o <filename>] # Write raw IQ from the seek position.\n");
+	printf("\t[-n num_samples] # Number of samples to write (default: to the end).\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	const char* input = NULL;
+	const char* output = NULL;
+	bool list = false;
+	bool seek_time = false;
+	uint64_t time_ms = 0;
+	uint64_t sample_offset = 0;
+	uint64_t num_samples = 0;
+	uint64_t block_count;
+	uint64_t block;
+	uint64_t t0_ns;
+	hackrf_capture_metadata first, last, m;
+	hackrf_capture_reader* reader = NULL;
+	FILE* in;
+	FILE* out;
+
+	while( (opt = getopt(argc, argv, "i:lt:s:o:n:")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'i':
+			input = optarg;
+			break;
+
+		case 'l':
+			list = true;
+			break;
+
+		case 't':
+			seek_time = true;
+			result = parse_u64(optarg, &time_ms);
+			break;
+
+		case 's':
+			result = parse_u64(optarg, &sample_offset);
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'n':
+			result = parse_u64(optarg, &num_samples);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (input == NULL) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	in = fopen(input, "rb");
+	if (in == NULL) {
+		printf("Failed to open file: %s\n", input);
+		return EXIT_FAILURE;
+	}
+	result = hackrf_capture_reader_open(&reader, in);
+	if (result != HACKRF_SUCCESS) {
+		printf("hackrf_capture_reader_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		fclose(in);
+		return EXIT_FAILURE;
+	}
+
+	block_count = hackrf_capture_reader_block_count(reader);
+	printf("%" PRIu64 " blocks of %u bytes\n", block_count,
+			hackrf_capture_reader_block_size(reader));
+	if (block_count == 0) {
+		hackrf_capture_reader_close(reader);
+		fclose(in);
+		return EXIT_SUCCESS;
+	}
+
+	hackrf_capture_reader_read_block(reader, 0, &first, NULL);
+	hackrf_capture_reader_read_block(reader, block_count - 1, &last, NULL);
+	t0_ns = first.timestamp_ns;
+	printf("%" PRIu64 " samples, %.3f s\n",
+			last.sample_offset + last.length / 2,
+			(last.timestamp_ns - t0_ns) / 1e9);
+
+	if (list) {
+		for (block = 0; block < block_count; block++) {
+			if (hackrf_capture_reader_read_block(reader, block, &m, NULL) == HACKRF_SUCCESS) {
+				print_block(block, &m, t0_ns);
+			}
+		}
+	}
+
+	if (seek_time) {
+		result = hackrf_capture_reader_find_time(reader, t0_ns + time_ms * 1000000ULL, &block);
+		if (result == HACKRF_SUCCESS) {
+			result = hackrf_capture_reader_read_block(reader, block, &m, NULL);
+		}
+		if (result == HACKRF_SUCCESS) {
+			/* Refine within the block using its sample rate. */
+			sample_offset = m.sample_offset;
+			if (m.sample_rate_hz != 0) {
+				const uint64_t delta_ns = t0_ns + time_ms * 1000000ULL - m.timestamp_ns;
+				const uint64_t delta = (uint64_t)(delta_ns * 1e-9 * m.sample_rate_hz);
+				sample_offset += (delta < m.length / 2) ? delta : (m.length / 2 - 1);
+			}
+		}
+	} else if (sample_offset != 0 || output != NULL) {
+		result = hackrf_capture_reader_find_sample(reader, sample_offset, &block);
+		if (result == HACKRF_SUCCESS) {
+			result = hackrf_capture_reader_read_block(reader, block, &m, NULL);
+		}
+	}
+	if (result != HACKRF_SUCCESS) {
+		printf("seek failed: %s (%d)\n", hackrf_error_name(result), result);
+	} else if (seek_time || (sample_offset != 0) || (output != NULL)) {
+		printf("seek: sample %" PRIu64 " in ", sample_offset);
+		print_block(block, &m, t0_ns);
+	}
+
+	if ((result == HACKRF_SUCCESS) && (output != NULL)) {
+		out = fopen(output, "wb");
+		if (out == NULL) {
+			printf("Failed to open file: %s\n", output);
+			result = HACKRF_ERROR_OTHER;
+		} else {
+			result = extract(reader, out, sample_offset, num_samples);
+			fclose(out);
+			if (result != HACKRF_SUCCESS) {
+				printf("extract failed: %s (%d)\n", hackrf_error_name(result), result);
+			}
+		}
+	}
+
+	hackrf_capture_reader_close(reader);
+	fclose(in);
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
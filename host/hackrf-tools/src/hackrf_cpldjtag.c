@@ -30,16 +30,52 @@
 #include <sys/types.h>
 #include <stdint.h>
 
+#ifdef _WIN32
+#include <windows.h>
+
 #ifdef _MSC_VER
+
 #ifdef _WIN64
 typedef int64_t ssize_t;
 #else
 typedef int32_t ssize_t;
 #endif
+
+int gettimeofday(struct timeval *tv, void* ignored)
+{
+	FILETIME ft;
+	unsigned __int64 tmp = 0;
+	if (NULL != tv) {
+		GetSystemTimeAsFileTime(&ft);
+		tmp |= ft.dwHighDateTime;
+		tmp <<= 32;
+		tmp |= ft.dwLowDateTime;
+		tmp /= 10;
+		tmp -= 11644473600000000Ui64;
+		tv->tv_sec = (long)(tmp / 1000000UL);
+		tv->tv_usec = (long)(tmp % 1000000UL);
+	}
+	return 0;
+}
+
 #endif
+#endif
+
+#if defined(__GNUC__)
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+#if defined _WIN32
+	#define usleep(a) Sleep( (a)/1000 )
+#endif
+
 /* input file shouldn't be any longer than this */
 #define MAX_XSVF_LENGTH 0x10000
-#define PACKET_LEN	4096
+/* firmware cycle counter rate */
+#define CPU_CLOCK_HZ (204000000.0f)
+/* longest a CPLD is expected to take to program after the last data */
+#define STATUS_POLL_MAX (300)
 
 uint8_t data[MAX_XSVF_LENGTH];
 
@@ -76,6 +112,43 @@ int parse_int(char* s, uint32_t* const value)
 	}
 }
 
+static float TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+static struct timeval time_start;
+
+static void write_progress(void* ctx, uint32_t written, uint32_t total)
+{
+	struct timeval time_now;
+	float time_difference;
+
+	(void)ctx;
+	gettimeofday(&time_now, NULL);
+	time_difference = TimevalDiff(&time_now, &time_start);
+	printf("\rSent %u of %u bytes (%.1f KiB/s)", written, total,
+			(time_difference > 0) ? (written / 1024.0f / time_difference) : 0.0f);
+	fflush(stdout);
+}
+
+/* Waits for the firmware to finish the XSVF file, which it goes on playing
+   after the last chunk has been sent. */
+static int wait_for_cpld(hackrf_device* device, hackrf_cpld_status* status)
+{
+	int i;
+	int result;
+
+	for (i = 0; i < STATUS_POLL_MAX; i++) {
+		result = hackrf_cpld_status_read(device, status);
+		if ((result != HACKRF_SUCCESS) || (status->state != HACKRF_CPLD_BUSY)) {
+			return result;
+		}
+		usleep(100000);
+	}
+	return HACKRF_ERROR_OTHER;
+}
+
 static void usage()
 {
 	printf("Usage:\n");
@@ -94,6 +167,8 @@ int main(int argc, char** argv)
 	FILE* fd = NULL;
 	ssize_t bytes_read;
 	uint8_t* pdata = &data[0];
+	hackrf_cpld_status status;
+	struct timeval time_end;
 
 	while ((opt = getopt_long(argc, argv, "x:", long_options,
 			&option_index)) != EOF) {
@@ -167,7 +242,10 @@ int main(int argc, char** argv)
 
 	printf("LED1/2/3 blinking means CPLD program success.\nLED3/RED steady means error.\n");
 	printf("Wait message 'Write finished' or in case of LED3/RED steady, Power OFF/Disconnect the HackRF.\n");
-	result = hackrf_cpld_write(device, pdata, total_length);
+	gettimeofday(&time_start, NULL);
+	result = hackrf_cpld_write_with_progress(device, pdata, total_length,
+			write_progress, NULL);
+	printf("\n");
 	if (result != HACKRF_SUCCESS)
 	{
 		fprintf(stderr, "hackrf_cpld_write() failed: %s (%d)\n",
@@ -177,6 +255,28 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	result = wait_for_cpld(device, &status);
+	gettimeofday(&time_end, NULL);
+	if (result == HACKRF_SUCCESS) {
+		printf("CPLD %s (%u bytes, %.2f s).\n",
+				(status.state == HACKRF_CPLD_DONE) ? "programmed" : "programming failed",
+				status.received, TimevalDiff(&time_end, &time_start));
+		if (status.cycles != 0) {
+			printf("Firmware: %.2f s, %.0f%% of it waiting for USB.\n",
+					status.cycles / CPU_CLOCK_HZ,
+					100.0f * status.wait_cycles / status.cycles);
+		}
+		if (status.state != HACKRF_CPLD_DONE) {
+			fprintf(stderr, "XSVF player error %u.\n", status.error);
+			hackrf_close(device);
+			hackrf_exit();
+			fclose(fd);
+			return EXIT_FAILURE;
+		}
+	} else if (result == HACKRF_ERROR_OTHER) {
+		fprintf(stderr, "Timed out waiting for the CPLD to be programmed.\n");
+	}
+
 	printf("Write finished.\n");
 	printf("Please Power OFF/Disconnect the HackRF.\n");
 	fflush(stdout);
@@ -0,0 +1,306 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Reads and decodes the firmware event ring. */
+
+#include <hackrf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep(a) Sleep( (a*1000) )
+#else
+#include <unistd.h>
+#endif
+
+#define DEFAULT_CPU_MHZ (204)
+
+/* Firmware event log magic, "ELOG". */
+#define EVENT_LOG_MAGIC (0x474f4c45)
+
+static volatile bool do_exit = false;
+
+static hackrf_event_log event_log;
+
+/* Running time, unwrapped from the 32 bit cycle counter. */
+static uint64_t cycles = 0;
+static uint32_t last_timestamp = 0;
+static bool have_timestamp = false;
+
+#ifdef _MSC_VER
+BOOL WINAPI
+sighandler(int signum)
+{
+	if (CTRL_C_EVENT == signum) {
+		do_exit = true;
+		return TRUE;
+	}
+	return FALSE;
+}
+#else
+void sigint_callback_handler(int signum)
+{
+	(void)signum;
+	do_exit = true;
+}
+#endif
+
+int parse_u32(char* s, uint32_t* const value)
+{
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t ulong_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	ulong_value = strtoul(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = (uint32_t)ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static void print_args(const hackrf_event_log_entry* entry)
+{
+	static const char* const fault_names[] = { "hard", "mem manage", "bus", "usage" };
+	static const char* const gain_names[] = { "lna", "vga", "txvga" };
+	static const char* const mode_names[] = { "off", "rx", "tx" };
+
+	switch (entry->id)
+	{
+	case HACKRF_EVENT_BOOT:
+		printf("#%u", entry->arg[0]);
+		break;
+	case HACKRF_EVENT_FAULT:
+		printf("%s pc 0x%08x", (entry->arg[0] < 4) ? fault_names[entry->arg[0]] : "?",
+				entry->arg[1]);
+		break;
+	case HACKRF_EVENT_USB_BUS_RESET:
+		break;
+	case HACKRF_EVENT_USB_CONFIGURATION:
+		printf("%u", entry->arg[0]);
+		break;
+	case HACKRF_EVENT_USB_TRANSFER_ERROR:
+		printf("ep 0x%02x token 0x%08x", entry->arg[0], entry->arg[1]);
+		break;
+	case HACKRF_EVENT_USB_QUEUE_EXHAUSTED:
+	case HACKRF_EVENT_USB_QUEUE_MISSING:
+		printf("ep 0x%02x", entry->arg[0]);
+		break;
+	case HACKRF_EVENT_TRANSCEIVER_MODE:
+		printf("%s", (entry->arg[0] < 3) ? mode_names[entry->arg[0]] : "?");
+		break;
+	case HACKRF_EVENT_SET_FREQ:
+		printf("%" PRIu64 " Hz", (uint64_t)entry->arg[0] * 1000000 + entry->arg[1]);
+		break;
+	case HACKRF_EVENT_SET_FREQ_EXPLICIT:
+		printf("if %u kHz lo %u kHz", entry->arg[0], entry->arg[1]);
+		break;
+	case HACKRF_EVENT_SAMPLE_RATE:
+		printf("%u Hz / %u", entry->arg[0], entry->arg[1]);
+		break;
+	case HACKRF_EVENT_BASEBAND_FILTER:
+		printf("%u Hz", entry->arg[0]);
+		break;
+	case HACKRF_EVENT_GAIN:
+		printf("%s %u dB", (entry->arg[0] < 3) ? gain_names[entry->arg[0]] : "?",
+				entry->arg[1]);
+		break;
+	case HACKRF_EVENT_SGPIO_OVERRUN:
+		printf("offset %u", entry->arg[0]);
+		break;
+	default:
+		printf("0x%08x 0x%08x", entry->arg[0], entry->arg[1]);
+		break;
+	}
+}
+
+/* Prints the valid entries oldest first. The cycle counter restarts on
+ * boot, so the running time does too. Gaps longer than one counter wrap
+ * (about 21 s at 204 MHz) cannot be told apart and come out short. */
+static void print_log(const uint32_t cpu_mhz)
+{
+	const uint32_t valid = (event_log.index < HACKRF_EVENT_LOG_LENGTH)
+		? event_log.index : HACKRF_EVENT_LOG_LENGTH;
+	uint32_t i;
+
+	for (i = event_log.index - valid; i != event_log.index; i++)
+	{
+		const hackrf_event_log_entry* const entry =
+			&event_log.entries[i % HACKRF_EVENT_LOG_LENGTH];
+
+		if ((entry->id == HACKRF_EVENT_BOOT) || !have_timestamp) {
+			cycles = entry->timestamp;
+		} else {
+			cycles += (uint32_t)(entry->timestamp - last_timestamp);
+		}
+		last_timestamp = entry->timestamp;
+		have_timestamp = true;
+
+		printf("%12.6f %-20s ", (double)cycles / (cpu_mhz * 1e6),
+				hackrf_event_log_name((enum hackrf_event)entry->id));
+		print_args(entry);
+		printf("\n");
+	}
+	if (event_log.dropped) {
+		printf("(%u events dropped while reading)\n", event_log.dropped);
+	}
+	fflush(stdout);
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-f] # Follow: keep reading and print new events until interrupted.\n");
+	printf("\t[-C] # Clear the log after reading it.\n");
+	printf("\t[-i seconds] # Interval between reads with -f (default 1).\n");
+	printf("\t[-c cpu_mhz] # M4 clock used to convert cycles to time (default %d).\n", DEFAULT_CPU_MHZ);
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	hackrf_device* device = NULL;
+	uint32_t interval = 1;
+	uint32_t cpu_mhz = DEFAULT_CPU_MHZ;
+	bool follow = false;
+	bool clear = false;
+
+	while( (opt = getopt(argc, argv, "fCi:c:")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'f':
+			follow = true;
+			break;
+
+		case 'C':
+			clear = true;
+			break;
+
+		case 'i':
+			result = parse_u32(optarg, &interval);
+			break;
+
+		case 'c':
+			result = parse_u32(optarg, &cpu_mhz);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS )
+		{
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg,
+					hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (interval == 0) || (cpu_mhz == 0) )
+	{
+		printf("argument error: interval and cpu_mhz must be nonzero\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_init();
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_init() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_open(&device);
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_open() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		hackrf_exit();
+		return EXIT_FAILURE;
+	}
+
+#ifdef _MSC_VER
+	SetConsoleCtrlHandler( (PHANDLER_ROUTINE) sighandler, TRUE );
+#else
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+#endif
+
+	/* Following clears after every read so each one only returns new events. */
+	result = hackrf_event_log_read(device, &event_log, (clear || follow) ? 1 : 0);
+	if ((result == HACKRF_SUCCESS) && (event_log.magic != EVENT_LOG_MAGIC)) {
+		fprintf(stderr, "event log not initialised, firmware too old?\n");
+		result = HACKRF_ERROR_OTHER;
+	}
+	if (result == HACKRF_SUCCESS) {
+		printf("%u events logged, %u boots\n", event_log.index, event_log.boots);
+		print_log(cpu_mhz);
+	}
+
+	while( follow && (result == HACKRF_SUCCESS) && !do_exit )
+	{
+		sleep(interval);
+		result = hackrf_event_log_read(device, &event_log, 1);
+		if (result == HACKRF_SUCCESS) {
+			print_log(cpu_mhz);
+		}
+	}
+
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_event_log_read() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+	}
+
+	hackrf_close(device);
+	hackrf_exit();
+
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Compress, decompress and benchmark HackRF IQ captures in the .iqz format. */
+
+#include <hackrf.h>
+#include <hackrf_iqz.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+
+#ifdef _MSC_VER
+int gettimeofday(struct timeval *tv, void* ignored)
+{
+	FILETIME ft;
+	unsigned __int64 tmp = 0;
+	if (NULL != tv) {
+		GetSystemTimeAsFileTime(&ft);
+		tmp |= ft.dwHighDateTime;
+		tmp <<= 32;
+		tmp |= ft.dwLowDateTime;
+		tmp /= 10;
+		tmp -= 11644473600000000Ui64;
+		tv->tv_sec = (long)(tmp / 1000000UL);
+		tv->tv_usec = (long)(tmp % 1000000UL);
+	}
+	return 0;
+}
+#endif
+#endif
+
+#if defined(__GNUC__)
+#include <sys/time.h>
+#endif
+
+#define IO_BUFFER_SIZE (262144)
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static int compress_file(FILE* in, FILE* out, const uint32_t block_size,
+		const uint32_t threads, uint64_t* raw_bytes, uint64_t* compressed_bytes)
+{
+	hackrf_iqz_writer* writer = NULL;
+	static int8_t buffer[IO_BUFFER_SIZE];
+	size_t n;
+	int result;
+
+	result = hackrf_iqz_writer_create(&writer, out, block_size, threads);
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_iqz_writer_create() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		return result;
+	}
+
+	while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+		result = hackrf_iqz_writer_write(writer, buffer, (uint32_t)n);
+		if (result != HACKRF_SUCCESS) {
+			fprintf(stderr, "hackrf_iqz_writer_write() failed: %s (%d)\n",
+					hackrf_error_name(result), result);
+			break;
+		}
+	}
+
+	hackrf_iqz_writer_stats(writer, raw_bytes, NULL);
+	if (result == HACKRF_SUCCESS) {
+		result = hackrf_iqz_writer_close(writer);
+		if (result != HACKRF_SUCCESS) {
+			fprintf(stderr, "hackrf_iqz_writer_close() failed: %s (%d)\n",
+					hackrf_error_name(result), result);
+		}
+	} else {
+		hackrf_iqz_writer_close(writer);
+	}
+	*compressed_bytes = (uint64_t)ftell(out);
+	return result;
+}
+
+static int decompress_file(FILE* in, FILE* out, const uint64_t first,
+		const uint64_t count, uint64_t* raw_bytes)
+{
+	hackrf_iqz_reader* reader = NULL;
+	int8_t* buffer;
+	uint64_t block, last;
+	uint32_t length;
+	int result;
+
+	result = hackrf_iqz_reader_open(&reader, in);
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_iqz_reader_open() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		return result;
+	}
+
+	buffer = (int8_t*)malloc(hackrf_iqz_reader_block_size(reader));
+	if (buffer == NULL) {
+		hackrf_iqz_reader_close(reader);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	last = hackrf_iqz_reader_block_count(reader);
+	if ((count != 0) && ((first + count) < last)) {
+		last = first + count;
+	}
+
+	*raw_bytes = 0;
+	for (block = first; block < last; block++) {
+		result = hackrf_iqz_reader_read_block(reader, block, buffer, &length);
+		if (result != HACKRF_SUCCESS) {
+			fprintf(stderr, "block %" PRIu64 ": hackrf_iqz_reader_read_block() failed: %s (%d)\n",
+					block, hackrf_error_name(result), result);
+			break;
+		}
+		if ((out != NULL) && (fwrite(buffer, 1, length, out) != length)) {
+			fprintf(stderr, "write failed\n");
+			result = HACKRF_ERROR_OTHER;
+			break;
+		}
+		*raw_bytes += length;
+	}
+
+	free(buffer);
+	hackrf_iqz_reader_close(reader);
+	return result;
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t-c # Compress raw HackRF IQ (as written by hackrf_transfer -r) to .iqz.\n");
+	printf("\t-d # Decompress .iqz to raw IQ.\n");
+	printf("\t-b # Benchmark: compress and decompress, report ratio and throughput.\n");
+	printf("\t-i <filename> # Input file.\n");
+	printf("\t[-o <filename>] # Output file (required for -c and -d).\n");
+	printf("\t[-j threads] # Compression threads (default 1, 0 = no worker threads).\n");
+	printf("\t[-B block_size] # Raw bytes per block (default %u).\n", HACKRF_IQZ_DEFAULT_BLOCK_SIZE);
+	printf("\t[-s first_block] # Decompress starting at this block.\n");
+	printf("\t[-n num_blocks] # Decompress only this many blocks.\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	char mode = 0;
+	const char* input = NULL;
+	const char* output = NULL;
+	uint64_t threads = 1;
+	uint64_t block_size = 0;
+	uint64_t first_block = 0;
+	uint64_t num_blocks = 0;
+	uint64_t raw_bytes = 0, compressed_bytes = 0, decoded_bytes = 0;
+	struct timeval t_start, t_end;
+	float elapsed;
+	FILE* in;
+	FILE* out;
+
+	while( (opt = getopt(argc, argv, "cdbi:o:j:B:s:n:")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'c':
+		case 'd':
+		case 'b':
+			mode = (char)opt;
+			break;
+
+		case 'i':
+			input = optarg;
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'j':
+			result = parse_u64(optarg, &threads);
+			break;
+
+		case 'B':
+			result = parse_u64(optarg, &block_size);
+			break;
+
+		case 's':
+			result = parse_u64(optarg, &first_block);
+			break;
+
+		case 'n':
+			result = parse_u64(optarg, &num_blocks);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((mode == 0) || (input == NULL) || ((mode != 'b') && (output == NULL))) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	in = fopen(input, "rb");
+	if (in == NULL) {
+		printf("Failed to open file: %s\n", input);
+		return EXIT_FAILURE;
+	}
+
+	if (mode == 'd') {
+		out = fopen(output, "wb");
+		if (out == NULL) {
+			printf("Failed to open file: %s\n", output);
+			fclose(in);
+			return EXIT_FAILURE;
+		}
+		gettimeofday(&t_start, NULL);
+		result = decompress_file(in, out, first_block, num_blocks, &decoded_bytes);
+		gettimeofday(&t_end, NULL);
+		elapsed = TimevalDiff(&t_end, &t_start);
+		fclose(out);
+		printf("decompressed %" PRIu64 " bytes in %5.3f s, %.1f MB/s\n",
+				decoded_bytes, elapsed, decoded_bytes / elapsed / 1e6);
+	} else {
+		out = (output != NULL) ? fopen(output, (mode == 'b') ? "w+b" : "wb") : tmpfile();
+		if (out == NULL) {
+			printf("Failed to open output file\n");
+			fclose(in);
+			return EXIT_FAILURE;
+		}
+
+		gettimeofday(&t_start, NULL);
+		result = compress_file(in, out, (uint32_t)block_size, (uint32_t)threads,
+				&raw_bytes, &compressed_bytes);
+		gettimeofday(&t_end, NULL);
+		elapsed = TimevalDiff(&t_end, &t_start);
+		printf("compressed %" PRIu64 " -> %" PRIu64 " bytes (%.3fx) in %5.3f s, %.1f MB/s with %u threads\n",
+				raw_bytes, compressed_bytes,
+				(compressed_bytes > 0) ? ((double)raw_bytes / compressed_bytes) : 0.0,
+				elapsed, raw_bytes / elapsed / 1e6, (uint32_t)threads);
+
+		if ((result == HACKRF_SUCCESS) && (mode == 'b')) {
+			gettimeofday(&t_start, NULL);
+			result = decompress_file(out, NULL, 0, 0, &decoded_bytes);
+			gettimeofday(&t_end, NULL);
+			elapsed = TimevalDiff(&t_end, &t_start);
+			printf("decompressed %" PRIu64 " bytes in %5.3f s, %.1f MB/s\n",
+					decoded_bytes, elapsed, decoded_bytes / elapsed / 1e6);
+			if ((result == HACKRF_SUCCESS) && (decoded_bytes != raw_bytes)) {
+				printf("length mismatch\n");
+				result = HACKRF_ERROR_OTHER;
+			}
+		}
+		fclose(out);
+	}
+
+	fclose(in);
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Live view of the firmware cycle counters: how much of the M4 the SGPIO
+ * and USB ISRs use while streaming, and how close SGPIO runs to USB in the
+ * bulk buffer. Start streaming from another tool (e.g. hackrf_transfer). */
+
+#include <hackrf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep(a) Sleep( (a*1000) )
+
+#ifdef _MSC_VER
+int gettimeofday(struct timeval *tv, void* ignored)
+{
+	FILETIME ft;
+	unsigned __int64 tmp = 0;
+	if (NULL != tv) {
+		GetSystemTimeAsFileTime(&ft);
+		tmp |= ft.dwHighDateTime;
+		tmp <<= 32;
+		tmp |= ft.dwLowDateTime;
+		tmp /= 10;
+		tmp -= 11644473600000000Ui64;
+		tv->tv_sec = (long)(tmp / 1000000UL);
+		tv->tv_usec = (long)(tmp % 1000000UL);
+	}
+	return 0;
+}
+#endif
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__)
+#include <sys/time.h>
+#endif
+
+#define DEFAULT_CPU_MHZ (204)
+
+/* Half of the firmware's 32 KiB bulk buffer, the most slack there can be. */
+#define BULK_HALF_LENGTH (16384)
+
+static volatile bool do_exit = false;
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+#ifdef _MSC_VER
+BOOL WINAPI
+sighandler(int signum)
+{
+	if (CTRL_C_EVENT == signum) {
+		do_exit = true;
+		return TRUE;
+	}
+	return FALSE;
+}
+#else
+void sigint_callback_handler(int signum)
+{
+	(void)signum;
+	do_exit = true;
+}
+#endif
+
+int parse_u32(char* s, uint32_t* const value)
+{
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t ulong_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	ulong_value = strtoul(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = (uint32_t)ulong_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+static double print_counter(const char* name, const hackrf_perf_counter* counter,
+		const double window, const uint32_t cpu_mhz)
+{
+	const double load = (window > 0.0) ? (100.0 * counter->total / window) : 0.0;
+
+	if (counter->count == 0)
+	{
+		printf("%-10s %10u %8s %8s %8s %8s %6.1f%%\n", name, 0, "-", "-", "-", "-", 0.0);
+		return 0.0;
+	}
+	printf("%-10s %10u %8u %8.1f %8u %8.2f %6.1f%%\n", name, counter->count,
+			counter->min, (double)counter->total / counter->count,
+			counter->max, (double)counter->max / cpu_mhz, load);
+	return load;
+}
+
+static void print_queue(const char* name, const hackrf_usb_queue_stats* stats,
+		const uint32_t cpu_mhz)
+{
+	printf("%s queue: depth %u, high water %u, pool full %u times, "
+			"spun %.2f us\n", name, stats->depth, stats->high_water,
+			stats->alloc_failures, (double)stats->spin_cycles / cpu_mhz);
+}
+
+/* The firmware cycle counter stops while the M4 sleeps, so loads are taken
+ * against the wall clock interval measured here. */
+static void print_perf(const hackrf_perf* perf, const uint32_t cpu_mhz,
+		const float seconds)
+{
+	const double window = seconds * cpu_mhz * 1e6;
+	double awake = (window > 0.0) ? (100.0 * perf->cycles / window) : 100.0;
+	double busy = 0.0;
+
+	if (awake > 100.0)
+		awake = 100.0;
+
+	printf("interval %.3f s, awake %u cycles, %u sleeps\n", seconds,
+			perf->cycles, perf->sleeps);
+	printf("%-10s %10s %8s %8s %8s %8s %7s\n",
+			"cycles", "count", "min", "avg", "max", "max us", "load");
+	busy += print_counter("sgpio_isr", &perf->sgpio_isr, window, cpu_mhz);
+	busy += print_counter("usb_isr", &perf->usb_isr, window, cpu_mhz);
+	busy += print_counter("main_loop", &perf->main_loop, window, cpu_mhz);
+	printf("%-10s %54.1f%%\n", "idle", (busy < awake) ? (awake - busy) : 0.0);
+	printf("%-10s %54.1f%%\n", "asleep", 100.0 - awake);
+
+	if (perf->latency.count == 0)
+	{
+		printf("latency: no bulk transfers\n");
+	} else {
+		printf("latency: min %u avg %.1f max %u cycles (max %.2f us)\n",
+				perf->latency.min, (double)perf->latency.total / perf->latency.count,
+				perf->latency.max, (double)perf->latency.max / cpu_mhz);
+	}
+	if (perf->slack.count == 0)
+	{
+		printf("slack: no bulk transfers, overruns %u\n", perf->overruns);
+	} else {
+		printf("slack: min %u avg %.0f max %u of %u bytes, overruns %u\n",
+				perf->slack.min, (double)perf->slack.total / perf->slack.count,
+				perf->slack.max, BULK_HALF_LENGTH, perf->overruns);
+	}
+	print_queue("bulk in", &perf->bulk_in, cpu_mhz);
+	print_queue("bulk out", &perf->bulk_out, cpu_mhz);
+	printf("\n");
+	fflush(stdout);
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-i seconds] # Interval between reads (default 1).\n");
+	printf("\t[-n count] # Number of reads, 0 for until interrupted (default 0).\n");
+	printf("\t[-c cpu_mhz] # M4 clock used to convert cycles to time (default %d).\n", DEFAULT_CPU_MHZ);
+	printf("\t[-a] # Accumulate instead of clearing the counters after each read.\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	hackrf_device* device = NULL;
+	hackrf_perf perf;
+	uint32_t interval = 1;
+	uint32_t count = 0;
+	uint32_t cpu_mhz = DEFAULT_CPU_MHZ;
+	uint32_t reads = 0;
+	bool accumulate = false;
+	struct timeval t_start, t_now;
+
+	while( (opt = getopt(argc, argv, "i:n:c:a")) != EOF )
+	{
+		result = HACKRF_SUCCESS;
+		switch( opt )
+		{
+		case 'i':
+			result = parse_u32(optarg, &interval);
+			break;
+
+		case 'n':
+			result = parse_u32(optarg, &count);
+			break;
+
+		case 'c':
+			result = parse_u32(optarg, &cpu_mhz);
+			break;
+
+		case 'a':
+			accumulate = true;
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS )
+		{
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg,
+					hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (interval == 0) || (cpu_mhz == 0) )
+	{
+		printf("argument error: interval and cpu_mhz must be nonzero\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	/* The firmware counts cycles in 32 bits. */
+	if( ((uint64_t)interval * cpu_mhz * 1000000) >> 32 )
+	{
+		printf("argument error: interval must be under %u s at %u MHz\n",
+				(uint32_t)(0xffffffffull / (cpu_mhz * 1000000ull)), cpu_mhz);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_init();
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_init() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_open(&device);
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_open() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+		hackrf_exit();
+		return EXIT_FAILURE;
+	}
+
+#ifdef _MSC_VER
+	SetConsoleCtrlHandler( (PHANDLER_ROUTINE) sighandler, TRUE );
+#else
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+#endif
+
+	/* Start the first interval now rather than at the last clear. */
+	result = hackrf_perf_read(device, &perf, accumulate ? 0 : 1);
+	gettimeofday(&t_start, NULL);
+	while( (result == HACKRF_SUCCESS) && !do_exit
+			&& ((count == 0) || (reads < count)) )
+	{
+		sleep(interval);
+		result = hackrf_perf_read(device, &perf, accumulate ? 0 : 1);
+		gettimeofday(&t_now, NULL);
+		if (result == HACKRF_SUCCESS)
+		{
+			print_perf(&perf, cpu_mhz, TimevalDiff(&t_now, &t_start));
+			if (!accumulate)
+				t_start = t_now;
+			reads++;
+		}
+	}
+
+	if (result != HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_perf_read() failed: %s (%d)\n",
+				hackrf_error_name(result), result);
+	}
+
+	hackrf_close(device);
+	hackrf_exit();
+
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -45,12 +45,16 @@ typedef int32_t ssize_t;
 
 /* 8 Mbit flash */
 #define MAX_LENGTH 0x100000
+/* smallest unit the firmware erases in bulk mode */
+#define SECTOR_LENGTH 0x1000
+#define SECTOR_COUNT (MAX_LENGTH / SECTOR_LENGTH)
 
 static struct option long_options[] = {
 	{ "address", required_argument, 0, 'a' },
 	{ "length", required_argument, 0, 'l' },
 	{ "read", required_argument, 0, 'r' },
 	{ "write", required_argument, 0, 'w' },
+	{ "check", required_argument, 0, 'c' },
 	{ 0, 0, 0, 0 },
 };
 
@@ -82,6 +86,83 @@ int parse_u32(char* s, uint32_t* const value)
 	}
 }
 
+/* CRC-32 as computed by the firmware (and zlib) */
+static uint32_t crc32(uint32_t crc, const uint8_t* data, uint32_t length)
+{
+	static const uint32_t nibble_table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+		0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+		0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+	};
+	uint32_t i;
+
+	crc = ~crc;
+	for (i = 0; i < length; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+		crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+/* Compares flash with data one sector at a time using CRCs computed on the
+ * device. Returns the number of sectors that differ, marking them in
+ * differs, or a negative hackrf_error if the firmware cannot do it.
+ */
+static int compare_sectors(hackrf_device* device, const uint32_t address,
+		const uint32_t length, const uint8_t* data, bool* differs)
+{
+	static uint32_t crcs[SECTOR_COUNT];
+	const uint32_t count = (length + SECTOR_LENGTH - 1) / SECTOR_LENGTH;
+	uint32_t i;
+	int differing = 0;
+	int result;
+
+	result = hackrf_spiflash_crc(device, address, length, crcs);
+	if (result != HACKRF_SUCCESS)
+		return result;
+
+	for (i = 0; i < count; i++) {
+		const uint32_t offset = i * SECTOR_LENGTH;
+		const uint32_t sector_length = ((length - offset) < SECTOR_LENGTH)
+				? (length - offset) : SECTOR_LENGTH;
+		differs[i] = (crcs[i] != crc32(0, &data[offset], sector_length));
+		if (differs[i])
+			differing++;
+	}
+	return differing;
+}
+
+/* Writes one run of sectors over the bulk endpoint. Sets unsupported rather
+ * than reporting an error if the firmware does not know the request.
+ */
+static int write_bulk(hackrf_device* device, const uint32_t address,
+		const uint32_t length, uint8_t* data, bool* unsupported)
+{
+	hackrf_spiflash_status status;
+	int result;
+
+	*unsupported = false;
+	printf("Writing %d bytes at 0x%06x over the bulk endpoint.\n",
+			length, address);
+	result = hackrf_spiflash_write_bulk(device, address, length, data, &status);
+	if (result == HACKRF_SUCCESS) {
+		printf("%u sectors erased, %u unchanged, %u pages programmed, "
+				"CRC 0x%08x verified.\n", status.sectors_erased,
+				status.sectors_unchanged, status.pages_programmed,
+				status.crc_flash);
+	} else if (hackrf_spiflash_status_read(device, &status) == HACKRF_SUCCESS) {
+		fprintf(stderr, "hackrf_spiflash_write_bulk() failed: %s (%d), "
+				"%u of %u bytes received, flash CRC 0x%08x\n",
+				hackrf_error_name(result), result, status.received,
+				status.length, status.crc_flash);
+	} else {
+		*unsupported = true;
+	}
+	return result;
+}
+
 static void usage()
 {
 	printf("Usage:\n");
@@ -89,6 +170,7 @@ static void usage()
 	printf("\t-l, --length <n>: number of bytes to read (default: 0)\n");
 	printf("\t-r <filename>: Read data into file.\n");
 	printf("\t-w <filename>: Write data from file.\n");
+	printf("\t-c <filename>: Check whether flash matches file, without writing.\n");
 }
 
 int main(int argc, char** argv)
@@ -107,8 +189,13 @@ int main(int argc, char** argv)
 	FILE* fd = NULL;
 	bool read = false;
 	bool write = false;
+	bool check = false;
+	bool bulk = false;
+	bool mismatch = false;
+	static bool differs[SECTOR_COUNT];
+	int differing = -1;
 
-	while ((opt = getopt_long(argc, argv, "a:l:r:w:", long_options,
+	while ((opt = getopt_long(argc, argv, "a:l:r:w:c:", long_options,
 			&option_index)) != EOF) {
 		switch (opt) {
 		case 'a':
@@ -129,6 +216,11 @@ int main(int argc, char** argv)
 			path = optarg;
 			break;
 
+		case 'c':
+			check = true;
+			path = optarg;
+			break;
+
 		default:
 			fprintf(stderr, "opt error: %d\n", opt);
 			usage();
@@ -143,11 +235,11 @@ int main(int argc, char** argv)
 		}
 	}
 
-	if (write == read) {
-		if (write == true) {
-			fprintf(stderr, "Read and write options are mutually exclusive.\n");
+	if ((read + write + check) != 1) {
+		if (read || write || check) {
+			fprintf(stderr, "Read, write and check options are mutually exclusive.\n");
 		} else {
-			fprintf(stderr, "Specify either read or write option.\n");
+			fprintf(stderr, "Specify a read, write or check option.\n");
 		}
 		usage();
 		return EXIT_FAILURE;
@@ -159,7 +251,7 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}	
 	
-	if( write )
+	if( write || check )
 	{
 		fd = fopen(path, "rb");
 		if(fd == NULL)
@@ -224,6 +316,16 @@ int main(int argc, char** argv)
 	{
 		ssize_t bytes_written;
 		tmp_length = length;
+		printf("Reading %d bytes from 0x%06x over the bulk endpoint.\n",
+				length, address);
+		result = hackrf_spiflash_read_bulk(device, address, length, pdata);
+		if (result == HACKRF_SUCCESS) {
+			tmp_length = 0;
+		} else {
+			printf("hackrf_spiflash_read_bulk() failed: %s (%d), "
+					"reading with control transfers.\n",
+					hackrf_error_name(result), result);
+		}
 		while (tmp_length) 
 		{
 			xfer_len = (tmp_length > 256) ? 256 : tmp_length;
@@ -257,6 +359,70 @@ int main(int argc, char** argv)
 			fd = NULL;
 			return EXIT_FAILURE;
 		}
+		if ((address % SECTOR_LENGTH) == 0) {
+			differing = compare_sectors(device, address, length, pdata, differs);
+			if (differing == 0) {
+				printf("Flash already matches %s.\n", path);
+			} else if (differing > 0) {
+				printf("%d of %u sectors differ.\n", differing,
+						(length + SECTOR_LENGTH - 1) / SECTOR_LENGTH);
+			}
+		}
+		if (check) {
+			if (differing < 0) {
+				fprintf(stderr, "Firmware cannot checksum the flash%s.\n",
+						(address % SECTOR_LENGTH) ? " at an unaligned address" : "");
+				fclose(fd);
+				fd = NULL;
+				return EXIT_FAILURE;
+			}
+			mismatch = (differing != 0);
+		} else if (differing == 0) {
+			bulk = true;
+		} else if (differing > 0) {
+			/* Rewrite each run of differing sectors */
+			uint32_t first = 0;
+			bool unsupported = false;
+			const uint32_t count = (length + SECTOR_LENGTH - 1) / SECTOR_LENGTH;
+			while (first < count) {
+				uint32_t end = first;
+				if (!differs[first]) {
+					first++;
+					continue;
+				}
+				while ((end < count) && differs[end])
+					end++;
+				result = write_bulk(device, address + first * SECTOR_LENGTH,
+						((end * SECTOR_LENGTH) < length)
+						? ((end - first) * SECTOR_LENGTH)
+						: (length - first * SECTOR_LENGTH),
+						&pdata[first * SECTOR_LENGTH], &unsupported);
+				if (result != HACKRF_SUCCESS)
+					break;
+				first = end;
+			}
+			if ((result != HACKRF_SUCCESS) && !unsupported) {
+				fclose(fd);
+				fd = NULL;
+				return EXIT_FAILURE;
+			}
+			bulk = (result == HACKRF_SUCCESS);
+		} else if ((address % SECTOR_LENGTH) == 0) {
+			bool unsupported;
+			result = write_bulk(device, address, length, pdata, &unsupported);
+			if ((result != HACKRF_SUCCESS) && !unsupported) {
+				fclose(fd);
+				fd = NULL;
+				return EXIT_FAILURE;
+			}
+			bulk = (result == HACKRF_SUCCESS);
+		}
+		if (write && !bulk && ((address % SECTOR_LENGTH) == 0)) {
+			printf("Firmware has no bulk SPI flash support, "
+					"writing with control transfers.\n");
+		}
+	}
+	if (write && !bulk) {
 		printf("Erasing SPI flash.\n");
 		result = hackrf_spiflash_erase(device);
 		if (result != HACKRF_SUCCESS) {
@@ -298,5 +464,5 @@ int main(int argc, char** argv)
 		fclose(fd);
 	}
 
-	return EXIT_SUCCESS;
+	return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
 }
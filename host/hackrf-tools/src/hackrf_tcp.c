@@ -0,0 +1,1066 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Serve HackRF samples to local network clients over TCP or a Unix socket.
+ *
+ * Every message in either direction starts with a 16 byte frame header
+ * (hackrf_tcp_frame_t, host byte order) and carries `length` payload bytes:
+ *
+ *   server -> client
+ *     HELLO     on connect, value = sample rate in Hz, length = 0
+ *     RX_DATA   value = sample offset of the first sample since the stream
+ *               started, payload = interleaved signed 8 bit I/Q. A client
+ *               that cannot keep up loses whole frames, visible as a jump
+ *               in the sample offset.
+ *     REPLY     answer to a SET_* command, value = hackrf_error result
+ *
+ *   client -> server
+ *     TX_DATA   payload = I/Q to transmit (-t mode, first client only)
+ *     SET_*     value = the argument to the matching hackrf_set_*() call
+ *
+ * RX blocks are sent straight from the libusb transfer buffer with
+ * sendmsg(), so the host keeps a single copy of the samples however many
+ * clients are connected. Only the unsent tail of a partially accepted
+ * frame is ever copied.
+ */
+
+#include <hackrf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL (0)
+#endif
+
+#define DEFAULT_PORT (1235)
+#define DEFAULT_ADDRESS "127.0.0.1"
+#define DEFAULT_FREQ_HZ (900000000ull)
+#define DEFAULT_SAMPLE_RATE_HZ (10000000)
+
+#define MAX_CLIENTS (16)
+/* Same size as the libhackrf USB transfer buffers. */
+#define BLOCK_LENGTH (262144)
+#define SOCKET_BUFFER_SIZE (4194304)
+/* Room for the tail of one data frame plus queued replies. */
+#define BACKLOG_SIZE (BLOCK_LENGTH + 4096)
+#define TX_RING_SIZE (8388608)
+
+enum {
+	HACKRF_TCP_HELLO = 1,
+	HACKRF_TCP_RX_DATA = 2,
+	HACKRF_TCP_REPLY = 3,
+	HACKRF_TCP_TX_DATA = 16,
+	HACKRF_TCP_SET_FREQ = 17,
+	HACKRF_TCP_SET_SAMPLE_RATE = 18,
+	HACKRF_TCP_SET_BASEBAND_FILTER = 19,
+	HACKRF_TCP_SET_LNA_GAIN = 20,
+	HACKRF_TCP_SET_VGA_GAIN = 21,
+	HACKRF_TCP_SET_TXVGA_GAIN = 22,
+	HACKRF_TCP_SET_AMP_ENABLE = 23,
+};
+
+typedef struct {
+	uint32_t type;
+	uint32_t length;
+	uint64_t value;
+} hackrf_tcp_frame_t;
+
+typedef struct {
+	int fd;
+	bool dead;
+	/* Send side, under clients_lock. Unsent tail of a frame: new RX frames
+	   are dropped for this client until it drains. */
+	uint8_t* backlog;
+	uint32_t backlog_length;
+	uint32_t backlog_pos;
+	uint64_t bytes_sent;
+	uint64_t frames_dropped;
+	/* Receive side, main thread only. */
+	hackrf_tcp_frame_t in;
+	uint32_t in_fill;
+	uint32_t payload_remaining;
+} client_t;
+
+static volatile bool do_exit = false;
+static hackrf_device* device = NULL;
+static uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+
+static pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+static client_t* clients[MAX_CLIENTS];
+static uint64_t sample_offset = 0;
+static volatile uint32_t byte_count = 0;
+
+/* TX mode: samples from the first client wait here for tx_callback(). */
+static bool tx_mode = false;
+static client_t* tx_client = NULL;
+static pthread_mutex_t tx_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t* tx_ring = NULL;
+static uint64_t tx_head = 0;
+static uint64_t tx_tail = 0;
+static uint64_t tx_underruns = 0;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stdout, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u32(char* s, uint32_t* const value) {
+	uint64_t u64_value = 0;
+	int result = parse_u64(s, &u64_value);
+	if( (result == HACKRF_SUCCESS) && (u64_value > 0xffffffffull) ) {
+		result = HACKRF_ERROR_INVALID_PARAM;
+	}
+	*value = (uint32_t)u64_value;
+	return result;
+}
+
+/* Sending. All under clients_lock. */
+
+static bool client_flush(client_t* c)
+{
+	ssize_t n;
+
+	while (c->backlog_pos < c->backlog_length)
+	{
+		n = send(c->fd, &c->backlog[c->backlog_pos], c->backlog_length - c->backlog_pos,
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+		}
+		c->backlog_pos += (uint32_t)n;
+		c->bytes_sent += n;
+	}
+	c->backlog_pos = 0;
+	c->backlog_length = 0;
+	return true;
+}
+
+/* droppable: an RX frame that may be skipped when the client is behind.
+   Anything else is queued behind the backlog. */
+static bool client_send(client_t* c, const hackrf_tcp_frame_t* frame,
+		const void* payload, const bool droppable)
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	const uint32_t total = sizeof(*frame) + frame->length;
+	uint32_t sent = 0;
+	uint32_t header_left;
+	ssize_t n;
+
+	if (!client_flush(c))
+	{
+		return false;
+	}
+
+	if (c->backlog_length == 0)
+	{
+		iov[0].iov_base = (void*)frame;
+		iov[0].iov_len = sizeof(*frame);
+		iov[1].iov_base = (void*)payload;
+		iov[1].iov_len = frame->length;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = (frame->length > 0) ? 2 : 1;
+
+		n = sendmsg(c->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+			{
+				return false;
+			}
+			n = 0;
+		}
+		sent = (uint32_t)n;
+		c->bytes_sent += sent;
+		if (sent == total)
+		{
+			return true;
+		}
+		if ((sent == 0) && droppable)
+		{
+			c->frames_dropped++;
+			return true;
+		}
+	} else if (droppable) {
+		c->frames_dropped++;
+		return true;
+	}
+
+	/* Keep the rest so the stream stays framed. */
+	if ((c->backlog_length + (total - sent)) > BACKLOG_SIZE)
+	{
+		return false;
+	}
+	if (sent < sizeof(*frame))
+	{
+		header_left = sizeof(*frame) - sent;
+		memcpy(&c->backlog[c->backlog_length], (const uint8_t*)frame + sent, header_left);
+		c->backlog_length += header_left;
+		sent = sizeof(*frame);
+	}
+	memcpy(&c->backlog[c->backlog_length],
+			(const uint8_t*)payload + (sent - sizeof(*frame)), total - sent);
+	c->backlog_length += total - sent;
+	return true;
+}
+
+/* Fan one block out to every RX client. */
+static void serve_block(const uint8_t* samples, const uint32_t length)
+{
+	hackrf_tcp_frame_t frame;
+	uint32_t i;
+
+	frame.type = HACKRF_TCP_RX_DATA;
+	frame.length = length;
+
+	pthread_mutex_lock(&clients_lock);
+	frame.value = sample_offset;
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		client_t* const c = clients[i];
+		if ((c != NULL) && !c->dead && !client_send(c, &frame, samples, true))
+		{
+			c->dead = true;
+		}
+	}
+	sample_offset += length / 2;
+	pthread_mutex_unlock(&clients_lock);
+
+	byte_count += length;
+}
+
+int rx_callback(hackrf_transfer* transfer)
+{
+	serve_block(transfer->buffer, transfer->valid_length);
+	return do_exit ? -1 : 0;
+}
+
+int tx_callback(hackrf_transfer* transfer)
+{
+	uint32_t n, offset, first;
+
+	pthread_mutex_lock(&tx_lock);
+	n = (uint32_t)(tx_head - tx_tail);
+	if (n > (uint32_t)transfer->valid_length)
+	{
+		n = transfer->valid_length;
+	}
+	offset = (uint32_t)(tx_tail % TX_RING_SIZE);
+	first = TX_RING_SIZE - offset;
+	if (first > n)
+	{
+		first = n;
+	}
+	memcpy(transfer->buffer, &tx_ring[offset], first);
+	memcpy(&transfer->buffer[first], tx_ring, n - first);
+	tx_tail += n;
+	if (n < (uint32_t)transfer->valid_length)
+	{
+		/* Client is behind: send silence rather than stale samples. */
+		memset(&transfer->buffer[n], 0, transfer->valid_length - n);
+		tx_underruns++;
+	}
+	pthread_mutex_unlock(&tx_lock);
+
+	byte_count += transfer->valid_length;
+	return do_exit ? -1 : 0;
+}
+
+/* Receiving. Main thread only. */
+
+static int execute_command(const hackrf_tcp_frame_t* frame)
+{
+	if (device == NULL)
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+
+	switch (frame->type)
+	{
+	case HACKRF_TCP_SET_FREQ:
+		return hackrf_set_freq(device, frame->value);
+	case HACKRF_TCP_SET_SAMPLE_RATE:
+		return hackrf_set_sample_rate(device, (double)frame->value);
+	case HACKRF_TCP_SET_BASEBAND_FILTER:
+		return hackrf_set_baseband_filter_bandwidth(device,
+				hackrf_compute_baseband_filter_bw((uint32_t)frame->value));
+	case HACKRF_TCP_SET_LNA_GAIN:
+		return hackrf_set_lna_gain(device, (uint32_t)frame->value);
+	case HACKRF_TCP_SET_VGA_GAIN:
+		return hackrf_set_vga_gain(device, (uint32_t)frame->value);
+	case HACKRF_TCP_SET_TXVGA_GAIN:
+		return hackrf_set_txvga_gain(device, (uint32_t)frame->value);
+	case HACKRF_TCP_SET_AMP_ENABLE:
+		return hackrf_set_amp_enable(device, (uint8_t)frame->value);
+	default:
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+/* Free contiguous TX ring space for the current payload, 0 when full. */
+static uint32_t tx_space(uint8_t** where)
+{
+	uint32_t n, offset;
+
+	pthread_mutex_lock(&tx_lock);
+	n = TX_RING_SIZE - (uint32_t)(tx_head - tx_tail);
+	offset = (uint32_t)(tx_head % TX_RING_SIZE);
+	pthread_mutex_unlock(&tx_lock);
+
+	if (n > (TX_RING_SIZE - offset))
+	{
+		n = TX_RING_SIZE - offset;
+	}
+	*where = &tx_ring[offset];
+	return n;
+}
+
+static bool client_wants_input(client_t* c)
+{
+	uint8_t* where;
+	return (c->payload_remaining == 0) || (c != tx_client) || (tx_space(&where) > 0);
+}
+
+static bool client_read(client_t* c)
+{
+	static uint8_t discard[65536];
+	hackrf_tcp_frame_t reply;
+	uint8_t* where;
+	uint32_t want;
+	ssize_t n;
+	bool ok;
+
+	if (c->payload_remaining > 0)
+	{
+		if (c == tx_client)
+		{
+			want = tx_space(&where);
+			if (want == 0)
+			{
+				return true;
+			}
+		} else {
+			where = discard;
+			want = sizeof(discard);
+		}
+		if (want > c->payload_remaining)
+		{
+			want = c->payload_remaining;
+		}
+		n = recv(c->fd, where, want, MSG_DONTWAIT);
+		if (n > 0)
+		{
+			c->payload_remaining -= (uint32_t)n;
+			if (c == tx_client)
+			{
+				pthread_mutex_lock(&tx_lock);
+				tx_head += n;
+				pthread_mutex_unlock(&tx_lock);
+			}
+		}
+	} else {
+		n = recv(c->fd, (uint8_t*)&c->in + c->in_fill, sizeof(c->in) - c->in_fill, MSG_DONTWAIT);
+		if (n > 0)
+		{
+			c->in_fill += (uint32_t)n;
+		}
+		if (c->in_fill == sizeof(c->in))
+		{
+			c->in_fill = 0;
+			if (c->in.type == HACKRF_TCP_TX_DATA)
+			{
+				c->payload_remaining = c->in.length;
+			} else {
+				memset(&reply, 0, sizeof(reply));
+				reply.type = HACKRF_TCP_REPLY;
+				reply.value = (uint64_t)(int64_t)execute_command(&c->in);
+				pthread_mutex_lock(&clients_lock);
+				ok = client_send(c, &reply, NULL, false);
+				pthread_mutex_unlock(&clients_lock);
+				if (!ok)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	if (n == 0)
+	{
+		return false;
+	}
+	return (n > 0) || (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+}
+
+static void client_close(const uint32_t index)
+{
+	client_t* c;
+
+	pthread_mutex_lock(&clients_lock);
+	c = clients[index];
+	clients[index] = NULL;
+	pthread_mutex_unlock(&clients_lock);
+
+	printf("client %u disconnected: %" PRIu64 " bytes sent, %" PRIu64 " frames dropped\n",
+			index, c->bytes_sent, c->frames_dropped);
+	if (c == tx_client)
+	{
+		tx_client = NULL;
+	}
+	close(c->fd);
+	free(c->backlog);
+	free(c);
+}
+
+static void client_accept(const int listen_fd)
+{
+	hackrf_tcp_frame_t hello;
+	client_t* c;
+	int size = SOCKET_BUFFER_SIZE;
+	int fd;
+	uint32_t i;
+	bool ok;
+
+	fd = accept(listen_fd, NULL, NULL);
+	if (fd < 0)
+	{
+		return;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	c = (client_t*)calloc(1, sizeof(*c));
+	if (c != NULL)
+	{
+		c->backlog = (uint8_t*)malloc(BACKLOG_SIZE);
+	}
+	if ((c == NULL) || (c->backlog == NULL))
+	{
+		free(c);
+		close(fd);
+		return;
+	}
+	c->fd = fd;
+
+	memset(&hello, 0, sizeof(hello));
+	hello.type = HACKRF_TCP_HELLO;
+	hello.value = sample_rate_hz;
+
+	pthread_mutex_lock(&clients_lock);
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (clients[i] == NULL)
+		{
+			break;
+		}
+	}
+	ok = (i < MAX_CLIENTS) && client_send(c, &hello, NULL, false);
+	if (ok)
+	{
+		clients[i] = c;
+	}
+	pthread_mutex_unlock(&clients_lock);
+
+	if (!ok)
+	{
+		printf("client rejected\n");
+		close(fd);
+		free(c->backlog);
+		free(c);
+		return;
+	}
+	if (tx_mode && (tx_client == NULL))
+	{
+		tx_client = c;
+	}
+	printf("client %u connected%s\n", i, (c == tx_client) ? " (TX source)" : "");
+}
+
+/* One poll round: accept, read commands and TX data, drain backlogs. */
+static void serve(const int listen_fd)
+{
+	struct pollfd fds[MAX_CLIENTS + 1];
+	uint32_t index[MAX_CLIENTS + 1];
+	uint32_t count, i;
+	bool ok;
+
+	fds[0].fd = listen_fd;
+	fds[0].events = POLLIN;
+	count = 1;
+
+	pthread_mutex_lock(&clients_lock);
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		client_t* const c = clients[i];
+		if (c == NULL)
+		{
+			continue;
+		}
+		fds[count].fd = c->fd;
+		fds[count].events = (c->backlog_length > 0) ? POLLOUT : 0;
+		index[count] = i;
+		count++;
+	}
+	pthread_mutex_unlock(&clients_lock);
+
+	for (i = 1; i < count; i++)
+	{
+		if (client_wants_input(clients[index[i]]))
+		{
+			fds[i].events |= POLLIN;
+		}
+	}
+
+	if (poll(fds, count, 10) < 0)
+	{
+		return;
+	}
+
+	if (fds[0].revents & POLLIN)
+	{
+		client_accept(listen_fd);
+	}
+
+	for (i = 1; i < count; i++)
+	{
+		client_t* const c = clients[index[i]];
+		ok = true;
+		if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+		{
+			ok = client_read(c);
+		}
+		pthread_mutex_lock(&clients_lock);
+		ok = ok && !c->dead && client_flush(c);
+		pthread_mutex_unlock(&clients_lock);
+		if (!ok)
+		{
+			client_close(index[i]);
+		}
+	}
+}
+
+static int open_listener(const char* address, const uint32_t port, const char* unix_path)
+{
+	struct sockaddr_in in_addr;
+	struct sockaddr_un un_addr;
+	int one = 1;
+	int fd;
+
+	if (unix_path != NULL)
+	{
+		if (strlen(unix_path) >= sizeof(un_addr.sun_path))
+		{
+			return -1;
+		}
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		memset(&un_addr, 0, sizeof(un_addr));
+		un_addr.sun_family = AF_UNIX;
+		strcpy(un_addr.sun_path, unix_path);
+		unlink(unix_path);
+		if (bind(fd, (struct sockaddr*)&un_addr, sizeof(un_addr)) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+	} else {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		memset(&in_addr, 0, sizeof(in_addr));
+		in_addr.sin_family = AF_INET;
+		in_addr.sin_port = htons((uint16_t)port);
+		if ((inet_pton(AF_INET, address, &in_addr.sin_addr) != 1)
+				|| (bind(fd, (struct sockaddr*)&in_addr, sizeof(in_addr)) != 0))
+		{
+			close(fd);
+			return -1;
+		}
+	}
+
+	if (listen(fd, MAX_CLIENTS) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+static int open_client(const char* address, const uint32_t port, const char* unix_path)
+{
+	struct sockaddr_in in_addr;
+	struct sockaddr_un un_addr;
+	int size = SOCKET_BUFFER_SIZE;
+	int fd;
+	int result;
+
+	if (unix_path != NULL)
+	{
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		memset(&un_addr, 0, sizeof(un_addr));
+		un_addr.sun_family = AF_UNIX;
+		strncpy(un_addr.sun_path, unix_path, sizeof(un_addr.sun_path) - 1);
+		result = connect(fd, (struct sockaddr*)&un_addr, sizeof(un_addr));
+	} else {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		memset(&in_addr, 0, sizeof(in_addr));
+		in_addr.sin_family = AF_INET;
+		in_addr.sin_port = htons((uint16_t)port);
+		inet_pton(AF_INET, address, &in_addr.sin_addr);
+		result = connect(fd, (struct sockaddr*)&in_addr, sizeof(in_addr));
+	}
+	if ((fd >= 0) && (result != 0))
+	{
+		close(fd);
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	return fd;
+}
+
+/* Loopback benchmark: a synthetic source stands in for the radio and
+   in-process clients count what arrives. */
+
+typedef struct {
+	const char* address;
+	uint32_t port;
+	const char* unix_path;
+	pthread_t thread;
+	uint64_t bytes;
+	uint64_t frames;
+	uint64_t gaps;
+	float elapsed;
+	bool connected;
+} bench_client_t;
+
+static bool recv_all(const int fd, void* buffer, const uint32_t length)
+{
+	uint32_t done = 0;
+	ssize_t n;
+
+	while (done < length)
+	{
+		n = recv(fd, (uint8_t*)buffer + done, length - done, MSG_WAITALL);
+		if (n <= 0)
+		{
+			if ((n < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			return false;
+		}
+		done += (uint32_t)n;
+	}
+	return true;
+}
+
+static void* bench_client_thread(void* arg)
+{
+	bench_client_t* const b = (bench_client_t*)arg;
+	hackrf_tcp_frame_t frame;
+	struct timeval t_start, t_end;
+	uint8_t* buffer = (uint8_t*)malloc(BLOCK_LENGTH);
+	uint64_t expected = 0;
+	bool first = true;
+	int fd;
+
+	fd = open_client(b->address, b->port, b->unix_path);
+	if ((fd < 0) || (buffer == NULL))
+	{
+		free(buffer);
+		return NULL;
+	}
+	b->connected = true;
+
+	gettimeofday(&t_start, NULL);
+	while (!do_exit && recv_all(fd, &frame, sizeof(frame)))
+	{
+		if ((frame.length > BLOCK_LENGTH) || !recv_all(fd, buffer, frame.length))
+		{
+			break;
+		}
+		if (frame.type != HACKRF_TCP_RX_DATA)
+		{
+			continue;
+		}
+		if (first)
+		{
+			/* Start timing at the first block. */
+			gettimeofday(&t_start, NULL);
+			first = false;
+		} else {
+			b->bytes += frame.length;
+			b->frames++;
+			b->gaps += (frame.value != expected) ? 1 : 0;
+		}
+		expected = frame.value + frame.length / 2;
+	}
+	gettimeofday(&t_end, NULL);
+	b->elapsed = TimevalDiff(&t_end, &t_start);
+
+	close(fd);
+	free(buffer);
+	return NULL;
+}
+
+static void* bench_source_thread(void* arg)
+{
+	static uint8_t block[BLOCK_LENGTH];
+	uint32_t i;
+
+	(void)arg;
+	for (i = 0; i < BLOCK_LENGTH; i++)
+	{
+		block[i] = (uint8_t)i;
+	}
+	while (!do_exit)
+	{
+		serve_block(block, BLOCK_LENGTH);
+	}
+	return NULL;
+}
+
+static void* bench_timer_thread(void* arg)
+{
+	sleep(*(uint32_t*)arg);
+	do_exit = true;
+	return NULL;
+}
+
+static int benchmark(const int listen_fd, uint32_t seconds, const uint32_t num_clients,
+		const char* address, const uint32_t port, const char* unix_path)
+{
+	bench_client_t bench[MAX_CLIENTS];
+	pthread_t source, timer;
+	double total = 0.0;
+	uint32_t i;
+
+	memset(bench, 0, sizeof(bench));
+	for (i = 0; i < num_clients; i++)
+	{
+		bench[i].address = address;
+		bench[i].port = port;
+		bench[i].unix_path = unix_path;
+		pthread_create(&bench[i].thread, NULL, bench_client_thread, &bench[i]);
+	}
+	pthread_create(&source, NULL, bench_source_thread, NULL);
+	pthread_create(&timer, NULL, bench_timer_thread, &seconds);
+
+	while (!do_exit)
+	{
+		serve(listen_fd);
+	}
+
+	pthread_join(timer, NULL);
+	pthread_join(source, NULL);
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (clients[i] != NULL)
+		{
+			client_close(i);
+		}
+	}
+	for (i = 0; i < num_clients; i++)
+	{
+		pthread_join(bench[i].thread, NULL);
+		if (!bench[i].connected || (bench[i].elapsed <= 0.0f))
+		{
+			printf("client %u: no data\n", i);
+			continue;
+		}
+		printf("client %u: %.1f MB/s, %" PRIu64 " frames, %" PRIu64 " gaps\n", i,
+				bench[i].bytes / bench[i].elapsed / 1e6, bench[i].frames, bench[i].gaps);
+		total += bench[i].bytes / bench[i].elapsed / 1e6;
+	}
+	printf("total: %.1f MB/s to %u clients\n", total, num_clients);
+	return EXIT_SUCCESS;
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-A address] # Listen address (default %s).\n", DEFAULT_ADDRESS);
+	printf("\t[-p port] # TCP port (default %u).\n", DEFAULT_PORT);
+	printf("\t[-u path] # Listen on a Unix socket instead of TCP.\n");
+	printf("\t[-t] # Transmit samples sent by the first client instead of receiving.\n");
+	printf("\t[-f freq_hz] # Frequency in Hz (default %" PRIu64 ").\n", (uint64_t)DEFAULT_FREQ_HZ);
+	printf("\t[-s sample_rate_hz] # Sample rate in Hz (default %u).\n", DEFAULT_SAMPLE_RATE_HZ);
+	printf("\t[-a amp_enable] # RX/TX RF amplifier 1=Enable, 0=Disable.\n");
+	printf("\t[-l gain_db] # RX LNA (IF) gain, 0-40dB, 8dB steps.\n");
+	printf("\t[-g gain_db] # RX VGA (baseband) gain, 0-62dB, 2dB steps.\n");
+	printf("\t[-x gain_db] # TX VGA (IF) gain, 0-47dB, 1dB steps.\n");
+	printf("\t[-B seconds] # Loopback benchmark without a device.\n");
+	printf("\t[-c clients] # Benchmark clients (default 1).\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	int exit_code = EXIT_SUCCESS;
+	const char* address = DEFAULT_ADDRESS;
+	const char* unix_path = NULL;
+	uint32_t port = DEFAULT_PORT;
+	uint64_t freq_hz = DEFAULT_FREQ_HZ;
+	uint32_t amp_enable = 0;
+	uint32_t lna_gain = 8, vga_gain = 20, txvga_gain = 0;
+	uint32_t bench_seconds = 0;
+	uint32_t bench_clients = 1;
+	struct timeval time_start, time_now;
+	int listen_fd;
+
+	while( (opt = getopt(argc, argv, "A:p:u:tf:s:a:l:g:x:B:c:")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'A':
+			address = optarg;
+			break;
+
+		case 'p':
+			result = parse_u32(optarg, &port);
+			break;
+
+		case 'u':
+			unix_path = optarg;
+			break;
+
+		case 't':
+			tx_mode = true;
+			break;
+
+		case 'f':
+			result = parse_u64(optarg, &freq_hz);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'a':
+			result = parse_u32(optarg, &amp_enable);
+			break;
+
+		case 'l':
+			result = parse_u32(optarg, &lna_gain);
+			break;
+
+		case 'g':
+			result = parse_u32(optarg, &vga_gain);
+			break;
+
+		case 'x':
+			result = parse_u32(optarg, &txvga_gain);
+			break;
+
+		case 'B':
+			result = parse_u32(optarg, &bench_seconds);
+			break;
+
+		case 'c':
+			result = parse_u32(optarg, &bench_clients);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (bench_clients == 0) || (bench_clients > MAX_CLIENTS) ) {
+		printf("argument error: clients must be between 1 and %u\n", MAX_CLIENTS);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+	signal(SIGPIPE, SIG_IGN);
+
+	listen_fd = open_listener(address, port, unix_path);
+	if( listen_fd < 0 ) {
+		printf("Failed to listen on %s: %s\n",
+				(unix_path != NULL) ? unix_path : address, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if( bench_seconds > 0 ) {
+		exit_code = benchmark(listen_fd, bench_seconds, bench_clients, address, port, unix_path);
+		close(listen_fd);
+		return exit_code;
+	}
+
+	if( tx_mode ) {
+		tx_ring = (uint8_t*)malloc(TX_RING_SIZE);
+		if( tx_ring == NULL ) {
+			printf("Failed to allocate TX buffer\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	result = hackrf_init();
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_open(&device);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	result = hackrf_set_sample_rate(device, sample_rate_hz);
+	result |= hackrf_set_baseband_filter_bandwidth(device,
+			hackrf_compute_baseband_filter_bw_round_down_lt(sample_rate_hz));
+	result |= hackrf_set_freq(device, freq_hz);
+	result |= hackrf_set_amp_enable(device, (uint8_t)amp_enable);
+	if( tx_mode ) {
+		result |= hackrf_set_txvga_gain(device, txvga_gain);
+		result |= hackrf_start_tx(device, tx_callback, NULL);
+	} else {
+		result |= hackrf_set_vga_gain(device, vga_gain);
+		result |= hackrf_set_lna_gain(device, lna_gain);
+		result |= hackrf_start_rx(device, rx_callback, NULL);
+	}
+	if( result != HACKRF_SUCCESS ) {
+		printf("device setup failed: %s (%d)\n", hackrf_error_name(result), result);
+		hackrf_close(device);
+		hackrf_exit();
+		return EXIT_FAILURE;
+	}
+
+	printf("serving %s on %s\n", tx_mode ? "TX" : "RX",
+			(unix_path != NULL) ? unix_path : address);
+
+	gettimeofday(&time_start, NULL);
+	while( (hackrf_is_streaming(device) == HACKRF_TRUE) && (do_exit == false) )
+	{
+		uint32_t i;
+
+		serve(listen_fd);
+		gettimeofday(&time_now, NULL);
+		if( TimevalDiff(&time_now, &time_start) >= 1.0f ) {
+			printf("%4.1f MiB / %5.3f sec", byte_count / 1e6f, TimevalDiff(&time_now, &time_start));
+			byte_count = 0;
+			time_start = time_now;
+			pthread_mutex_lock(&clients_lock);
+			for (i = 0; i < MAX_CLIENTS; i++) {
+				if (clients[i] != NULL) {
+					printf(", client %u dropped %" PRIu64, i, clients[i]->frames_dropped);
+				}
+			}
+			pthread_mutex_unlock(&clients_lock);
+			if( tx_mode ) {
+				printf(", TX underruns %" PRIu64, tx_underruns);
+			}
+			printf("\n");
+		}
+	}
+
+	if( tx_mode ) {
+		hackrf_stop_tx(device);
+	} else {
+		hackrf_stop_rx(device);
+	}
+	hackrf_close(device);
+	hackrf_exit();
+
+	close(listen_fd);
+	if( unix_path != NULL ) {
+		unlink(unix_path);
+	}
+	free(tx_ring);
+	return exit_code;
+}
@@ -21,9 +21,15 @@
  */
 
 #include <hackrf.h>
+#include <hackrf_iqz.h>
+#include <hackrf_capture.h>
+#include <hackrf_rotate.h>
+#include <hackrf_udp.h>
+#include <hackrf_trigger.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
@@ -32,6 +38,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <math.h>
 
 #ifndef bool
 typedef int bool;
@@ -246,6 +253,20 @@ int parse_u32(char* s, uint32_t* const value) {
 	}
 }
 
+/* "address:port", split in place so optarg keeps just the address. */
+int parse_udp_destination(char* s, uint32_t* const port) {
+	char* colon = strrchr(s, ':');
+
+	if( (colon == NULL) || (colon == s) ) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	*colon = 0;
+	if( (parse_u32(colon + 1, port) != HACKRF_SUCCESS) || (*port == 0) || (*port > 65535) ) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return HACKRF_SUCCESS;
+}
+
 
 static char *stringrev(char *str)
 {
@@ -297,7 +318,6 @@ char* u64toa(uint64_t val, t_u64toa* str)
 volatile bool do_exit = false;
 
 FILE* fd = NULL;
-volatile uint32_t byte_count = 0;
 
 bool signalsource = false;
 uint32_t amplitude = 0;
@@ -337,14 +357,91 @@ size_t bytes_to_xfer = 0;
 bool baseband_filter_bw = false;
 uint32_t baseband_filter_bw_hz = 0;
 
+bool receive_iqz = false;
+hackrf_iqz_writer* iqz_writer = NULL;
+
+bool receive_capture = false;
+hackrf_capture_writer* capture_writer = NULL;
+
+bool trigger_mode = false;
+uint32_t trigger_threshold_db = 0;
+uint32_t trigger_pre_ms = 1000;
+uint32_t trigger_post_ms = 1000;
+hackrf_trigger* trigger = NULL;
+
+bool rotate = false;
+uint32_t rotate_mb = 0;
+uint32_t rotate_seconds = 0;
+hackrf_rotator* rotator = NULL;
+
+bool receive_udp = false;
+char* udp_address = NULL;
+uint32_t udp_port = 0;
+uint32_t udp_payload = 0;
+hackrf_udp_sender* udp_sender = NULL;
+
+bool thread_config = false;
+uint32_t thread_priority = 0;
+uint64_t thread_cpu_mask = 0;
+bool thread_lock_memory = false;
+
+const char* trace_path = NULL;
+
+bool offset_tuning = false;
+uint32_t offset_tuning_hz = 0;
+uint32_t decimation = 1;
+
 int rx_callback(hackrf_transfer* transfer) {
 	size_t bytes_to_write;
 	int i;
 
+	if( trigger != NULL )
+	{
+		/* Only detection and a ring copy here, files are written by the
+		   trigger's own thread. */
+		return hackrf_trigger_rx_callback(transfer);
+	}
+
+	if( rotator != NULL )
+	{
+		/* Opening and closing files happens on the rotator's thread. */
+		bytes_to_write = transfer->valid_length;
+		if (limit_num_samples) {
+			if (bytes_to_write >= bytes_to_xfer) {
+				bytes_to_write = bytes_to_xfer;
+			}
+			bytes_to_xfer -= bytes_to_write;
+		}
+		if ((hackrf_rotator_execute(rotator, (int8_t*)transfer->buffer,
+				(uint32_t)bytes_to_write) != HACKRF_SUCCESS)
+				|| (limit_num_samples && (bytes_to_xfer == 0))) {
+			return -1;
+		} else {
+			return 0;
+		}
+	}
+
+	if( udp_sender != NULL )
+	{
+		bytes_to_write = transfer->valid_length;
+		if (limit_num_samples) {
+			if (bytes_to_write >= bytes_to_xfer) {
+				bytes_to_write = bytes_to_xfer;
+			}
+			bytes_to_xfer -= bytes_to_write;
+		}
+		if ((hackrf_udp_sender_write(udp_sender, (int8_t*)transfer->buffer,
+				(uint32_t)bytes_to_write) != HACKRF_SUCCESS)
+				|| (limit_num_samples && (bytes_to_xfer == 0))) {
+			return -1;
+		} else {
+			return 0;
+		}
+	}
+
 	if( fd != NULL ) 
 	{
 		ssize_t bytes_written;
-		byte_count += transfer->valid_length;
 		bytes_to_write = transfer->valid_length;
 		if (limit_num_samples) {
 			if (bytes_to_write >= bytes_to_xfer) {
@@ -358,7 +455,18 @@ int rx_callback(hackrf_transfer* transfer) {
 				transfer->buffer[i] ^= (uint8_t)0x80;
 			}
 		}
-		bytes_written = fwrite(transfer->buffer, 1, bytes_to_write, fd);
+		if (iqz_writer != NULL) {
+			/* Compression runs on the writer's own thread. */
+			bytes_written = (hackrf_iqz_writer_write(iqz_writer,
+					(int8_t*)transfer->buffer, bytes_to_write) == HACKRF_SUCCESS)
+					? bytes_to_write : 0;
+		} else if (capture_writer != NULL) {
+			bytes_written = (hackrf_capture_writer_write(capture_writer,
+					(int8_t*)transfer->buffer, bytes_to_write) == HACKRF_SUCCESS)
+					? bytes_to_write : 0;
+		} else {
+			bytes_written = fwrite(transfer->buffer, 1, bytes_to_write, fd);
+		}
 		if ((bytes_written != bytes_to_write)
 				|| (limit_num_samples && (bytes_to_xfer == 0))) {
 			return -1;
@@ -377,7 +485,6 @@ int tx_callback(hackrf_transfer* transfer) {
 	if( fd != NULL )
 	{
 		ssize_t bytes_read;
-		byte_count += transfer->valid_length;
 		bytes_to_read = transfer->valid_length;
 		if (limit_num_samples) {
 			if (bytes_to_read >= bytes_to_xfer) {
@@ -398,7 +505,6 @@ int tx_callback(hackrf_transfer* transfer) {
 		}
 	} else if (transceiver_mode == TRANSCEIVER_MODE_SS) {
 		/* Transmit continuous wave with specific amplitude */
-		byte_count += transfer->valid_length;
 		bytes_to_read = transfer->valid_length;
 		if (limit_num_samples) {
 			if (bytes_to_read >= bytes_to_xfer) {
@@ -446,6 +552,22 @@ static void usage() {
 	printf("\t[-n num_samples] # Number of samples to transfer (default is unlimited).\n");
 	printf("\t[-c amplitude] # CW signal source mode, amplitude 0-127 (DC value to DAC).\n");
 	printf("\t[-b baseband_filter_bw_hz] # Set baseband filter bandwidth in MHz.\n\tPossible values: 1.75/2.5/3.5/5/5.5/6/7/8/9/10/12/14/15/20/24/28MHz, default < sample_rate_hz.\n" );
+	printf("\t[-z] # With -r, write losslessly compressed .iqz (see hackrf_iqz).\n");
+	printf("\t[-C] # With -r, write an indexed .hrfc capture with per block time, frequency and gains.\n");
+	printf("\t[-T threshold_db] # With -r, triggered capture: record when the power rises above -threshold_db dBFS.\n");
+	printf("\t   # -r gives the file prefix, each event is written to <prefix>_<n>_pre.bin and _post.bin.\n");
+	printf("\t[-P pre_ms] # Triggered capture pre-trigger window (default 1000ms).\n");
+	printf("\t[-Q post_ms] # Triggered capture post-trigger window (default 1000ms).\n");
+	printf("\t[-R file_mb] # With -r, roll over to a new numbered file every file_mb MB without losing samples.\n");
+	printf("\t[-e file_s] # With -r, roll over to a new numbered file every file_s seconds of samples.\n");
+	printf("\t[-U address:port] # Receive and stream to UDP (multicast or unicast) instead of a file.\n");
+	printf("\t[-u payload_size] # With -U, sample bytes per datagram (default %u, fits a jumbo frame).\n", HACKRF_UDP_DEFAULT_PAYLOAD);
+	printf("\t[-S priority] # Run the transfer thread SCHED_FIFO at priority 1-99 (usually needs root).\n");
+	printf("\t[-A cpu_mask] # Pin the transfer thread to these CPUs, e.g. 0x4 for CPU 2.\n");
+	printf("\t[-M] # Lock the USB transfer buffers in memory.\n");
+	printf("\t[-X trace.json] # Record a USB pipeline trace (libhackrf built with ENABLE_TRACE) and write it as Chrome trace JSON on exit.\n");
+	printf("\t[-O offset_hz] # Offset tuning, place the LO offset_hz above freq_hz to avoid the DC spike.\n");
+	printf("\t[-D decimation] # With -O, RX decimation factor 1-%d (default 1).\n", HACKRF_OFFSET_TUNING_MAX_DECIMATION);
 }
 
 static hackrf_device* device = NULL;
@@ -484,9 +606,10 @@ int main(int argc, char** argv) {
 	int exit_code = EXIT_SUCCESS;
 	struct timeval t_end;
 	float time_diff;
+	hackrf_stats stats_last;
 	unsigned int lna_gain=8, vga_gain=20, txvga_gain=0;
   
-	while( (opt = getopt(argc, argv, "wr:t:f:i:o:m:a:p:s:n:b:l:g:x:c:")) != EOF )
+	while( (opt = getopt(argc, argv, "wr:t:f:i:o:m:a:p:s:n:b:l:g:x:c:O:D:zCT:P:Q:R:e:U:u:S:A:MX:")) != EOF )
 	{
 		result = HACKRF_SUCCESS;
 		switch( opt ) 
@@ -569,6 +692,76 @@ int main(int argc, char** argv) {
 			result = parse_u32(optarg, &amplitude);
 			break;
 
+		case 'z':
+			receive_iqz = true;
+			break;
+
+		case 'C':
+			receive_capture = true;
+			break;
+
+		case 'T':
+			trigger_mode = true;
+			result = parse_u32(optarg, &trigger_threshold_db);
+			break;
+
+		case 'P':
+			result = parse_u32(optarg, &trigger_pre_ms);
+			break;
+
+		case 'Q':
+			result = parse_u32(optarg, &trigger_post_ms);
+			break;
+
+		case 'R':
+			rotate = true;
+			result = parse_u32(optarg, &rotate_mb);
+			break;
+
+		case 'e':
+			rotate = true;
+			result = parse_u32(optarg, &rotate_seconds);
+			break;
+
+		case 'U':
+			receive = true;
+			receive_udp = true;
+			udp_address = optarg;
+			result = parse_udp_destination(optarg, &udp_port);
+			break;
+
+		case 'u':
+			result = parse_u32(optarg, &udp_payload);
+			break;
+
+		case 'S':
+			thread_config = true;
+			result = parse_u32(optarg, &thread_priority);
+			break;
+
+		case 'A':
+			thread_config = true;
+			result = parse_u64(optarg, &thread_cpu_mask);
+			break;
+
+		case 'M':
+			thread_config = true;
+			thread_lock_memory = true;
+			break;
+
+		case 'X':
+			trace_path = optarg;
+			break;
+
+		case 'O':
+			offset_tuning = true;
+			result = parse_u32(optarg, &offset_tuning_hz);
+			break;
+
+		case 'D':
+			result = parse_u32(optarg, &decimation);
+			break;
+
 		default:
 			printf("unknown argument '-%c %s'\n", opt, optarg);
 			usage();
@@ -694,6 +887,12 @@ int main(int argc, char** argv) {
 		baseband_filter_bw_hz = hackrf_compute_baseband_filter_bw_round_down_lt(sample_rate_hz);
 	}
 
+	if ((decimation == 0) || ((decimation != 1) && !offset_tuning)) {
+		printf("argument error: decimation requires offset tuning (-O) and must be at least 1.\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
 	if (baseband_filter_bw_hz > BASEBAND_FILTER_BW_MAX) {
 		printf("argument error: baseband_filter_bw_hz must be less or equal to %u Hz/%.03f MHz\n",
 				BASEBAND_FILTER_BW_MAX, (float)(BASEBAND_FILTER_BW_MAX/FREQ_ONE_MHZ));
@@ -734,6 +933,36 @@ int main(int argc, char** argv) {
 	if( receive ) {
 		transceiver_mode = TRANSCEIVER_MODE_RX;
 	}
+
+	if( receive_iqz && !receive ) {
+		printf("argument error: -z requires receive -r\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( receive_capture && (!receive || receive_iqz) ) {
+		printf("argument error: -C requires receive -r and cannot be combined with -z\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( rotate && (!receive || receive_iqz || trigger_mode || ((rotate_mb == 0) == (rotate_seconds == 0))) ) {
+		printf("argument error: one of -R or -e, with receive -r and without -z or -T\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( receive_udp && ((path != NULL) || receive_wav || receive_iqz || receive_capture || rotate || trigger_mode) ) {
+		printf("argument error: -U replaces the output file and cannot be combined with -r, -w, -z, -C, -R, -e or -T\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( trigger_mode && (!receive || receive_iqz || receive_capture) ) {
+		printf("argument error: -T requires receive -r and cannot be combined with -z or -C\n");
+		usage();
+		return EXIT_FAILURE;
+	}
 	
 	if( transmit ) {
 		transceiver_mode = TRANSCEIVER_MODE_TX;
@@ -761,7 +990,7 @@ int main(int argc, char** argv) {
 	}	
 
 	// In signal source mode, the PATH argument is neglected.
-	if (transceiver_mode != TRANSCEIVER_MODE_SS) {
+	if ((transceiver_mode != TRANSCEIVER_MODE_SS) && !receive_udp) {
 		if( path == NULL ) {
 			printf("specify a path to a file to transmit/receive\n");
 			usage();
@@ -783,7 +1012,44 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 	
-	if (transceiver_mode != TRANSCEIVER_MODE_SS) {
+	if( trigger_mode ) {
+		const uint64_t bytes_per_ms = (2ull * sample_rate_hz / decimation) / 1000ull;
+		printf("call hackrf_trigger_create(%s, -%u dBFS, %u ms pre, %u ms post)\n",
+				path, trigger_threshold_db, trigger_pre_ms, trigger_post_ms);
+		result = hackrf_trigger_create(&trigger, path,
+				bytes_per_ms * trigger_pre_ms, bytes_per_ms * trigger_post_ms,
+				(float)pow(10.0, -(double)trigger_threshold_db / 10.0), 0);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_trigger_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	} else if( rotate ) {
+		/* Seconds are counted in samples, so every file holds exactly the
+		   same span regardless of host clock jitter. */
+		const uint64_t file_bytes = (rotate_seconds != 0)
+				? (2ull * sample_rate_hz / decimation) * rotate_seconds
+				: (uint64_t)rotate_mb * 1000000ull;
+		printf("call hackrf_rotator_create(%s, %" PRIu64 " bytes per file)\n", path, file_bytes);
+		result = hackrf_rotator_create(&rotator, path, file_bytes, receive_capture);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_rotator_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	} else if( receive_udp ) {
+		hackrf_capture_metadata metadata;
+
+		printf("call hackrf_udp_sender_create(%s:%u)\n", udp_address, udp_port);
+		result = hackrf_udp_sender_create(&udp_sender, udp_address, (uint16_t)udp_port,
+				NULL, udp_payload, 1);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_udp_sender_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+		memset(&metadata, 0, sizeof(metadata));
+		metadata.freq_hz = automatic_tuning ? freq_hz : 0;
+		metadata.sample_rate_hz = sample_rate_hz / decimation;
+		hackrf_udp_sender_set_metadata(udp_sender, &metadata);
+	} else if (transceiver_mode != TRANSCEIVER_MODE_SS) {
 		if( transceiver_mode == TRANSCEIVER_MODE_RX )
 		{
 			fd = fopen(path, "wb");
@@ -809,6 +1075,38 @@ int main(int argc, char** argv) {
 	{
 		fwrite(&wave_file_hdr, 1, sizeof(t_wav_file_hdr), fd);
 	}
+
+	if( receive_iqz )
+	{
+		result = hackrf_iqz_writer_create(&iqz_writer, fd, 0, 1);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_iqz_writer_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( receive_capture )
+	{
+		hackrf_capture_metadata metadata;
+
+		memset(&metadata, 0, sizeof(metadata));
+		metadata.freq_hz = automatic_tuning ? freq_hz : 0;
+		metadata.sample_rate_hz = sample_rate_hz / decimation;
+		metadata.lna_gain = (uint8_t)lna_gain;
+		metadata.vga_gain = (uint8_t)vga_gain;
+		metadata.amp_enable = (uint8_t)(amp ? amp_enable : 0);
+
+		if( rotator != NULL ) {
+			hackrf_rotator_set_metadata(rotator, &metadata);
+		} else {
+			result = hackrf_capture_writer_create(&capture_writer, fd, 0);
+			if( result != HACKRF_SUCCESS ) {
+				printf("hackrf_capture_writer_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+				return EXIT_FAILURE;
+			}
+			hackrf_capture_writer_set_metadata(capture_writer, &metadata);
+		}
+	}
 	
 #ifdef _MSC_VER
 	SetConsoleCtrlHandler( (PHANDLER_ROUTINE) sighandler, TRUE );
@@ -837,10 +1135,46 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 
+	if( offset_tuning ) {
+		printf("call hackrf_set_offset_tuning(%u Hz, decimation %u)\n", offset_tuning_hz, decimation);
+		result = hackrf_set_offset_tuning(device, (int32_t)offset_tuning_hz, decimation);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_set_offset_tuning() failed: %s (%d)\n", hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( trace_path != NULL ) {
+		result = hackrf_trace_start(device, 0);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_trace_start() failed: %s (%d), is libhackrf built with ENABLE_TRACE?\n",
+					hackrf_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( thread_config ) {
+		hackrf_thread_config config;
+
+		memset(&config, 0, sizeof(config));
+		config.policy = (thread_priority != 0) ? HACKRF_SCHED_FIFO : HACKRF_SCHED_DEFAULT;
+		config.priority = thread_priority;
+		config.cpu_mask = thread_cpu_mask;
+		config.lock_memory = thread_lock_memory;
+		result = hackrf_set_transfer_thread_config(device, &config);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_set_transfer_thread_config() failed: %s (%d)\n", hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
 	if( transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		result = hackrf_set_vga_gain(device, vga_gain);
 		result |= hackrf_set_lna_gain(device, lna_gain);
-		result |= hackrf_start_rx(device, rx_callback, NULL);
+		result |= hackrf_start_rx(device, rx_callback,
+				(trigger != NULL) ? (void*)trigger : (void*)rotator);
 	} else {
 		result = hackrf_set_txvga_gain(device, txvga_gain);
 		result |= hackrf_start_tx(device, tx_callback, NULL);
@@ -903,27 +1237,67 @@ int main(int argc, char** argv) {
 	
 	gettimeofday(&t_start, NULL);
 	gettimeofday(&time_start, NULL);
+	hackrf_get_stats(device, &stats_last);
 
 	printf("Stop with Ctrl-C\n");
 	while( (hackrf_is_streaming(device) == HACKRF_TRUE) &&
 			(do_exit == false) ) 
 	{
-		uint32_t byte_count_now;
+		uint64_t byte_count_now;
+		hackrf_stats stats_now;
 		struct timeval time_now;
 		float time_difference, rate;
 		sleep(1);
 		
 		gettimeofday(&time_now, NULL);
+		hackrf_get_stats(device, &stats_now);
 		
-		byte_count_now = byte_count;
-		byte_count = 0;
+		byte_count_now = stats_now.bytes - stats_last.bytes;
 		
 		time_difference = TimevalDiff(&time_now, &time_start);
 		rate = (float)byte_count_now / time_difference;
 		printf("%4.1f MiB / %5.3f sec = %4.1f MiB/second\n",
 				(byte_count_now / 1e6f), time_difference, (rate / 1e6f) );
+		printf("usb: in flight %u, failed %" PRIu64 ", resubmit failures %" PRIu64
+				", callback max %u us, completion gap max %u us\n",
+				stats_now.in_flight, stats_now.failed_transfers, stats_now.resubmit_failures,
+				stats_now.callback_max_us, stats_now.gap_max_us);
 
 		time_start = time_now;
+		stats_last = stats_now;
+
+		if (trigger != NULL) {
+			uint32_t events, overruns;
+			float peak;
+			hackrf_trigger_stats(trigger, &events, &overruns, &peak);
+			printf("triggered captures %u, cut short %u, peak %.1f dBFS\n",
+					events, overruns, 10.0 * log10(peak + 1e-12));
+		}
+
+		if (rotator != NULL) {
+			uint32_t files, stalls, errors;
+			hackrf_rotator_stats(rotator, &files, &stalls, &errors);
+			printf("files completed %u, rotation stalls %u, errors %u\n",
+					files, stalls, errors);
+		}
+
+		if (thread_config) {
+			hackrf_thread_stats stats;
+			hackrf_get_transfer_thread_stats(device, &stats);
+			printf("transfer thread: realtime %s, affinity %s, memory locked %s, preempted %" PRIu64 " times",
+					stats.realtime ? "yes" : "no", stats.affinity ? "yes" : "no",
+					stats.memory_locked ? "yes" : "no", stats.involuntary_switches);
+			if (stats.error != 0) {
+				printf(", %s", strerror(stats.error));
+			}
+			printf("\n");
+		}
+
+		if (udp_sender != NULL) {
+			uint64_t datagrams, errors;
+			hackrf_udp_sender_stats(udp_sender, &datagrams, NULL, &errors);
+			printf("datagrams sent %" PRIu64 ", send errors %" PRIu64 "\n", datagrams, errors);
+		}
 
 		if (byte_count_now == 0) {
 			exit_code = EXIT_FAILURE;
@@ -966,6 +1340,16 @@ int main(int argc, char** argv) {
 			}
 		}
 		
+		if( trace_path != NULL )
+		{
+			result = hackrf_trace_write(device, trace_path);
+			if( result != HACKRF_SUCCESS ) {
+				printf("hackrf_trace_write() failed: %s (%d)\n", hackrf_error_name(result), result);
+			} else {
+				printf("hackrf_trace_write(%s) done\n", trace_path);
+			}
+		}
+
 		result = hackrf_close(device);
 		if( result != HACKRF_SUCCESS ) 
 		{
@@ -978,6 +1362,52 @@ int main(int argc, char** argv) {
 		printf("hackrf_exit() done\n");
 	}
 		
+	if(trigger != NULL)
+	{
+		hackrf_trigger_destroy(trigger);
+		trigger = NULL;
+		printf("hackrf_trigger_destroy() done\n");
+	}
+
+	if(rotator != NULL)
+	{
+		result = hackrf_rotator_destroy(rotator);
+		rotator = NULL;
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_rotator_destroy() failed: %s (%d)\n", hackrf_error_name(result), result);
+			exit_code = EXIT_FAILURE;
+		} else {
+			printf("hackrf_rotator_destroy() done\n");
+		}
+	}
+
+	if(udp_sender != NULL)
+	{
+		hackrf_udp_sender_destroy(udp_sender);
+		udp_sender = NULL;
+		printf("hackrf_udp_sender_destroy() done\n");
+	}
+
+	if(iqz_writer != NULL)
+	{
+		result = hackrf_iqz_writer_close(iqz_writer);
+		iqz_writer = NULL;
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_iqz_writer_close() failed: %s (%d)\n", hackrf_error_name(result), result);
+			exit_code = EXIT_FAILURE;
+		}
+	}
+
+	if(capture_writer != NULL)
+	{
+		result = hackrf_capture_writer_close(capture_writer);
+		capture_writer = NULL;
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_capture_writer_close() failed: %s (%d)\n", hackrf_error_name(result), result);
+			exit_code = EXIT_FAILURE;
+		}
+	}
+
 	if(fd != NULL)
 	{
 		if( receive_wav ) 
@@ -986,7 +1416,7 @@ int main(int argc, char** argv) {
 			file_pos = ftell(fd);
 			/* Update Wav Header */
 			wave_file_hdr.hdr.size = file_pos+8;
-			wave_file_hdr.fmt_chunk.dwSamplesPerSec = sample_rate_hz;
+			wave_file_hdr.fmt_chunk.dwSamplesPerSec = sample_rate_hz / decimation;
 			wave_file_hdr.fmt_chunk.dwAvgBytesPerSec = wave_file_hdr.fmt_chunk.dwSamplesPerSec*2;
 			wave_file_hdr.data_chunk.chunkSize = file_pos - sizeof(t_wav_file_hdr);
 			/* Overwrite header with updated data */
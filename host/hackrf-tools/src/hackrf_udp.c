@@ -0,0 +1,346 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Receive a HackRF RX stream sent over UDP (hackrf_transfer -U), or
+   benchmark the UDP transport over loopback. See hackrf_udp.h. */
+
+#include <hackrf.h>
+#include <hackrf_udp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define DEFAULT_ADDRESS "239.255.72.70"
+#define DEFAULT_PORT (7270)
+#define DEFAULT_BENCH_RATE_HZ (20000000)
+/* Same size as the libhackrf USB transfer buffers. */
+#define BLOCK_LENGTH (262144)
+
+static volatile bool do_exit = false;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stdout, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u32(char* s, uint32_t* const value) {
+	uint64_t u64_value = 0;
+	int result = parse_u64(s, &u64_value);
+	if( (result == HACKRF_SUCCESS) && (u64_value > 0xffffffffull) ) {
+		result = HACKRF_ERROR_INVALID_PARAM;
+	}
+	*value = (uint32_t)u64_value;
+	return result;
+}
+
+/* Benchmark source: a counting pattern so the receiver can check every
+   byte, paced at sample_rate_hz (0 = as fast as possible). */
+
+typedef struct {
+	const char* address;
+	uint16_t port;
+	const char* interface_address;
+	uint32_t payload_size;
+	uint32_t sample_rate_hz;
+	uint32_t seconds;
+	uint64_t blocks;
+	uint64_t datagrams;
+	uint64_t errors;
+	float elapsed;
+	int result;
+} sender_t;
+
+static void* sender_thread(void* arg)
+{
+	sender_t* const sd = (sender_t*)arg;
+	static int8_t block[BLOCK_LENGTH];
+	hackrf_udp_sender* sender = NULL;
+	hackrf_capture_metadata metadata;
+	struct timeval t_start, t_now;
+	uint32_t i;
+
+	sd->result = hackrf_udp_sender_create(&sender, sd->address, sd->port,
+			sd->interface_address, sd->payload_size, 1);
+	if (sd->result != HACKRF_SUCCESS)
+	{
+		return NULL;
+	}
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.sample_rate_hz = sd->sample_rate_hz;
+	hackrf_udp_sender_set_metadata(sender, &metadata);
+
+	gettimeofday(&t_start, NULL);
+	while (!do_exit && (sd->elapsed < sd->seconds))
+	{
+		for (i = 0; i < BLOCK_LENGTH; i++)
+		{
+			block[i] = (int8_t)(sd->blocks + i);
+		}
+		hackrf_udp_sender_write(sender, block, BLOCK_LENGTH);
+		sd->blocks++;
+		gettimeofday(&t_now, NULL);
+		sd->elapsed = TimevalDiff(&t_now, &t_start);
+		if (sd->sample_rate_hz != 0)
+		{
+			const double due = sd->blocks * (BLOCK_LENGTH / 2.0) / sd->sample_rate_hz;
+			if (due > sd->elapsed)
+			{
+				usleep((useconds_t)((due - sd->elapsed) * 1e6));
+			}
+		}
+	}
+	hackrf_udp_sender_stats(sender, &sd->datagrams, NULL, &sd->errors);
+	hackrf_udp_sender_destroy(sender);
+	return NULL;
+}
+
+static void print_stats(hackrf_udp_receiver* receiver)
+{
+	uint64_t datagrams, lost, blocks, partial, invalid;
+
+	hackrf_udp_receiver_stats(receiver, &datagrams, &lost, &blocks, &partial, &invalid);
+	printf("%" PRIu64 " datagrams, %" PRIu64 " lost, %" PRIu64 " blocks, %" PRIu64
+			" partial, %" PRIu64 " invalid\n", datagrams, lost, blocks, partial, invalid);
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-a address] # Group or unicast address to receive (default %s).\n", DEFAULT_ADDRESS);
+	printf("\t[-p port] # UDP port (default %u).\n", DEFAULT_PORT);
+	printf("\t[-i interface_address] # Local address of the interface to join the group on.\n");
+	printf("\t[-r filename] # Write received samples to file, lost bytes zero filled.\n");
+	printf("\t[-B seconds] # Benchmark: send a synthetic stream to the address and receive it.\n");
+	printf("\t[-s sample_rate_hz] # Benchmark rate in Hz (default %u, 0 = unpaced).\n", DEFAULT_BENCH_RATE_HZ);
+	printf("\t[-P payload_size] # Benchmark bytes per datagram (default %u).\n", HACKRF_UDP_DEFAULT_PAYLOAD);
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	const char* address = DEFAULT_ADDRESS;
+	const char* interface_address = NULL;
+	const char* path = NULL;
+	uint32_t port = DEFAULT_PORT;
+	uint32_t bench_seconds = 0;
+	uint32_t sample_rate_hz = DEFAULT_BENCH_RATE_HZ;
+	uint32_t payload_size = 0;
+	hackrf_udp_receiver* receiver = NULL;
+	hackrf_udp_block block;
+	sender_t sender;
+	pthread_t thread;
+	struct timeval time_start, time_now;
+	uint64_t bytes = 0, total_bytes = 0, bad_bytes = 0, next_block = 0;
+	FILE* fd = NULL;
+	uint32_t i;
+
+	while( (opt = getopt(argc, argv, "a:p:i:r:B:s:P:")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'a':
+			address = optarg;
+			break;
+
+		case 'p':
+			result = parse_u32(optarg, &port);
+			break;
+
+		case 'i':
+			interface_address = optarg;
+			break;
+
+		case 'r':
+			path = optarg;
+			break;
+
+		case 'B':
+			result = parse_u32(optarg, &bench_seconds);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'P':
+			result = parse_u32(optarg, &payload_size);
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( port > 65535 ) {
+		printf("argument error: port out of range\n");
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+
+	result = hackrf_udp_receiver_open(&receiver, address, (uint16_t)port, interface_address);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_udp_receiver_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	if( path != NULL ) {
+		fd = fopen(path, "wb");
+		if( fd == NULL ) {
+			printf("Failed to open file: %s\n", path);
+			hackrf_udp_receiver_close(receiver);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( bench_seconds > 0 ) {
+		memset(&sender, 0, sizeof(sender));
+		sender.address = address;
+		sender.port = (uint16_t)port;
+		sender.interface_address = interface_address;
+		sender.payload_size = payload_size;
+		sender.sample_rate_hz = sample_rate_hz;
+		sender.seconds = bench_seconds;
+		pthread_create(&thread, NULL, sender_thread, &sender);
+	} else {
+		printf("receiving %s:%u, stop with Ctrl-C\n", address, port);
+	}
+
+	gettimeofday(&time_start, NULL);
+	while( !do_exit ) {
+		result = hackrf_udp_receiver_read(receiver, &block, 1000);
+		if( result == HACKRF_SUCCESS ) {
+			if( bench_seconds > 0 ) {
+				/* Check the pattern where it arrived; lost bytes are zero. */
+				for( i = 0; i < block.length; i++ ) {
+					if( (block.samples[i] != (int8_t)(block.block + i)) && (block.samples[i] != 0) ) {
+						bad_bytes++;
+					}
+				}
+			}
+			if( block.block != next_block ) {
+				printf("block %" PRIu64 " to %u missing\n", next_block, block.block - 1);
+			}
+			next_block = block.block + 1;
+			if( (fd != NULL) && (fwrite(block.samples, 1, block.length, fd) != block.length) ) {
+				printf("write failed\n");
+				break;
+			}
+			bytes += block.length;
+			total_bytes += block.length;
+		} else if( result == HACKRF_ERROR_NOT_FOUND ) {
+			if( bench_seconds > 0 ) {
+				/* The sender has finished. */
+				result = HACKRF_SUCCESS;
+				break;
+			}
+		} else {
+			printf("hackrf_udp_receiver_read() failed: %s (%d)\n", hackrf_error_name(result), result);
+			break;
+		}
+
+		gettimeofday(&time_now, NULL);
+		if( TimevalDiff(&time_now, &time_start) >= 1.0f ) {
+			printf("%4.1f MiB / %5.3f sec, ", bytes / 1e6f, TimevalDiff(&time_now, &time_start));
+			print_stats(receiver);
+			bytes = 0;
+			time_start = time_now;
+		}
+	}
+
+	if( bench_seconds > 0 ) {
+		do_exit = true;
+		pthread_join(thread, NULL);
+		if( sender.result != HACKRF_SUCCESS ) {
+			printf("hackrf_udp_sender_create() failed: %s (%d)\n",
+					hackrf_error_name(sender.result), sender.result);
+			result = sender.result;
+		} else {
+			printf("sent %" PRIu64 " blocks in %" PRIu64 " datagrams, %.1f MB/s, %" PRIu64 " send errors\n",
+					sender.blocks, sender.datagrams,
+					sender.blocks * (double)BLOCK_LENGTH / sender.elapsed / 1e6, sender.errors);
+			printf("received %.1f MB, %" PRIu64 " corrupt bytes\n", total_bytes / 1e6, bad_bytes);
+		}
+	}
+	print_stats(receiver);
+
+	if( fd != NULL ) {
+		fclose(fd);
+	}
+	hackrf_udp_receiver_close(receiver);
+	return ((result == HACKRF_SUCCESS) && (bad_bytes == 0)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,675 @@
+/*
+ * Copyright 2014 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* hackrfd: keep a HackRF open and configured between runs. Clients
+   (hackrf_client.h) send settings over a Unix socket and receive samples
+   through shared memory (hackrf_shm.h), so a short capture costs a socket
+   connect instead of a USB open, configuration and a string of control
+   transfers. */
+
+#include <hackrf.h>
+#include <hackrf_shm.h>
+#include <hackrf_client.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define DEFAULT_SHM_NAME "/hackrfd"
+#define DEFAULT_FREQ_HZ (900000000ull)
+#define DEFAULT_SAMPLE_RATE_HZ (10000000)
+#define DEFAULT_IDLE_SECONDS (10)
+#define MAX_CLIENTS (32)
+/* Same size as the libhackrf USB transfer buffers. */
+#define BLOCK_LENGTH (262144)
+/* Blocks that can still carry samples from before a settings change once
+   the call making it returns: the libhackrf transfers in flight, plus the
+   one the firmware is part way through. */
+#define DRAIN_BLOCKS (4 + 1)
+
+static volatile bool do_exit = false;
+
+void sigint_callback_handler(int signum)
+{
+	fprintf(stdout, "Caught signal %d\n", signum);
+	do_exit = true;
+}
+
+static float
+TimevalDiff(const struct timeval *a, const struct timeval *b)
+{
+   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+}
+
+int parse_u64(char* s, uint64_t* const value) {
+	uint_fast8_t base = 10;
+	char* s_end;
+	uint64_t u64_value;
+
+	if( strlen(s) > 2 ) {
+		if( s[0] == '0' ) {
+			if( (s[1] == 'x') || (s[1] == 'X') ) {
+				base = 16;
+				s += 2;
+			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
+				base = 2;
+				s += 2;
+			}
+		}
+	}
+
+	s_end = s;
+	u64_value = strtoull(s, &s_end, base);
+	if( (s != s_end) && (*s_end == 0) ) {
+		*value = u64_value;
+		return HACKRF_SUCCESS;
+	} else {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+}
+
+int parse_u32(char* s, uint32_t* const value) {
+	uint64_t u64_value = 0;
+	int result = parse_u64(s, &u64_value);
+	if( (result == HACKRF_SUCCESS) && (u64_value > 0xffffffffull) ) {
+		result = HACKRF_ERROR_INVALID_PARAM;
+	}
+	*value = (uint32_t)u64_value;
+	return result;
+}
+
+typedef struct {
+	int fd;
+	bool receiving;
+	hackrf_client_frame frame; /* request being read */
+	size_t received;           /* bytes of frame read so far */
+} client_t;
+
+/* Device state. Settings are cached so a client repeating the current
+   configuration, the common case for batch jobs, costs no USB traffic. */
+static hackrf_device* device = NULL;
+static hackrf_shm_publisher* publisher = NULL;
+static hackrf_capture_metadata metadata;
+static uint32_t baseband_filter_hz = 0;
+static bool streaming = false;
+
+/* Fake device (-F): a thread publishing a synthetic stream at the sample
+   rate, for exercising clients without hardware. */
+static bool fake = false;
+static pthread_t fake_thread;
+static volatile bool fake_stop = false;
+
+static void* fake_threadproc(void* arg)
+{
+	static int8_t block[BLOCK_LENGTH];
+	struct timeval t_start, t_now;
+	uint64_t published = 0;
+	uint32_t i;
+
+	(void)arg;
+	for (i = 0; i < BLOCK_LENGTH; i++)
+	{
+		block[i] = (int8_t)i;
+	}
+
+	gettimeofday(&t_start, NULL);
+	while (!fake_stop)
+	{
+		const double due = published * (BLOCK_LENGTH / 2.0) / metadata.sample_rate_hz;
+		double elapsed;
+
+		hackrf_shm_publisher_write(publisher, block, BLOCK_LENGTH);
+		published++;
+		gettimeofday(&t_now, NULL);
+		elapsed = TimevalDiff(&t_now, &t_start);
+		if (due > elapsed)
+		{
+			usleep((useconds_t)((due - elapsed) * 1e6));
+		}
+	}
+	return NULL;
+}
+
+static int device_start_rx(void)
+{
+	int result;
+
+	if (streaming)
+	{
+		return HACKRF_SUCCESS;
+	}
+	if (fake)
+	{
+		fake_stop = false;
+		result = (pthread_create(&fake_thread, NULL, fake_threadproc, NULL) == 0)
+				? HACKRF_SUCCESS : HACKRF_ERROR_THREAD;
+	}
+	else
+	{
+		result = hackrf_start_rx(device, hackrf_shm_publisher_rx_callback, publisher);
+	}
+	streaming = (result == HACKRF_SUCCESS);
+	return result;
+}
+
+static int device_stop_rx(void)
+{
+	int result = HACKRF_SUCCESS;
+
+	if (!streaming)
+	{
+		return HACKRF_SUCCESS;
+	}
+	if (fake)
+	{
+		fake_stop = true;
+		pthread_join(fake_thread, NULL);
+	}
+	else
+	{
+		result = hackrf_stop_rx(device);
+	}
+	streaming = false;
+	return result;
+}
+
+static int device_set(const uint32_t type, const uint64_t value)
+{
+	int result = HACKRF_SUCCESS;
+
+	switch (type)
+	{
+	case HACKRF_CLIENT_SET_FREQ:
+		if (value == metadata.freq_hz)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_freq(device, value);
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.freq_hz = value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_SAMPLE_RATE:
+		if ((value == 0) || (value > 0xffffffffull))
+		{
+			return HACKRF_ERROR_INVALID_PARAM;
+		}
+		if (value == metadata.sample_rate_hz)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_sample_rate(device, (double)value);
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.sample_rate_hz = (uint32_t)value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_BASEBAND_FILTER:
+		if (value == baseband_filter_hz)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_baseband_filter_bandwidth(device, (uint32_t)value);
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			baseband_filter_hz = (uint32_t)value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_LNA_GAIN:
+		if (value == metadata.lna_gain)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_lna_gain(device, (uint32_t)value);
+		}
+		else if (value > 40)
+		{
+			result = HACKRF_ERROR_INVALID_PARAM;
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.lna_gain = (uint8_t)value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_VGA_GAIN:
+		if (value == metadata.vga_gain)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_vga_gain(device, (uint32_t)value);
+		}
+		else if (value > 62)
+		{
+			result = HACKRF_ERROR_INVALID_PARAM;
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.vga_gain = (uint8_t)value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_TXVGA_GAIN:
+		if (value == metadata.txvga_gain)
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_txvga_gain(device, (uint32_t)value);
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.txvga_gain = (uint8_t)value;
+		}
+		break;
+
+	case HACKRF_CLIENT_SET_AMP_ENABLE:
+		if ((value != 0) == (metadata.amp_enable != 0))
+		{
+			return HACKRF_SUCCESS;
+		}
+		if (!fake)
+		{
+			result = hackrf_set_amp_enable(device, (uint8_t)(value != 0));
+		}
+		if (result == HACKRF_SUCCESS)
+		{
+			metadata.amp_enable = (uint8_t)(value != 0);
+		}
+		break;
+
+	default:
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (result == HACKRF_SUCCESS)
+	{
+		hackrf_shm_publisher_set_metadata(publisher, &metadata);
+		/* Before the reply, so the client syncs to the new generation. */
+		hackrf_shm_publisher_new_generation(publisher,
+				!streaming ? 0 : (fake ? 1 : DRAIN_BLOCKS));
+	}
+	return result;
+}
+
+static bool reply(const int fd, const int result, const char* payload)
+{
+	hackrf_client_frame frame;
+	const uint32_t length = (payload != NULL) ? (uint32_t)strlen(payload) : 0;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.type = HACKRF_CLIENT_REPLY;
+	frame.length = length;
+	frame.value = (uint64_t)(int64_t)result;
+	if (send(fd, &frame, sizeof(frame), MSG_NOSIGNAL) != sizeof(frame))
+	{
+		return false;
+	}
+	return (length == 0) || (send(fd, payload, length, MSG_NOSIGNAL) == (ssize_t)length);
+}
+
+/* Read what the client has sent and handle the request once its frame is
+   complete. Client sockets are non-blocking, so one that stops part way
+   through a frame holds up nobody else. Returns false to drop the client. */
+static bool serve_client(client_t* client, const char* shm_name)
+{
+	hackrf_client_frame frame;
+	ssize_t n;
+	int result;
+
+	n = recv(client->fd, (char*)&client->frame + client->received,
+			sizeof(client->frame) - client->received, 0);
+	if (n < 0)
+	{
+		return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+	}
+	if (n == 0)
+	{
+		return false;
+	}
+	client->received += (size_t)n;
+	if (client->received < sizeof(client->frame))
+	{
+		return true;
+	}
+	frame = client->frame;
+	client->received = 0;
+
+	switch (frame.type)
+	{
+	case HACKRF_CLIENT_START_RX:
+		result = device_start_rx();
+		if (result == HACKRF_SUCCESS)
+		{
+			client->receiving = true;
+		}
+		return reply(client->fd, result, (result == HACKRF_SUCCESS) ? shm_name : NULL);
+
+	case HACKRF_CLIENT_STOP_RX:
+		/* The device keeps streaming until the idle timeout. */
+		client->receiving = false;
+		return reply(client->fd, HACKRF_SUCCESS, NULL);
+
+	default:
+		return reply(client->fd, device_set(frame.type, frame.value), NULL);
+	}
+}
+
+static int listen_socket(const char* path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	if ((bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(fd, MAX_CLIENTS) != 0))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void serve(const int listen_fd, const char* shm_name, const uint32_t idle_seconds)
+{
+	static client_t clients[MAX_CLIENTS];
+	struct pollfd fds[MAX_CLIENTS + 1];
+	struct timeval idle_since, now;
+	uint32_t num_clients = 0;
+	uint32_t i;
+	bool receivers;
+	int fd;
+
+	gettimeofday(&idle_since, NULL);
+	while (!do_exit)
+	{
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		for (i = 0; i < num_clients; i++)
+		{
+			fds[i + 1].fd = clients[i].fd;
+			fds[i + 1].events = POLLIN;
+		}
+		if ((poll(fds, num_clients + 1, 500) < 0) && (errno != EINTR))
+		{
+			break;
+		}
+
+		/* Clients first, accepting appends to the array. */
+		for (i = num_clients; i > 0; i--)
+		{
+			if ((fds[i].revents != 0) && !serve_client(&clients[i - 1], shm_name))
+			{
+				close(clients[i - 1].fd);
+				clients[i - 1] = clients[--num_clients];
+			}
+		}
+		if (fds[0].revents & POLLIN)
+		{
+			fd = accept(listen_fd, NULL, NULL);
+			if ((fd >= 0) && (num_clients < MAX_CLIENTS)
+					&& (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0))
+			{
+				clients[num_clients].fd = fd;
+				clients[num_clients].receiving = false;
+				clients[num_clients].received = 0;
+				num_clients++;
+			}
+			else if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+
+		receivers = false;
+		for (i = 0; i < num_clients; i++)
+		{
+			receivers |= clients[i].receiving;
+		}
+		gettimeofday(&now, NULL);
+		if (receivers || !streaming)
+		{
+			idle_since = now;
+		}
+		else if (TimevalDiff(&now, &idle_since) >= idle_seconds)
+		{
+			device_stop_rx();
+			printf("idle, RX stopped\n");
+		}
+		if (!fake && streaming && (hackrf_is_streaming(device) != HACKRF_TRUE))
+		{
+			/* Streaming failed underneath us; the next START_RX restarts it. */
+			device_stop_rx();
+			printf("RX stopped by device\n");
+		}
+	}
+
+	for (i = 0; i < num_clients; i++)
+	{
+		close(clients[i].fd);
+	}
+}
+
+static void usage()
+{
+	printf("Usage:\n");
+	printf("\t[-u socket] # Control socket (default %s).\n", HACKRF_CLIENT_DEFAULT_SOCKET);
+	printf("\t[-n name] # Shared memory name (default %s).\n", DEFAULT_SHM_NAME);
+	printf("\t[-S slots] # Ring length in blocks (default %u).\n", HACKRF_SHM_DEFAULT_SLOT_COUNT);
+	printf("\t[-I seconds] # Stop RX this long after the last client stops (default %u).\n", DEFAULT_IDLE_SECONDS);
+	printf("\t[-f freq_hz] # Initial frequency in Hz (default %" PRIu64 ").\n", (uint64_t)DEFAULT_FREQ_HZ);
+	printf("\t[-s sample_rate_hz] # Initial sample rate in Hz (default %u).\n", DEFAULT_SAMPLE_RATE_HZ);
+	printf("\t[-a amp_enable] # Initial RX RF amplifier 1=Enable, 0=Disable.\n");
+	printf("\t[-l gain_db] # Initial RX LNA (IF) gain, 0-40dB, 8dB steps.\n");
+	printf("\t[-g gain_db] # Initial RX VGA (baseband) gain, 0-62dB, 2dB steps.\n");
+	printf("\t[-F] # Fake device: synthetic stream at the sample rate, no hardware.\n");
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int result = HACKRF_SUCCESS;
+	const char* socket_path = HACKRF_CLIENT_DEFAULT_SOCKET;
+	const char* shm_name = DEFAULT_SHM_NAME;
+	uint32_t slot_count = HACKRF_SHM_DEFAULT_SLOT_COUNT;
+	uint32_t idle_seconds = DEFAULT_IDLE_SECONDS;
+	uint64_t freq_hz = DEFAULT_FREQ_HZ;
+	uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+	uint32_t amp_enable = 0;
+	uint32_t lna_gain = 8, vga_gain = 20;
+	int listen_fd;
+
+	while( (opt = getopt(argc, argv, "u:n:S:I:f:s:a:l:g:F")) != EOF )
+	{
+		switch( opt )
+		{
+		case 'u':
+			socket_path = optarg;
+			break;
+
+		case 'n':
+			shm_name = optarg;
+			break;
+
+		case 'S':
+			result = parse_u32(optarg, &slot_count);
+			break;
+
+		case 'I':
+			result = parse_u32(optarg, &idle_seconds);
+			break;
+
+		case 'f':
+			result = parse_u64(optarg, &freq_hz);
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'a':
+			result = parse_u32(optarg, &amp_enable);
+			break;
+
+		case 'l':
+			result = parse_u32(optarg, &lna_gain);
+			break;
+
+		case 'g':
+			result = parse_u32(optarg, &vga_gain);
+			break;
+
+		case 'F':
+			fake = true;
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		if( result != HACKRF_SUCCESS ) {
+			printf("argument error: '-%c %s' %s (%d)\n", opt, optarg, hackrf_error_name(result), result);
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( sample_rate_hz == 0 ) {
+		printf("argument error: sample rate must be non-zero\n");
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+	signal(SIGPIPE, SIG_IGN);
+
+	result = hackrf_shm_publisher_create(&publisher, shm_name, BLOCK_LENGTH, slot_count);
+	if( result != HACKRF_SUCCESS ) {
+		printf("hackrf_shm_publisher_create() failed: %s (%d)\n", hackrf_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	memset(&metadata, 0, sizeof(metadata));
+	metadata.freq_hz = freq_hz;
+	metadata.sample_rate_hz = sample_rate_hz;
+	metadata.lna_gain = (uint8_t)lna_gain;
+	metadata.vga_gain = (uint8_t)vga_gain;
+	metadata.amp_enable = (uint8_t)amp_enable;
+	baseband_filter_hz = hackrf_compute_baseband_filter_bw_round_down_lt(sample_rate_hz);
+	hackrf_shm_publisher_set_metadata(publisher, &metadata);
+
+	if( !fake ) {
+		result = hackrf_init();
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_init() failed: %s (%d)\n", hackrf_error_name(result), result);
+			hackrf_shm_publisher_destroy(publisher);
+			return EXIT_FAILURE;
+		}
+		result = hackrf_open(&device);
+		if( result != HACKRF_SUCCESS ) {
+			printf("hackrf_open() failed: %s (%d)\n", hackrf_error_name(result), result);
+			hackrf_shm_publisher_destroy(publisher);
+			hackrf_exit();
+			return EXIT_FAILURE;
+		}
+
+		result = hackrf_set_sample_rate(device, sample_rate_hz);
+		result |= hackrf_set_baseband_filter_bandwidth(device, baseband_filter_hz);
+		result |= hackrf_set_freq(device, freq_hz);
+		result |= hackrf_set_amp_enable(device, (uint8_t)amp_enable);
+		result |= hackrf_set_vga_gain(device, vga_gain);
+		result |= hackrf_set_lna_gain(device, lna_gain);
+		if( result != HACKRF_SUCCESS ) {
+			printf("device setup failed: %s (%d)\n", hackrf_error_name(result), result);
+			hackrf_close(device);
+			hackrf_exit();
+			hackrf_shm_publisher_destroy(publisher);
+			return EXIT_FAILURE;
+		}
+	}
+
+	listen_fd = listen_socket(socket_path);
+	if( listen_fd < 0 ) {
+		printf("Failed to listen on %s\n", socket_path);
+		result = HACKRF_ERROR_OTHER;
+	} else {
+		printf("hackrfd listening on %s, samples on %s%s\n", socket_path, shm_name,
+				fake ? " (fake device)" : "");
+		serve(listen_fd, shm_name, idle_seconds);
+		close(listen_fd);
+		unlink(socket_path);
+	}
+
+	device_stop_rx();
+	if( !fake ) {
+		hackrf_close(device);
+		hackrf_exit();
+	}
+	hackrf_shm_publisher_destroy(publisher);
+	return (result == HACKRF_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -21,13 +21,42 @@ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABI
 ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifdef __linux__
+/* pthread_setaffinity_np(), RUSAGE_THREAD */
+#define _GNU_SOURCE
+#endif
+
 #include "hackrf.h"
+#include "hackrf_nco.h"
+#include "hackrf_resampler.h"
+#include "hackrf_simd.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include <libusb.h>
 #include <pthread.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+/* Orders the stats sequence counter against the counters it guards. */
+#if defined(__GNUC__)
+#define stats_barrier() __sync_synchronize()
+#elif defined(_MSC_VER)
+#define stats_barrier() MemoryBarrier()
+#else
+#define stats_barrier()
+#endif
+
 #ifndef bool
 typedef int bool;
 #define true 1
@@ -67,6 +96,13 @@ typedef enum {
 	HACKRF_VENDOR_REQUEST_SET_TXVGA_GAIN = 21,
 	HACKRF_VENDOR_REQUEST_ANTENNA_ENABLE = 23,
 	HACKRF_VENDOR_REQUEST_SET_FREQ_EXPLICIT = 24,
+	HACKRF_VENDOR_REQUEST_PERF_READ = 25,
+	HACKRF_VENDOR_REQUEST_EVENT_LOG_READ = 26,
+	HACKRF_VENDOR_REQUEST_SPIFLASH_WRITE_BULK = 27,
+	HACKRF_VENDOR_REQUEST_SPIFLASH_STATUS = 28,
+	HACKRF_VENDOR_REQUEST_SPIFLASH_CRC = 29,
+	HACKRF_VENDOR_REQUEST_SPIFLASH_READ_BULK = 30,
+	HACKRF_VENDOR_REQUEST_CPLD_STATUS = 31,
 } hackrf_vendor_request;
 
 typedef enum {
@@ -86,6 +122,28 @@ struct hackrf_device {
 	volatile bool streaming; /* volatile shared between threads (read only) */
 	void* rx_ctx;
 	void* tx_ctx;
+	pthread_mutex_t tune_lock; /* protects the tuning state below */
+	uint64_t hw_freq_hz; /* 0 when unknown */
+	int64_t fine_offset_hz; /* requested frequency minus hw_freq_hz */
+	uint32_t sample_rate_hz;
+	uint32_t baseband_filter_hz;
+	int32_t offset_tuning_hz; /* hardware LO distance from the requested frequency */
+	hackrf_nco nco; /* transfer thread only */
+	hackrf_resampler* decimator; /* offset tuning RX decimation, NULL when off */
+	int8_t* decimator_output;
+	uint32_t decimator_count;
+	hackrf_thread_config thread_config;
+	hackrf_thread_stats thread_stats; /* written by the transfer thread */
+	/* Streaming counters and thread_stats. Written only by whichever thread
+	   owns the transfers; stats_seq is odd while an update is in progress so
+	   readers can retry instead of taking a lock. */
+	volatile uint32_t stats_seq;
+	hackrf_stats stats;
+	uint64_t last_completion_us; /* 0 before the first completion */
+#ifdef HACKRF_TRACE
+	struct trace_ring* trace; /* NULL until hackrf_trace_start() */
+	volatile bool trace_enabled;
+#endif
 };
 
 typedef struct {
@@ -112,6 +170,11 @@ static const max2837_ft_t max2837_ft[] = {
 	{ 0        }
 };
 
+/* Fraction of the usable bandwidth hackrf_set_freq_fine() reaches with the
+ * NCO alone, leaving room for the baseband filter roll-off.
+ */
+#define FINE_TUNE_PASSBAND_FRACTION (0.8)
+
 volatile bool do_exit = false;
 
 static const uint16_t hackrf_usb_vid = 0x1d50;
@@ -125,6 +188,114 @@ static void request_exit(void)
 	do_exit = true;
 }
 
+static uint64_t stats_time_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (uint64_t)(count.QuadPart / frequency.QuadPart * 1000000
+			+ (count.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
+
+static uint32_t stats_bin(uint64_t us)
+{
+	uint32_t bin = 0;
+	while( ((us >>= 1) != 0) && (bin < (HACKRF_STATS_HISTOGRAM_BINS - 1)) )
+	{
+		bin++;
+	}
+	return bin;
+}
+
+static void stats_begin(hackrf_device* device)
+{
+	device->stats_seq++;
+	stats_barrier();
+}
+
+static void stats_end(hackrf_device* device)
+{
+	stats_barrier();
+	device->stats_seq++;
+}
+
+#ifdef HACKRF_TRACE
+
+#define TRACE_DEFAULT_CAPACITY (65536)
+
+enum trace_type {
+	TRACE_SUBMIT = 1,
+	TRACE_COMPLETE = 2,
+	TRACE_CALLBACK_BEGIN = 3,
+	TRACE_CALLBACK_END = 4,
+	TRACE_RESUBMIT_FAILED = 5,
+	TRACE_CANCEL = 6,
+};
+
+typedef struct {
+	uint64_t time_us;
+	uint8_t type;
+	uint8_t status;    /* libusb_transfer_status for TRACE_COMPLETE */
+	uint16_t transfer; /* index into device->transfers */
+	uint32_t length;
+} trace_event_t;
+
+/* Single producer ring: events are only ever recorded by the thread that
+   owns the transfers, and head is published after the event is written.
+   Only that thread writes head; a restart moves start up to it instead. */
+struct trace_ring {
+	trace_event_t* events;
+	uint32_t capacity; /* power of two */
+	volatile uint64_t head;
+	uint64_t start;    /* index of the first event since hackrf_trace_start() */
+	uint64_t start_us;
+};
+
+static void trace_event(hackrf_device* device, const uint8_t type,
+		const struct libusb_transfer* usb_transfer, const uint8_t status,
+		const uint32_t length)
+{
+	struct trace_ring* const ring = device->trace;
+	trace_event_t* event;
+	uint64_t head;
+	uint32_t transfer_index = 0;
+
+	if( (ring == NULL) || !device->trace_enabled )
+	{
+		return;
+	}
+	while( (transfer_index < device->transfer_count)
+			&& (device->transfers[transfer_index] != usb_transfer) )
+	{
+		transfer_index++;
+	}
+
+	head = ring->head;
+	event = &ring->events[head & (ring->capacity - 1)];
+	event->time_us = stats_time_us();
+	event->type = type;
+	event->status = status;
+	event->transfer = (uint16_t)transfer_index;
+	event->length = length;
+	stats_barrier();
+	ring->head = head + 1;
+}
+
+#define TRACE(device, type, usb_transfer, status, length) \
+	trace_event((device), (type), (usb_transfer), (status), (length))
+
+#else
+
+#define TRACE(device, type, usb_transfer, status, length)
+
+#endif /* HACKRF_TRACE */
+
 static int cancel_transfers(hackrf_device* device)
 {
 	uint32_t transfer_index;
@@ -136,6 +307,7 @@ static int cancel_transfers(hackrf_device* device)
 			if( device->transfers[transfer_index] != NULL )
 			{
 				libusb_cancel_transfer(device->transfers[transfer_index]);
+				TRACE(device, TRACE_CANCEL, device->transfers[transfer_index], 0, 0);
 			}
 		}
 		return HACKRF_SUCCESS;
@@ -225,6 +397,11 @@ static int prepare_transfers(
 			{
 				return HACKRF_ERROR_LIBUSB;
 			}
+			TRACE(device, TRACE_SUBMIT, device->transfers[transfer_index], 0,
+					device->buffer_size);
+			stats_begin(device);
+			device->stats.in_flight++;
+			stats_end(device);
 		}
 		return HACKRF_SUCCESS;
 	} else {
@@ -320,11 +497,29 @@ int ADDCALL hackrf_open(hackrf_device** device)
 	lib_device->transfer_count = 4;
 	lib_device->buffer_size = 262144; /* 1048576; */
 	lib_device->streaming = false;
+	pthread_mutex_init(&lib_device->tune_lock, NULL);
+	lib_device->hw_freq_hz = 0;
+	lib_device->fine_offset_hz = 0;
+	lib_device->sample_rate_hz = 0;
+	lib_device->baseband_filter_hz = 0;
+	lib_device->offset_tuning_hz = 0;
+	hackrf_nco_init(&lib_device->nco);
+	lib_device->decimator = NULL;
+	memset(&lib_device->thread_config, 0, sizeof(lib_device->thread_config));
+	memset(&lib_device->thread_stats, 0, sizeof(lib_device->thread_stats));
+	lib_device->stats_seq = 0;
+	memset(&lib_device->stats, 0, sizeof(lib_device->stats));
+	lib_device->last_completion_us = 0;
+#ifdef HACKRF_TRACE
+	lib_device->trace = NULL;
+	lib_device->trace_enabled = false;
+#endif
 	do_exit = false;
 
 	result = allocate_transfers(lib_device);
 	if( result != 0 )
 	{
+		pthread_mutex_destroy(&lib_device->tune_lock);
 		free(lib_device);
 		libusb_release_interface(usb_device, 0);
 		libusb_close(usb_device);
@@ -498,6 +693,9 @@ int ADDCALL hackrf_set_baseband_filter_bandwidth(hackrf_device* device, const ui
 	{
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		pthread_mutex_lock(&device->tune_lock);
+		device->baseband_filter_hz = bandwidth_hz;
+		pthread_mutex_unlock(&device->tune_lock);
 		return HACKRF_SUCCESS;
 	}
 }
@@ -639,9 +837,248 @@ int ADDCALL hackrf_spiflash_read(hackrf_device* device, const uint32_t address,
 	}
 }
 
+/* Same CRC-32 as the firmware's crc32() */
+static uint32_t spiflash_crc32(uint32_t crc, const unsigned char* data, uint32_t length)
+{
+	static const uint32_t nibble_table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+		0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+		0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+	};
+	uint32_t i;
+
+	crc = ~crc;
+	for (i = 0; i < length; i++)
+	{
+		crc ^= data[i];
+		crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+		crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+int ADDCALL hackrf_spiflash_status_read(hackrf_device* device, hackrf_spiflash_status* status)
+{
+	int result;
+	
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_STATUS,
+		0,
+		0,
+		(unsigned char*)status,
+		sizeof(hackrf_spiflash_status),
+		0
+	);
+
+	if (result < (int)sizeof(hackrf_spiflash_status))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		status->state = TO_LE(status->state);
+		status->address = TO_LE(status->address);
+		status->length = TO_LE(status->length);
+		status->received = TO_LE(status->received);
+		status->sectors_erased = TO_LE(status->sectors_erased);
+		status->sectors_unchanged = TO_LE(status->sectors_unchanged);
+		status->pages_programmed = TO_LE(status->pages_programmed);
+		status->crc_received = TO_LE(status->crc_received);
+		status->crc_flash = TO_LE(status->crc_flash);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_spiflash_read_bulk(hackrf_device* device, const uint32_t address,
+		const uint32_t length, unsigned char* data)
+{
+	uint32_t params[2];
+	int transferred;
+	int result;
+
+	if ((length == 0) || (length > 0x100000) || (address > (0x100000 - length)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	params[0] = TO_LE(address);
+	params[1] = TO_LE(length);
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_READ_BULK,
+		0,
+		0,
+		(unsigned char*)params,
+		sizeof(params),
+		0
+	);
+	if (result < (int)sizeof(params))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	}
+
+	/* The firmware sends the whole range as one stream of 16 KiB transfers,
+	   so it can be received in one go. */
+	result = libusb_bulk_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | 1,
+		data,
+		length,
+		&transferred,
+		5000
+	);
+	if ((result != LIBUSB_SUCCESS) || (transferred != (int)length))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_spiflash_crc(hackrf_device* device, const uint32_t address,
+		const uint32_t length, uint32_t* crcs)
+{
+	const uint32_t count = (length + 0xFFF) >> 12;
+	const uint32_t last_length = length - ((count - 1) << 12);
+	uint32_t i;
+	int result;
+
+	if ((address & 0xFFF) || (length == 0) || (length > 0x100000)
+			|| (address > (0x100000 - length)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_CRC,
+		(address >> 12) | ((count - 1) << 8),
+		last_length,
+		(unsigned char*)crcs,
+		count * sizeof(uint32_t),
+		0
+	);
+
+	if (result < (int)(count * sizeof(uint32_t)))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		for (i = 0; i < count; i++)
+		{
+			crcs[i] = TO_LE(crcs[i]);
+		}
+		return HACKRF_SUCCESS;
+	}
+}
+
+/* 10 ms polls: 30 s */
+#define SPIFLASH_STATUS_POLL_MAX (3000)
+
+int ADDCALL hackrf_spiflash_write_bulk(hackrf_device* device, const uint32_t address,
+		const uint32_t length, unsigned char* const data, hackrf_spiflash_status* status)
+{
+	/* Matches the half of the firmware's bulk buffer it programs at a time */
+	const uint32_t chunk_size = 0x4000;
+	hackrf_spiflash_status local_status;
+	uint32_t params[2];
+	uint32_t offset;
+	uint32_t polls;
+	int transferred;
+	int result;
+
+	if ((address & 0xFFF) || (length == 0) || (length > 0x100000)
+			|| (address > (0x100000 - length)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (status == NULL)
+	{
+		status = &local_status;
+	}
+
+	params[0] = TO_LE(address);
+	params[1] = TO_LE(length);
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_SPIFLASH_WRITE_BULK,
+		0,
+		0,
+		(unsigned char*)params,
+		sizeof(params),
+		0
+	);
+	if (result < (int)sizeof(params))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	}
+
+	for (offset = 0; offset < length; offset += chunk_size)
+	{
+		const uint32_t chunk = ((length - offset) < chunk_size) ? (length - offset) : chunk_size;
+		result = libusb_bulk_transfer(
+			device->usb_device,
+			LIBUSB_ENDPOINT_OUT | 2,
+			&data[offset],
+			chunk,
+			&transferred,
+			10000 // long timeout, the firmware may be erasing sectors
+		);
+		if ((result != LIBUSB_SUCCESS) || (transferred != (int)chunk))
+		{
+			return HACKRF_ERROR_LIBUSB;
+		}
+	}
+
+	/* The firmware programs the last chunk and reads back the whole range
+	   after the data has been sent; allow well over that. */
+	for (polls = 0; ; polls++) {
+#ifdef _WIN32
+		Sleep(10);
+#else
+		const struct timespec poll_interval = { 0, 10000000 };
+		nanosleep(&poll_interval, NULL);
+#endif
+		result = hackrf_spiflash_status_read(device, status);
+		if (result != HACKRF_SUCCESS)
+		{
+			return result;
+		}
+		if (status->state != HACKRF_SPIFLASH_BUSY)
+		{
+			break;
+		}
+		if (polls == SPIFLASH_STATUS_POLL_MAX)
+		{
+			return HACKRF_ERROR_OTHER;
+		}
+	}
+
+	if ((status->state != HACKRF_SPIFLASH_DONE)
+			|| (status->crc_flash != spiflash_crc32(0, data, length)))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	return HACKRF_SUCCESS;
+}
+
 int ADDCALL hackrf_cpld_write(hackrf_device* device,
 		unsigned char* const data, const unsigned int total_length)
 {
+	return hackrf_cpld_write_with_progress(device, data, total_length, NULL, NULL);
+}
+
+int ADDCALL hackrf_cpld_write_with_progress(hackrf_device* device,
+		unsigned char* const data, const unsigned int total_length,
+		hackrf_cpld_progress_cb_fn callback, void* ctx)
+{
+	/* Matches the half of the firmware's bulk buffer it fills while the
+	   other half is shifted into the CPLD */
+	const unsigned int chunk_size = 0x4000;
+	unsigned int i;
+	int transferred = 0;
 	int result = libusb_release_interface(device->usb_device, 0);
 	if (result != LIBUSB_SUCCESS) {
 		return HACKRF_ERROR_LIBUSB;
@@ -657,20 +1094,38 @@ int ADDCALL hackrf_cpld_write(hackrf_device* device,
 		return HACKRF_ERROR_LIBUSB;
 	}
 
-	const unsigned int chunk_size = 512;
-	unsigned int i;
-	int transferred = 0;
 	for (i = 0; i < total_length; i += chunk_size)
 	{
+		const unsigned int chunk = ((total_length - i) < chunk_size) ? (total_length - i) : chunk_size;
 		result = libusb_bulk_transfer(
 			device->usb_device,
 			LIBUSB_ENDPOINT_OUT | 2,
 			&data[i],
-			chunk_size,
+			chunk,
 			&transferred,
 			10000 // long timeout to allow for CPLD programming
 		);
 
+		if ((result != LIBUSB_SUCCESS) || (transferred != (int)chunk)) {
+			return HACKRF_ERROR_LIBUSB;
+		}
+		if (callback != NULL) {
+			callback(ctx, i + chunk, total_length);
+		}
+	}
+
+	/* A short final chunk ends the firmware's receive buffer early. One of
+	   whole packets needs a zero length packet to do the same. */
+	if ((total_length % chunk_size) && !(total_length % 512))
+	{
+		result = libusb_bulk_transfer(
+			device->usb_device,
+			LIBUSB_ENDPOINT_OUT | 2,
+			data,
+			0,
+			&transferred,
+			10000
+		);
 		if (result != LIBUSB_SUCCESS) {
 			return HACKRF_ERROR_LIBUSB;
 		}
@@ -679,6 +1134,34 @@ int ADDCALL hackrf_cpld_write(hackrf_device* device,
 	return HACKRF_SUCCESS;
 }
 
+int ADDCALL hackrf_cpld_status_read(hackrf_device* device, hackrf_cpld_status* status)
+{
+	int result;
+
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_CPLD_STATUS,
+		0,
+		0,
+		(unsigned char*)status,
+		sizeof(hackrf_cpld_status),
+		0
+	);
+
+	if (result < (int)sizeof(hackrf_cpld_status))
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		status->state = TO_LE(status->state);
+		status->error = TO_LE(status->error);
+		status->received = TO_LE(status->received);
+		status->cycles = TO_LE(status->cycles);
+		status->wait_cycles = TO_LE(status->wait_cycles);
+		return HACKRF_SUCCESS;
+	}
+}
+
 int ADDCALL hackrf_board_id_read(hackrf_device* device, uint8_t* value)
 {
 	int result;
@@ -739,10 +1222,17 @@ int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz)
 	set_freq_params_t set_freq_params;
 	uint8_t length;
 	int result;
+	uint64_t hw_freq_hz;
+
+	/* With offset tuning the LO sits beside the requested frequency and the
+	   transfer thread shifts the signal back to the center. */
+	pthread_mutex_lock(&device->tune_lock);
+	hw_freq_hz = freq_hz + device->offset_tuning_hz;
+	pthread_mutex_unlock(&device->tune_lock);
 	
 	/* Convert Freq Hz 64bits to Freq MHz (32bits) & Freq Hz (32bits) */
-	l_freq_mhz = (uint32_t)(freq_hz / FREQ_ONE_MHZ);
-	l_freq_hz = (uint32_t)(freq_hz - (((uint64_t)l_freq_mhz) * FREQ_ONE_MHZ));
+	l_freq_mhz = (uint32_t)(hw_freq_hz / FREQ_ONE_MHZ);
+	l_freq_hz = (uint32_t)(hw_freq_hz - (((uint64_t)l_freq_mhz) * FREQ_ONE_MHZ));
 	set_freq_params.freq_mhz = TO_LE(l_freq_mhz);
 	set_freq_params.freq_hz = TO_LE(l_freq_hz);
 	length = sizeof(set_freq_params_t);
@@ -762,8 +1252,102 @@ int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz)
 	{
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		pthread_mutex_lock(&device->tune_lock);
+		device->hw_freq_hz = hw_freq_hz;
+		device->fine_offset_hz = (int64_t)(freq_hz - hw_freq_hz);
+		pthread_mutex_unlock(&device->tune_lock);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_set_freq_fine(hackrf_device* device, const uint64_t freq_hz)
+{
+	uint64_t hw_freq_hz;
+	uint32_t bandwidth_hz;
+	int64_t offset_hz;
+
+	pthread_mutex_lock(&device->tune_lock);
+	hw_freq_hz = device->hw_freq_hz;
+	bandwidth_hz = device->sample_rate_hz;
+	if( (device->baseband_filter_hz != 0) && (device->baseband_filter_hz < bandwidth_hz) )
+	{
+		bandwidth_hz = device->baseband_filter_hz;
+	}
+	offset_hz = (int64_t)(freq_hz - hw_freq_hz);
+
+	if( (hw_freq_hz != 0) && (bandwidth_hz != 0) &&
+		((offset_hz < 0 ? -offset_hz : offset_hz) <= (int64_t)(bandwidth_hz * FINE_TUNE_PASSBAND_FRACTION / 2)) )
+	{
+		/* Picked up by the transfer thread at the next buffer. */
+		device->fine_offset_hz = offset_hz;
+		pthread_mutex_unlock(&device->tune_lock);
 		return HACKRF_SUCCESS;
 	}
+	pthread_mutex_unlock(&device->tune_lock);
+
+	return hackrf_set_freq(device, freq_hz);
+}
+
+static int offset_tuning_output(const float* samples, uint32_t sample_count, void* ctx)
+{
+	hackrf_device* device = (hackrf_device*)ctx;
+
+	/* The decimator has converted its whole input before producing any
+	   output, so writing back into the transfer buffer is safe. */
+	simd_f32_to_s8(&device->decimator_output[2 * device->decimator_count],
+			samples, 2 * sample_count);
+	device->decimator_count += sample_count;
+	return 0;
+}
+
+int ADDCALL hackrf_set_offset_tuning(hackrf_device* device,
+		const int32_t offset_hz, const uint32_t decimation)
+{
+	hackrf_resampler* decimator = NULL;
+	uint64_t freq_hz;
+	bool tuned;
+	int result;
+
+	if( (decimation == 0) || (decimation > HACKRF_OFFSET_TUNING_MAX_DECIMATION) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* Buffer lengths change with decimation, not while streaming. */
+	if( device->transfer_thread_started != false )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( decimation > 1 )
+	{
+		result = hackrf_resampler_create(&decimator, decimation, 1, 0,
+				offset_tuning_output, device);
+		if( result != HACKRF_SUCCESS )
+		{
+			return result;
+		}
+	}
+
+	if( device->decimator != NULL )
+	{
+		hackrf_resampler_destroy(device->decimator);
+	}
+	device->decimator = decimator;
+
+	pthread_mutex_lock(&device->tune_lock);
+	tuned = (device->hw_freq_hz != 0);
+	freq_hz = device->hw_freq_hz + device->fine_offset_hz;
+	device->offset_tuning_hz = offset_hz;
+	pthread_mutex_unlock(&device->tune_lock);
+
+	/* Move the LO for the new offset right away if we already have a
+	   frequency, otherwise it applies from the next hackrf_set_freq(). */
+	if( tuned )
+	{
+		return hackrf_set_freq(device, freq_hz);
+	}
+	return HACKRF_SUCCESS;
 }
 
 struct set_freq_explicit_params {
@@ -813,6 +1397,12 @@ int ADDCALL hackrf_set_freq_explicit(hackrf_device* device,
 	{
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		/* The resulting RF frequency depends on the mixer side, so fine
+		   tuning has no reference until the next hackrf_set_freq(). */
+		pthread_mutex_lock(&device->tune_lock);
+		device->hw_freq_hz = 0;
+		device->fine_offset_hz = 0;
+		pthread_mutex_unlock(&device->tune_lock);
 		return HACKRF_SUCCESS;
 	}
 }
@@ -849,6 +1439,9 @@ int ADDCALL hackrf_set_sample_rate_manual(hackrf_device* device,
 	{
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		pthread_mutex_lock(&device->tune_lock);
+		device->sample_rate_hz = (divider != 0) ? (freq_hz / divider) : 0;
+		pthread_mutex_unlock(&device->tune_lock);
 		return HACKRF_SUCCESS;
 	}
 }
@@ -948,6 +1541,94 @@ int ADDCALL hackrf_board_partid_serialno_read(hackrf_device* device, read_partid
 	}
 }
 
+static void perf_counter_from_le(hackrf_perf_counter* counter)
+{
+	counter->count = TO_LE(counter->count);
+	counter->min = TO_LE(counter->min);
+	counter->max = TO_LE(counter->max);
+	counter->total = TO_LE(counter->total);
+}
+
+static void usb_queue_stats_from_le(hackrf_usb_queue_stats* stats)
+{
+	stats->depth = TO_LE(stats->depth);
+	stats->high_water = TO_LE(stats->high_water);
+	stats->alloc_failures = TO_LE(stats->alloc_failures);
+	stats->spin_cycles = TO_LE(stats->spin_cycles);
+}
+
+int ADDCALL hackrf_perf_read(hackrf_device* device, hackrf_perf* perf, const uint8_t clear)
+{
+	uint8_t length;
+	int result;
+	
+	length = sizeof(hackrf_perf);
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_PERF_READ,
+		clear ? 1 : 0,
+		0,
+		(unsigned char*)perf,
+		length,
+		0
+	);
+
+	if (result < length)
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		perf->cycles = TO_LE(perf->cycles);
+		perf_counter_from_le(&perf->sgpio_isr);
+		perf_counter_from_le(&perf->usb_isr);
+		perf_counter_from_le(&perf->main_loop);
+		perf_counter_from_le(&perf->slack);
+		perf->overruns = TO_LE(perf->overruns);
+		perf->sleeps = TO_LE(perf->sleeps);
+		perf_counter_from_le(&perf->latency);
+		usb_queue_stats_from_le(&perf->bulk_in);
+		usb_queue_stats_from_le(&perf->bulk_out);
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_event_log_read(hackrf_device* device, hackrf_event_log* log, const uint8_t clear)
+{
+	uint16_t length;
+	uint32_t i;
+	int result;
+	
+	length = sizeof(hackrf_event_log);
+	result = libusb_control_transfer(
+		device->usb_device,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+		HACKRF_VENDOR_REQUEST_EVENT_LOG_READ,
+		clear ? 1 : 0,
+		0,
+		(unsigned char*)log,
+		length,
+		0
+	);
+
+	if (result < length)
+	{
+		return HACKRF_ERROR_LIBUSB;
+	} else {
+		log->magic = TO_LE(log->magic);
+		log->index = TO_LE(log->index);
+		log->dropped = TO_LE(log->dropped);
+		log->boots = TO_LE(log->boots);
+		for (i = 0; i < HACKRF_EVENT_LOG_LENGTH; i++)
+		{
+			log->entries[i].timestamp = TO_LE(log->entries[i].timestamp);
+			log->entries[i].id = TO_LE(log->entries[i].id);
+			log->entries[i].arg[0] = TO_LE(log->entries[i].arg[0]);
+			log->entries[i].arg[1] = TO_LE(log->entries[i].arg[1]);
+		}
+		return HACKRF_SUCCESS;
+	}
+}
+
 int ADDCALL hackrf_set_lna_gain(hackrf_device* device, uint32_t value)
 {
 	int result;
@@ -1057,12 +1738,98 @@ int ADDCALL hackrf_set_antenna_enable(hackrf_device* device, const uint8_t value
 	}
 }
 
+static void thread_error(hackrf_thread_stats* stats, const int error)
+{
+	if( stats->error == 0 )
+	{
+		stats->error = error;
+	}
+}
+
+/* Runs on the transfer thread itself so the settings apply to it alone. */
+static void apply_thread_config(hackrf_device* device)
+{
+	const hackrf_thread_config* const config = &device->thread_config;
+	hackrf_thread_stats* const stats = &device->thread_stats;
+#ifndef _WIN32
+	struct sched_param param;
+	int result;
+
+	if( config->policy != HACKRF_SCHED_DEFAULT )
+	{
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = (int)config->priority;
+		result = pthread_setschedparam(pthread_self(),
+				(config->policy == HACKRF_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR, &param);
+		if( result == 0 )
+		{
+			stats->realtime = true;
+		} else {
+			thread_error(stats, result);
+		}
+	}
+
+#ifdef __linux__
+	if( config->cpu_mask != 0 )
+	{
+		cpu_set_t set;
+		int cpu;
+
+		CPU_ZERO(&set);
+		for( cpu = 0; cpu < 64; cpu++ )
+		{
+			if( (config->cpu_mask >> cpu) & 1 )
+			{
+				CPU_SET(cpu, &set);
+			}
+		}
+		result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if( result == 0 )
+		{
+			stats->affinity = true;
+		} else {
+			thread_error(stats, result);
+		}
+	}
+#else
+	if( config->cpu_mask != 0 )
+	{
+		thread_error(stats, ENOSYS);
+	}
+#endif
+#else
+	if( (config->policy != HACKRF_SCHED_DEFAULT) || (config->cpu_mask != 0) )
+	{
+		thread_error(stats, ENOSYS);
+	}
+#endif
+}
+
+static void update_thread_stats(hackrf_device* device)
+{
+#ifdef __linux__
+	struct rusage usage;
+
+	if( getrusage(RUSAGE_THREAD, &usage) == 0 )
+	{
+		stats_begin(device);
+		device->thread_stats.involuntary_switches = (uint64_t)usage.ru_nivcsw;
+		device->thread_stats.voluntary_switches = (uint64_t)usage.ru_nvcsw;
+		stats_end(device);
+	}
+#endif
+}
+
 static void* transfer_threadproc(void* arg)
 {
 	hackrf_device* device = (hackrf_device*)arg;
 	int error;
 	struct timeval timeout = { 0, 500000 };
 
+	stats_begin(device);
+	apply_thread_config(device);
+	stats_end(device);
+
 	while( (device->streaming) && (do_exit == false) )
 	{
 		error = libusb_handle_events_timeout(g_libusb_context, &timeout);
@@ -1070,33 +1837,175 @@ static void* transfer_threadproc(void* arg)
 		{
 			device->streaming = false;
 		}
+		update_thread_stats(device);
 	}
 
 	return NULL;
 }
 
+/* Keep the transfer buffers resident so a callback never waits on a page
+   fault. Memory locking is per process, so this runs on the caller. */
+static void lock_transfer_buffers(hackrf_device* device, const bool lock)
+{
+#ifndef _WIN32
+	uint32_t transfer_index;
+	int result;
+
+	for( transfer_index = 0; transfer_index < device->transfer_count; transfer_index++ )
+	{
+		unsigned char* const buffer = device->transfers[transfer_index]->buffer;
+		if( lock )
+		{
+			result = mlock(buffer, device->buffer_size);
+			if( result != 0 )
+			{
+				thread_error(&device->thread_stats, errno);
+				/* All or nothing: memory_locked stays false, so nothing
+				   would unlock these later. */
+				while( transfer_index > 0 )
+				{
+					transfer_index--;
+					munlock(device->transfers[transfer_index]->buffer, device->buffer_size);
+				}
+				return;
+			}
+		} else {
+			munlock(buffer, device->buffer_size);
+		}
+	}
+	device->thread_stats.memory_locked = lock;
+#else
+	if( lock )
+	{
+		thread_error(&device->thread_stats, ENOSYS);
+	}
+#endif
+}
+
+/* Shift the buffer by the fine tuning offset: down to baseband on receive,
+ * up from baseband on transmit.
+ */
+static void fine_tune_buffer(hackrf_device* device, uint8_t* buffer,
+		const int length, const bool transmit)
+{
+	double freq = 0.0;
+
+	pthread_mutex_lock(&device->tune_lock);
+	if( device->sample_rate_hz != 0 )
+	{
+		freq = (double)device->fine_offset_hz / device->sample_rate_hz;
+	}
+	pthread_mutex_unlock(&device->tune_lock);
+
+	hackrf_nco_set_freq(&device->nco, transmit ? freq : -freq);
+	hackrf_nco_mix_s8(&device->nco, (int8_t*)buffer, length / 2);
+}
+
+/* resubmit: 1 resubmitted, -1 resubmit failed, 0 not attempted. */
+static void stats_completion(hackrf_device* device, const struct libusb_transfer* usb_transfer,
+		const uint64_t completed_us, const uint64_t callback_us, const int resubmit)
+{
+	hackrf_stats* const stats = &device->stats;
+	const uint64_t last_us = device->last_completion_us;
+
+	device->last_completion_us = completed_us;
+
+	stats_begin(device);
+	/* Stale cancellations from a previous session can arrive after the
+	   count was reset. */
+	if( stats->in_flight > 0 )
+	{
+		stats->in_flight--;
+	}
+	if( usb_transfer->status == LIBUSB_TRANSFER_COMPLETED )
+	{
+		stats->transfers++;
+		stats->bytes += usb_transfer->actual_length;
+		stats->callback_us[stats_bin(callback_us)]++;
+		if( callback_us > stats->callback_max_us )
+		{
+			stats->callback_max_us = (uint32_t)callback_us;
+		}
+	} else if( usb_transfer->status != LIBUSB_TRANSFER_CANCELLED ) {
+		stats->failed_transfers++;
+	}
+	if( last_us != 0 )
+	{
+		const uint64_t gap_us = completed_us - last_us;
+		stats->gap_us[stats_bin(gap_us)]++;
+		if( gap_us > stats->gap_max_us )
+		{
+			stats->gap_max_us = (uint32_t)gap_us;
+		}
+	}
+	if( resubmit > 0 )
+	{
+		stats->in_flight++;
+	} else if( resubmit < 0 ) {
+		stats->resubmit_failures++;
+	}
+	stats_end(device);
+}
+
 static void hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
 {
 	hackrf_device* device = (hackrf_device*)usb_transfer->user_data;
+	const bool transmit = ((usb_transfer->endpoint & LIBUSB_ENDPOINT_IN) == 0);
+	const uint64_t completed_us = stats_time_us();
+	uint64_t callback_us = 0;
+	int resubmit = 0;
+
+	TRACE(device, TRACE_COMPLETE, usb_transfer, (uint8_t)usb_transfer->status,
+			(uint32_t)usb_transfer->actual_length);
 
 	if(usb_transfer->status == LIBUSB_TRANSFER_COMPLETED)
 	{
-		hackrf_transfer transfer = {
-			transfer.device = device,
-			transfer.buffer = usb_transfer->buffer,
-			transfer.buffer_length = usb_transfer->length,
-			transfer.valid_length = usb_transfer->actual_length,
-			transfer.rx_ctx = device->rx_ctx,
-			transfer.tx_ctx = device->tx_ctx
-		};
+		hackrf_transfer transfer;
+		uint64_t callback_start_us;
+		int callback_result;
 
-		if( device->callback(&transfer) == 0 )
+		if( !transmit )
 		{
+			fine_tune_buffer(device, usb_transfer->buffer, usb_transfer->actual_length, false);
+			if( device->decimator != NULL )
+			{
+				device->decimator_output = (int8_t*)usb_transfer->buffer;
+				device->decimator_count = 0;
+				hackrf_resampler_execute(device->decimator,
+						(const int8_t*)usb_transfer->buffer, usb_transfer->actual_length);
+			}
+		}
+
+		transfer.device = device;
+		transfer.buffer = usb_transfer->buffer;
+		transfer.buffer_length = usb_transfer->length;
+		transfer.valid_length = usb_transfer->actual_length;
+		if( (!transmit) && (device->decimator != NULL) )
+		{
+			transfer.valid_length = 2 * device->decimator_count;
+		}
+		transfer.rx_ctx = device->rx_ctx;
+		transfer.tx_ctx = device->tx_ctx;
+
+		TRACE(device, TRACE_CALLBACK_BEGIN, usb_transfer, 0, (uint32_t)transfer.valid_length);
+		callback_start_us = stats_time_us();
+		callback_result = device->callback(&transfer);
+		callback_us = stats_time_us() - callback_start_us;
+		TRACE(device, TRACE_CALLBACK_END, usb_transfer, 0, (uint32_t)transfer.valid_length);
+		if( callback_result == 0 )
+		{
+			if( transmit )
+			{
+				fine_tune_buffer(device, usb_transfer->buffer, usb_transfer->length, true);
+			}
 			if( libusb_submit_transfer(usb_transfer) < 0)
 			{
+				resubmit = -1;
+				TRACE(device, TRACE_RESUBMIT_FAILED, usb_transfer, 0, 0);
 				request_exit();
 			}else {
-				return;
+				resubmit = 1;
+				TRACE(device, TRACE_SUBMIT, usb_transfer, 0, (uint32_t)usb_transfer->length);
 			}
 		}else {
 			request_exit();
@@ -1109,6 +2018,8 @@ static void hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer
 		*/
 		request_exit(); /* Fatal error stop transfer */
 	}
+
+	stats_completion(device, usb_transfer, completed_us, callback_us, resubmit);
 }
 
 static int kill_transfer_thread(hackrf_device* device)
@@ -1130,6 +2041,14 @@ static int kill_transfer_thread(hackrf_device* device)
 
 		/* Cancel all transfers */
 		cancel_transfers(device);
+		stats_begin(device);
+		device->stats.in_flight = 0;
+		stats_end(device);
+
+		if( device->thread_stats.memory_locked )
+		{
+			lock_transfer_buffers(device, false);
+		}
 	}
 
 	return HACKRF_SUCCESS;
@@ -1144,6 +2063,9 @@ static int create_transfer_thread(hackrf_device* device,
 	if( device->transfer_thread_started == false )
 	{
 		device->streaming = false;
+		/* Left set by the previous stop; clear it so streaming can restart
+		   on an open device. */
+		do_exit = false;
 
 		result = prepare_transfers(
 			device, endpoint_address,
@@ -1155,6 +2077,13 @@ static int create_transfer_thread(hackrf_device* device,
 			return result;
 		}
 
+		memset(&device->thread_stats, 0, sizeof(device->thread_stats));
+		device->last_completion_us = 0;
+		if( device->thread_config.lock_memory )
+		{
+			lock_transfer_buffers(device, true);
+		}
+
 		device->streaming = true;
 		device->callback = callback;
 		result = pthread_create(&device->transfer_thread, 0, transfer_threadproc, device);
@@ -1196,6 +2125,238 @@ int ADDCALL hackrf_is_streaming(hackrf_device* device)
 	}
 }
 
+int ADDCALL hackrf_set_transfer_thread_config(hackrf_device* device,
+		const hackrf_thread_config* config)
+{
+	if( (config == NULL) || (config->policy > HACKRF_SCHED_RR)
+			|| ((config->policy != HACKRF_SCHED_DEFAULT)
+				&& ((config->priority < 1) || (config->priority > 99))) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if( device->transfer_thread_started )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+	device->thread_config = *config;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_get_stats(hackrf_device* device, hackrf_stats* stats)
+{
+	uint32_t seq;
+
+	if( stats == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	do
+	{
+		seq = device->stats_seq;
+		stats_barrier();
+		*stats = device->stats;
+		stats->thread = device->thread_stats;
+		stats_barrier();
+	} while( ((seq & 1) != 0) || (seq != device->stats_seq) );
+	return HACKRF_SUCCESS;
+}
+
+#ifdef HACKRF_TRACE
+
+int ADDCALL hackrf_trace_start(hackrf_device* device, const uint32_t capacity)
+{
+	struct trace_ring* ring = device->trace;
+	uint32_t size = 1;
+
+	if( capacity > (1u << 28) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	while( size < ((capacity != 0) ? capacity : TRACE_DEFAULT_CAPACITY) )
+	{
+		size <<= 1;
+	}
+
+	device->trace_enabled = false;
+	stats_barrier();
+	if( (ring != NULL) && (ring->capacity != size) )
+	{
+		/* Resizing under a running transfer thread would race it. */
+		if( device->transfer_thread_started )
+		{
+			return HACKRF_ERROR_BUSY;
+		}
+		free(ring->events);
+		free(ring);
+		device->trace = ring = NULL;
+	}
+	if( ring == NULL )
+	{
+		ring = (struct trace_ring*)calloc(1, sizeof(*ring));
+		if( ring == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		ring->events = (trace_event_t*)malloc(size * sizeof(trace_event_t));
+		if( ring->events == NULL )
+		{
+			free(ring);
+			return HACKRF_ERROR_NO_MEM;
+		}
+		ring->capacity = size;
+	}
+	ring->start_us = stats_time_us();
+	stats_barrier();
+	ring->start = ring->head;
+	device->trace = ring;
+	stats_barrier();
+	device->trace_enabled = true;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_trace_stop(hackrf_device* device)
+{
+	device->trace_enabled = false;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_trace_write(hackrf_device* device, const char* path)
+{
+	struct trace_ring* const ring = device->trace;
+	trace_event_t* events;
+	uint64_t head, first, index;
+	FILE* file;
+	int written = 0;
+
+	if( (ring == NULL) || (path == NULL) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* Copy without stopping the producer, then drop whatever it may have
+	   overwritten while we were copying. */
+	events = (trace_event_t*)malloc(ring->capacity * sizeof(trace_event_t));
+	if( events == NULL )
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	head = ring->head;
+	stats_barrier();
+	first = (head > ring->capacity) ? (head - ring->capacity) : 0;
+	if( first < ring->start )
+	{
+		first = ring->start;
+	}
+	for( index = first; index < head; index++ )
+	{
+		events[index & (ring->capacity - 1)] = ring->events[index & (ring->capacity - 1)];
+	}
+	stats_barrier();
+	if( (ring->head - first) > ring->capacity )
+	{
+		first = ring->head - ring->capacity;
+	}
+
+	file = fopen(path, "w");
+	if( file == NULL )
+	{
+		free(events);
+		return HACKRF_ERROR_OTHER;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+			"\"args\":{\"name\":\"libhackrf transfer thread\"}}");
+	for( index = first; index < head; index++ )
+	{
+		const trace_event_t* const e = &events[index & (ring->capacity - 1)];
+		const double ts = (double)(int64_t)(e->time_us - ring->start_us);
+
+		/* Recorded by a producer that was already past its trace_enabled
+		   check when the trace restarted. */
+		if( e->time_us < ring->start_us )
+		{
+			continue;
+		}
+		switch( e->type )
+		{
+		/* Each transfer is an async span from submit to completion. */
+		case TRACE_SUBMIT:
+			fprintf(file, ",\n{\"name\":\"transfer %u\",\"cat\":\"usb\",\"ph\":\"b\","
+					"\"id\":%u,\"ts\":%.0f,\"pid\":1,\"tid\":1,\"args\":{\"length\":%u}}",
+					e->transfer, e->transfer, ts, e->length);
+			break;
+		case TRACE_COMPLETE:
+			fprintf(file, ",\n{\"name\":\"transfer %u\",\"cat\":\"usb\",\"ph\":\"e\","
+					"\"id\":%u,\"ts\":%.0f,\"pid\":1,\"tid\":1,"
+					"\"args\":{\"status\":%u,\"actual_length\":%u}}",
+					e->transfer, e->transfer, ts, e->status, e->length);
+			break;
+		case TRACE_CALLBACK_BEGIN:
+		case TRACE_CALLBACK_END:
+			fprintf(file, ",\n{\"name\":\"callback\",\"cat\":\"callback\",\"ph\":\"%s\","
+					"\"ts\":%.0f,\"pid\":1,\"tid\":1,\"args\":{\"transfer\":%u,\"length\":%u}}",
+					(e->type == TRACE_CALLBACK_BEGIN) ? "B" : "E", ts, e->transfer, e->length);
+			break;
+		case TRACE_RESUBMIT_FAILED:
+		case TRACE_CANCEL:
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"usb\",\"ph\":\"i\",\"s\":\"t\","
+					"\"ts\":%.0f,\"pid\":1,\"tid\":1,\"args\":{\"transfer\":%u}}",
+					(e->type == TRACE_CANCEL) ? "cancel" : "resubmit failed", ts, e->transfer);
+			break;
+		default:
+			break;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	written = (ferror(file) == 0);
+	if( fclose(file) != 0 )
+	{
+		written = 0;
+	}
+	free(events);
+
+	return written ? HACKRF_SUCCESS : HACKRF_ERROR_OTHER;
+}
+
+#else
+
+int ADDCALL hackrf_trace_start(hackrf_device* device, const uint32_t capacity)
+{
+	(void)device;
+	(void)capacity;
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_trace_stop(hackrf_device* device)
+{
+	(void)device;
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_trace_write(hackrf_device* device, const char* path)
+{
+	(void)device;
+	(void)path;
+	return HACKRF_ERROR_OTHER;
+}
+
+#endif /* HACKRF_TRACE */
+
+int ADDCALL hackrf_get_transfer_thread_stats(hackrf_device* device,
+		hackrf_thread_stats* stats)
+{
+	hackrf_stats all;
+
+	if( stats == NULL )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	hackrf_get_stats(device, &all);
+	*stats = all.thread;
+	return HACKRF_SUCCESS;
+}
+
 int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx)
 {
 	int result;
@@ -1265,6 +2426,18 @@ int ADDCALL hackrf_close(hackrf_device* device)
 
 		free_transfers(device);
 
+		if( device->decimator != NULL )
+		{
+			hackrf_resampler_destroy(device->decimator);
+		}
+		pthread_mutex_destroy(&device->tune_lock);
+#ifdef HACKRF_TRACE
+		if( device->trace != NULL )
+		{
+			free(device->trace->events);
+			free(device->trace);
+		}
+#endif
 		free(device);
 	}
 
@@ -1355,6 +2528,42 @@ const char* ADDCALL hackrf_filter_path_name(const enum rf_path_filter path)
 	}
 }
 
+const char* ADDCALL hackrf_event_log_name(const enum hackrf_event event)
+{
+	switch(event) {
+	case HACKRF_EVENT_BOOT:
+		return "boot";
+	case HACKRF_EVENT_FAULT:
+		return "fault";
+	case HACKRF_EVENT_USB_BUS_RESET:
+		return "usb bus reset";
+	case HACKRF_EVENT_USB_CONFIGURATION:
+		return "usb configuration";
+	case HACKRF_EVENT_USB_TRANSFER_ERROR:
+		return "usb transfer error";
+	case HACKRF_EVENT_USB_QUEUE_EXHAUSTED:
+		return "usb queue exhausted";
+	case HACKRF_EVENT_USB_QUEUE_MISSING:
+		return "usb queue missing";
+	case HACKRF_EVENT_TRANSCEIVER_MODE:
+		return "transceiver mode";
+	case HACKRF_EVENT_SET_FREQ:
+		return "set freq";
+	case HACKRF_EVENT_SET_FREQ_EXPLICIT:
+		return "set freq explicit";
+	case HACKRF_EVENT_SAMPLE_RATE:
+		return "sample rate";
+	case HACKRF_EVENT_BASEBAND_FILTER:
+		return "baseband filter";
+	case HACKRF_EVENT_GAIN:
+		return "gain";
+	case HACKRF_EVENT_SGPIO_OVERRUN:
+		return "sgpio overrun";
+	default:
+		return "unknown event";
+	}
+}
+
 /* Return final bw round down and less than expected bw. */
 uint32_t ADDCALL hackrf_compute_baseband_filter_bw_round_down_lt(const uint32_t bandwidth_hz)
 {
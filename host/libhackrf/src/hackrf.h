@@ -91,8 +91,163 @@ typedef struct {
 	uint32_t serial_no[4];
 } read_partid_serialno_t;
 
+/* Firmware cycle counter statistics, in M4 CPU cycles unless noted. The
+   cycle counter stops while the M4 sleeps, so cycles is the time it spent
+   awake during the interval. */
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t total;
+} hackrf_perf_counter;
+
+/* Firmware USB queue statistics for one bulk endpoint. */
+typedef struct {
+	uint32_t depth;                  /* dTDs queued at the time of the read */
+	uint32_t high_water;             /* deepest the queue got */
+	uint32_t alloc_failures;         /* schedules that found the pool full */
+	uint32_t spin_cycles;            /* cycles spent waiting for a free transfer */
+} hackrf_usb_queue_stats;
+
+typedef struct {
+	uint32_t cycles;                 /* length of the measured interval */
+	hackrf_perf_counter sgpio_isr;   /* SGPIO sample ISR */
+	hackrf_perf_counter usb_isr;     /* USB0 ISR */
+	hackrf_perf_counter main_loop;   /* main loop passes that queue a bulk transfer */
+	hackrf_perf_counter slack;       /* bytes the SGPIO ISR was behind USB at each bulk completion interrupt */
+	uint32_t overruns;               /* bulk transfers that SGPIO had already caught up with */
+	uint32_t sleeps;                 /* times the main loop went to sleep */
+	hackrf_perf_counter latency;     /* half buffer filled by SGPIO to bulk transfer queued */
+	hackrf_usb_queue_stats bulk_in;
+	hackrf_usb_queue_stats bulk_out;
+} hackrf_perf;
+
+#define HACKRF_EVENT_LOG_LENGTH (256)
+
+/* Firmware event IDs, see hackrf_event_log_name(). */
+enum hackrf_event {
+	HACKRF_EVENT_BOOT = 1,
+	HACKRF_EVENT_FAULT = 2,
+	HACKRF_EVENT_USB_BUS_RESET = 3,
+	HACKRF_EVENT_USB_CONFIGURATION = 4,
+	HACKRF_EVENT_USB_TRANSFER_ERROR = 5,
+	HACKRF_EVENT_USB_QUEUE_EXHAUSTED = 6,
+	HACKRF_EVENT_USB_QUEUE_MISSING = 7,
+	HACKRF_EVENT_TRANSCEIVER_MODE = 8,
+	HACKRF_EVENT_SET_FREQ = 9,
+	HACKRF_EVENT_SET_FREQ_EXPLICIT = 10,
+	HACKRF_EVENT_SAMPLE_RATE = 11,
+	HACKRF_EVENT_BASEBAND_FILTER = 12,
+	HACKRF_EVENT_GAIN = 13,
+	HACKRF_EVENT_SGPIO_OVERRUN = 14,
+};
+
+typedef struct {
+	uint32_t timestamp; /* M4 cycle counter, wraps every 2^32 cycles */
+	uint32_t id;        /* enum hackrf_event */
+	uint32_t arg[2];
+} hackrf_event_log_entry;
+
+/* The firmware event ring as stored on the device. The newest event is at
+   entries[(index - 1) % HACKRF_EVENT_LOG_LENGTH]; only the last
+   min(index, HACKRF_EVENT_LOG_LENGTH) entries are valid. */
+typedef struct {
+	uint32_t magic;
+	uint32_t index;   /* events written since the log was last cleared */
+	uint32_t dropped; /* events lost while the log was being read */
+	uint32_t boots;   /* warm resets the log has survived */
+	hackrf_event_log_entry entries[HACKRF_EVENT_LOG_LENGTH];
+} hackrf_event_log;
+
+enum hackrf_spiflash_state {
+	HACKRF_SPIFLASH_IDLE = 0,
+	HACKRF_SPIFLASH_BUSY = 1,
+	HACKRF_SPIFLASH_DONE = 2,
+	HACKRF_SPIFLASH_ERROR = 3,
+};
+
+/* Progress of a bulk SPI flash write. Both CRCs are CRC-32 (as zlib) over
+   the range written: one of the data the firmware received and one of the
+   flash read back afterwards. */
+typedef struct {
+	uint32_t state;             /* enum hackrf_spiflash_state */
+	uint32_t address;
+	uint32_t length;
+	uint32_t received;          /* bytes received so far */
+	uint32_t sectors_erased;
+	uint32_t sectors_unchanged; /* sectors that already held the data */
+	uint32_t pages_programmed;
+	uint32_t crc_received;
+	uint32_t crc_flash;
+} hackrf_spiflash_status;
+
+enum hackrf_cpld_state {
+	HACKRF_CPLD_IDLE = 0,
+	HACKRF_CPLD_BUSY = 1,
+	HACKRF_CPLD_DONE = 2,
+	HACKRF_CPLD_ERROR = 3,
+};
+
+/* Progress of a CPLD update. The cycle counts (204 MHz, wrapping after about
+   21 seconds) are 0 unless the firmware was built with PERF_COUNTERS. */
+typedef struct {
+	uint32_t state;       /* enum hackrf_cpld_state */
+	uint32_t error;       /* XSVF player result, 0 on success */
+	uint32_t received;    /* XSVF bytes received so far */
+	uint32_t cycles;      /* since the update started */
+	uint32_t wait_cycles; /* the XSVF player spent waiting for USB */
+} hackrf_cpld_status;
+
+/* Called after each chunk of a CPLD update has been sent */
+typedef void (*hackrf_cpld_progress_cb_fn)(void* ctx, uint32_t written, uint32_t total);
+
 typedef int (*hackrf_sample_block_cb_fn)(hackrf_transfer* transfer);
 
+enum hackrf_sched_policy {
+	HACKRF_SCHED_DEFAULT = 0,
+	HACKRF_SCHED_FIFO = 1,
+	HACKRF_SCHED_RR = 2,
+};
+
+/* Scheduling of the thread that services USB completions and runs the
+   sample callbacks. */
+typedef struct {
+	enum hackrf_sched_policy policy;
+	uint32_t priority;   /* 1-99 with HACKRF_SCHED_FIFO or HACKRF_SCHED_RR */
+	uint64_t cpu_mask;   /* bit n allows CPU n, 0 leaves affinity alone */
+	uint8_t lock_memory; /* mlock() the USB transfer buffers */
+} hackrf_thread_config;
+
+/* What the transfer thread actually got. Realtime scheduling and memory
+   locking usually need privileges (CAP_SYS_NICE, RLIMIT_MEMLOCK); a setting
+   that fails is skipped, streaming goes ahead and error keeps its errno. */
+typedef struct {
+	uint8_t realtime;
+	uint8_t affinity;
+	uint8_t memory_locked;
+	int32_t error;                 /* errno of the first failure, 0 if none */
+	uint64_t involuntary_switches; /* times the thread was preempted */
+	uint64_t voluntary_switches;
+} hackrf_thread_stats;
+
+#define HACKRF_STATS_HISTOGRAM_BINS (20)
+
+/* Streaming counters, cumulative since hackrf_open(). Histogram bin 0 counts
+   durations under 2 us, bin n those in [2^n, 2^(n+1)) us and the last bin
+   everything longer. */
+typedef struct {
+	uint64_t transfers;          /* USB transfers completed successfully */
+	uint64_t bytes;              /* USB bytes moved by those transfers */
+	uint64_t failed_transfers;   /* completed with an error status */
+	uint64_t resubmit_failures;
+	uint32_t in_flight;          /* transfers currently queued with libusb */
+	uint32_t callback_max_us;
+	uint32_t gap_max_us;
+	uint64_t callback_us[HACKRF_STATS_HISTOGRAM_BINS]; /* sample callback run time */
+	uint64_t gap_us[HACKRF_STATS_HISTOGRAM_BINS];      /* between completions */
+	hackrf_thread_stats thread;
+} hackrf_stats;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -112,6 +267,32 @@ extern ADDAPI int ADDCALL hackrf_stop_tx(hackrf_device* device);
 
 /* return HACKRF_TRUE if success */
 extern ADDAPI int ADDCALL hackrf_is_streaming(hackrf_device* device);
+
+/* Applies from the next hackrf_start_rx() / hackrf_start_tx(); not allowed
+   while streaming. */
+extern ADDAPI int ADDCALL hackrf_set_transfer_thread_config(hackrf_device* device,
+		const hackrf_thread_config* config);
+/* Consistent snapshot of the counters without blocking the transfer thread;
+   safe to call from any thread at any time. */
+extern ADDAPI int ADDCALL hackrf_get_stats(hackrf_device* device, hackrf_stats* stats);
+
+/* USB pipeline event trace: a per-device flight recorder of transfer
+   submit, completion, callback begin/end, resubmit failure and cancel
+   events, exported as Chrome trace JSON (chrome://tracing, Perfetto).
+   Only present when libhackrf is built with ENABLE_TRACE; otherwise these
+   return HACKRF_ERROR_OTHER and the pipeline carries no trace code at all.
+   capacity: events kept, oldest overwritten first; 0 selects 65536.
+   hackrf_trace_start() discards earlier events, also while streaming (the
+   capacity can only change while stopped). hackrf_trace_write() may be
+   called at any time, including while streaming. */
+extern ADDAPI int ADDCALL hackrf_trace_start(hackrf_device* device, const uint32_t capacity);
+extern ADDAPI int ADDCALL hackrf_trace_stop(hackrf_device* device);
+extern ADDAPI int ADDCALL hackrf_trace_write(hackrf_device* device, const char* path);
+
+/* Context switch counts cover the current or last streaming session and are
+   only available on Linux. */
+extern ADDAPI int ADDCALL hackrf_get_transfer_thread_stats(hackrf_device* device,
+		hackrf_thread_stats* stats);
  
 extern ADDAPI int ADDCALL hackrf_max2837_read(hackrf_device* device, uint8_t register_number, uint16_t* value);
 extern ADDAPI int ADDCALL hackrf_max2837_write(hackrf_device* device, uint8_t register_number, uint16_t value);
@@ -128,14 +309,63 @@ extern ADDAPI int ADDCALL hackrf_spiflash_erase(hackrf_device* device);
 extern ADDAPI int ADDCALL hackrf_spiflash_write(hackrf_device* device, const uint32_t address, const uint16_t length, unsigned char* const data);
 extern ADDAPI int ADDCALL hackrf_spiflash_read(hackrf_device* device, const uint32_t address, const uint16_t length, unsigned char* data);
 
+/* Writes length bytes at a 4 KiB aligned address over the bulk endpoint.
+   The firmware erases only sectors whose content changes (clearing any part
+   of them beyond length) and skips the rest. Returns once the data has been
+   programmed and the CRC of the flash read back matches data. status may be
+   NULL. Firmware without bulk support stalls the request: HACKRF_ERROR_LIBUSB.
+   The firmware abandons a write that gets no data for 5 seconds; this gives
+   up with HACKRF_ERROR_OTHER if the write has not finished 30 seconds after
+   the data was sent. */
+extern ADDAPI int ADDCALL hackrf_spiflash_write_bulk(hackrf_device* device, const uint32_t address, const uint32_t length, unsigned char* const data, hackrf_spiflash_status* status);
+extern ADDAPI int ADDCALL hackrf_spiflash_status_read(hackrf_device* device, hackrf_spiflash_status* status);
+/* Reads length bytes from any address over the bulk endpoint, at SPIFI
+   quad read speed unless the flash has been written or (on parts without
+   IAP, such as HackRF One) the serial number read since reset; over SSP0
+   after that. */
+extern ADDAPI int ADDCALL hackrf_spiflash_read_bulk(hackrf_device* device, const uint32_t address, const uint32_t length, unsigned char* data);
+/* Fills crcs with the CRC-32 (as zlib) of each 4 KiB sector in length bytes
+   of flash from a sector aligned address, computed on the device. The last
+   CRC covers only the bytes of its sector that fall within length. Not
+   available while streaming: HACKRF_ERROR_LIBUSB. */
+extern ADDAPI int ADDCALL hackrf_spiflash_crc(hackrf_device* device, const uint32_t address, const uint32_t length, uint32_t* crcs);
+
 /* device will need to be reset after hackrf_cpld_write */
 extern ADDAPI int ADDCALL hackrf_cpld_write(hackrf_device* device,
 		unsigned char* const data, const unsigned int total_length);
+/* As hackrf_cpld_write, calling callback (which may be NULL) after each
+   16 KiB chunk. The firmware programs one chunk while receiving the next,
+   so this returns before programming has finished: poll
+   hackrf_cpld_status_read until the state leaves HACKRF_CPLD_BUSY. Firmware
+   without the status request stalls it: HACKRF_ERROR_LIBUSB. */
+extern ADDAPI int ADDCALL hackrf_cpld_write_with_progress(hackrf_device* device,
+		unsigned char* const data, const unsigned int total_length,
+		hackrf_cpld_progress_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_cpld_status_read(hackrf_device* device, hackrf_cpld_status* status);
 		
 extern ADDAPI int ADDCALL hackrf_board_id_read(hackrf_device* device, uint8_t* value);
 extern ADDAPI int ADDCALL hackrf_version_string_read(hackrf_device* device, char* version, uint8_t length);
 
 extern ADDAPI int ADDCALL hackrf_set_freq(hackrf_device* device, const uint64_t freq_hz);
+/* Retune without touching the hardware when freq_hz stays within the usable
+   passband around the last hackrf_set_freq(): RX and TX buffers are frequency
+   shifted on the host instead. Falls back to hackrf_set_freq() otherwise.
+   Requires the sample rate to have been set through this library. */
+extern ADDAPI int ADDCALL hackrf_set_freq_fine(hackrf_device* device, const uint64_t freq_hz);
+
+#define HACKRF_OFFSET_TUNING_MAX_DECIMATION (64)
+
+/* Keep the signal off the DC / LO leakage spike: the hardware LO is tuned
+   offset_hz away from every frequency requested with hackrf_set_freq() and
+   samples are shifted back on the host, so callbacks still see the requested
+   frequency at the center. With decimation > 1, RX buffers are also low pass
+   filtered and decimated in place (valid_length shrinks accordingly), which
+   removes the spike when |offset_hz| > sample rate / (2 * decimation).
+   offset_hz 0 and decimation 1 turn this off. Not allowed while streaming.
+   Like hackrf_set_freq_fine() this needs the sample rate set through this
+   library. */
+extern ADDAPI int ADDCALL hackrf_set_offset_tuning(hackrf_device* device,
+		const int32_t offset_hz, const uint32_t decimation);
 extern ADDAPI int ADDCALL hackrf_set_freq_explicit(hackrf_device* device,
 		const uint64_t if_freq_hz, const uint64_t lo_freq_hz,
 		const enum rf_path_filter path);
@@ -150,6 +380,14 @@ extern ADDAPI int ADDCALL hackrf_set_amp_enable(hackrf_device* device, const uin
 
 extern ADDAPI int ADDCALL hackrf_board_partid_serialno_read(hackrf_device* device, read_partid_serialno_t* read_partid_serialno);
 
+/* Reads the firmware performance counters. With clear set they restart
+   after the read, so polling periodically gives per-interval figures; the
+   firmware counts cycles in 32 bits, so keep intervals under ~20 s. */
+extern ADDAPI int ADDCALL hackrf_perf_read(hackrf_device* device, hackrf_perf* perf, const uint8_t clear);
+
+/* Reads the firmware event ring; with clear set it is emptied afterwards. */
+extern ADDAPI int ADDCALL hackrf_event_log_read(hackrf_device* device, hackrf_event_log* log, const uint8_t clear);
+
 /* range 0-40 step 8db */
 extern ADDAPI int ADDCALL hackrf_set_lna_gain(hackrf_device* device, uint32_t value);
 
@@ -165,6 +403,7 @@ extern ADDAPI int ADDCALL hackrf_set_antenna_enable(hackrf_device* device, const
 extern ADDAPI const char* ADDCALL hackrf_error_name(enum hackrf_error errcode);
 extern ADDAPI const char* ADDCALL hackrf_board_id_name(enum hackrf_board_id board_id);
 extern ADDAPI const char* ADDCALL hackrf_filter_path_name(const enum rf_path_filter path);
+extern ADDAPI const char* ADDCALL hackrf_event_log_name(const enum hackrf_event event);
 
 /* Compute nearest freq for bw filter (manual filter) */
 extern ADDAPI uint32_t ADDCALL hackrf_compute_baseband_filter_bw_round_down_lt(const uint32_t bandwidth_hz);
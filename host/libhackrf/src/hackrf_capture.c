@@ -0,0 +1,530 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "hackrf_capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _MSC_VER
+#define capture_fseek _fseeki64
+#define capture_ftell _ftelli64
+#else
+#define capture_fseek fseeko
+#define capture_ftell ftello
+#endif
+
+#define CAPTURE_VERSION (1)
+#define CAPTURE_FILE_MAGIC "HRFC"
+#define CAPTURE_BLOCK_MAGIC "HRFB"
+
+/* Written in host byte order, which is little endian on every supported host. */
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t block_header_size;
+	uint32_t block_size;
+	uint32_t reserved[11];
+} capture_file_header_t;
+
+typedef struct {
+	char magic[4];
+	uint32_t length;
+	uint64_t block;
+	uint64_t sample_offset;
+	uint64_t timestamp_ns;
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+	uint8_t lna_gain;
+	uint8_t vga_gain;
+	uint8_t txvga_gain;
+	uint8_t amp_enable;
+	uint32_t reserved[4];
+} capture_block_header_t;
+
+static uint64_t capture_time_ns(void)
+{
+#ifdef _WIN32
+	FILETIME ft;
+	uint64_t t;
+	GetSystemTimeAsFileTime(&ft);
+	t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+	/* 100 ns ticks since 1601 */
+	return (t - 116444736000000000ULL) * 100;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000;
+#endif
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Writer. */
+
+struct hackrf_capture_writer {
+	FILE* file;
+	uint32_t block_size;
+	hackrf_capture_metadata metadata;
+	uint64_t block;
+	uint64_t sample_offset;
+	/* Block header immediately followed by block_size bytes of samples, so
+	   each block goes out in one fwrite(). */
+	uint8_t* buffer;
+	uint32_t fill;
+	uint64_t timestamp_ns;
+};
+
+static int capture_writer_flush(hackrf_capture_writer* w)
+{
+	capture_block_header_t* const header = (capture_block_header_t*)w->buffer;
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, CAPTURE_BLOCK_MAGIC, 4);
+	header->length = w->fill;
+	header->block = w->block;
+	header->sample_offset = w->sample_offset;
+	header->timestamp_ns = w->timestamp_ns;
+	header->freq_hz = w->metadata.freq_hz;
+	header->sample_rate_hz = w->metadata.sample_rate_hz;
+	header->lna_gain = w->metadata.lna_gain;
+	header->vga_gain = w->metadata.vga_gain;
+	header->txvga_gain = w->metadata.txvga_gain;
+	header->amp_enable = w->metadata.amp_enable;
+
+	if (fwrite(w->buffer, sizeof(*header) + w->fill, 1, w->file) != 1)
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	w->block++;
+	w->sample_offset += w->fill / 2;
+	w->fill = 0;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_writer_create(hackrf_capture_writer** writer,
+		FILE* file, const uint32_t block_size)
+{
+	hackrf_capture_writer* w;
+	capture_file_header_t header;
+
+	if ((writer == NULL) || (file == NULL) || ((block_size & 1) != 0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	w = (hackrf_capture_writer*)calloc(1, sizeof(*w));
+	if (w == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	w->file = file;
+	w->block_size = (block_size == 0) ? HACKRF_CAPTURE_DEFAULT_BLOCK_SIZE : block_size;
+	w->buffer = (uint8_t*)malloc(sizeof(capture_block_header_t) + w->block_size);
+	if (w->buffer == NULL)
+	{
+		free(w);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CAPTURE_FILE_MAGIC, 4);
+	header.version = CAPTURE_VERSION;
+	header.header_size = sizeof(capture_file_header_t);
+	header.block_header_size = sizeof(capture_block_header_t);
+	header.block_size = w->block_size;
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		free(w->buffer);
+		free(w);
+		return HACKRF_ERROR_OTHER;
+	}
+
+	*writer = w;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_writer_set_metadata(hackrf_capture_writer* writer,
+		const hackrf_capture_metadata* metadata)
+{
+	if ((writer == NULL) || (metadata == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	writer->metadata = *metadata;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_writer_write(hackrf_capture_writer* writer,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_capture_writer* const w = writer;
+	uint8_t* payload;
+	uint32_t done = 0;
+	uint32_t n;
+	int result;
+
+	if ((w == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	payload = w->buffer + sizeof(capture_block_header_t);
+
+	while (done < length)
+	{
+		if (w->fill == 0)
+		{
+			w->timestamp_ns = capture_time_ns();
+		}
+		n = w->block_size - w->fill;
+		if (n > (length - done))
+		{
+			n = length - done;
+		}
+		memcpy(&payload[w->fill], &samples[done], n);
+		w->fill += n;
+		done += n;
+
+		if (w->fill == w->block_size)
+		{
+			result = capture_writer_flush(w);
+			if (result != HACKRF_SUCCESS)
+			{
+				return result;
+			}
+		}
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_writer_close(hackrf_capture_writer* writer)
+{
+	int result = HACKRF_SUCCESS;
+
+	if (writer == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	/* An odd trailing byte would split an I/Q pair; drop it. */
+	writer->fill &= ~1U;
+	if (writer->fill > 0)
+	{
+		result = capture_writer_flush(writer);
+	}
+	if ((result == HACKRF_SUCCESS) && (fflush(writer->file) != 0))
+	{
+		result = HACKRF_ERROR_OTHER;
+	}
+	free(writer->buffer);
+	free(writer);
+	return result;
+}
+
+/* Reader. */
+
+struct hackrf_capture_reader {
+	FILE* file;
+	uint32_t block_size;
+	uint64_t stride;
+	uint64_t block_count;
+};
+
+static uint64_t capture_block_offset(const hackrf_capture_reader* r, const uint64_t block)
+{
+	return sizeof(capture_file_header_t) + block * r->stride;
+}
+
+static bool capture_read_header(hackrf_capture_reader* r, const uint64_t block,
+		capture_block_header_t* header)
+{
+	return (capture_fseek(r->file, (int64_t)capture_block_offset(r, block), SEEK_SET) == 0)
+			&& (fread(header, sizeof(*header), 1, r->file) == 1)
+			&& (memcmp(header->magic, CAPTURE_BLOCK_MAGIC, 4) == 0)
+			&& (header->block == block)
+			&& (header->length <= r->block_size);
+}
+
+/* Blocks are written in order, so the valid ones form a prefix of the file.
+   Anything past it (a block cut short by a kill, or space preallocated for
+   blocks never written) fails the header check. */
+static int capture_reader_count_blocks(hackrf_capture_reader* r)
+{
+	capture_block_header_t header;
+	uint64_t lo = 0;
+	uint64_t hi;
+	uint64_t mid;
+	int64_t end;
+
+	if (capture_fseek(r->file, 0, SEEK_END) != 0)
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	end = capture_ftell(r->file);
+	if (end < (int64_t)sizeof(capture_file_header_t))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/* Upper bound on blocks whose header is on disk. */
+	hi = ((uint64_t)end - sizeof(capture_file_header_t) + r->stride - 1) / r->stride;
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo + 1) / 2;
+		if (capture_read_header(r, mid - 1, &header))
+		{
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	/* The last block needs its samples too. Only it may be short. */
+	if ((lo > 0) && capture_read_header(r, lo - 1, &header)
+			&& ((capture_block_offset(r, lo - 1) + sizeof(header) + header.length) > (uint64_t)end))
+	{
+		lo--;
+	}
+	r->block_count = lo;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_reader_open(hackrf_capture_reader** reader, FILE* file)
+{
+	hackrf_capture_reader* r;
+	capture_file_header_t header;
+	int result;
+
+	if ((reader == NULL) || (file == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if ((capture_fseek(file, 0, SEEK_SET) != 0)
+			|| (fread(&header, sizeof(header), 1, file) != 1)
+			|| (memcmp(header.magic, CAPTURE_FILE_MAGIC, 4) != 0)
+			|| (header.version != CAPTURE_VERSION)
+			|| (header.header_size != sizeof(capture_file_header_t))
+			|| (header.block_header_size != sizeof(capture_block_header_t))
+			|| (header.block_size == 0) || ((header.block_size & 1) != 0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	r = (hackrf_capture_reader*)calloc(1, sizeof(*r));
+	if (r == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	r->file = file;
+	r->block_size = header.block_size;
+	r->stride = sizeof(capture_block_header_t) + (uint64_t)header.block_size;
+
+	result = capture_reader_count_blocks(r);
+	if (result != HACKRF_SUCCESS)
+	{
+		free(r);
+		return result;
+	}
+
+	*reader = r;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_reader_close(hackrf_capture_reader* reader)
+{
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	free(reader);
+	return HACKRF_SUCCESS;
+}
+
+uint32_t ADDCALL hackrf_capture_reader_block_size(hackrf_capture_reader* reader)
+{
+	return reader->block_size;
+}
+
+uint64_t ADDCALL hackrf_capture_reader_block_count(hackrf_capture_reader* reader)
+{
+	return reader->block_count;
+}
+
+int ADDCALL hackrf_capture_reader_find_sample(hackrf_capture_reader* reader,
+		const uint64_t sample_offset, uint64_t* block)
+{
+	uint64_t b;
+
+	if ((reader == NULL) || (block == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	b = sample_offset / (reader->block_size / 2);
+	if (b >= reader->block_count)
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	*block = b;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_reader_find_time(hackrf_capture_reader* reader,
+		const uint64_t timestamp_ns, uint64_t* block)
+{
+	hackrf_capture_reader* const r = reader;
+	capture_block_header_t lo_header, hi_header, header;
+	uint64_t lo, hi, mid;
+	bool interpolate = true;
+
+	if ((r == NULL) || (block == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (r->block_count == 0)
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+
+	lo = 0;
+	hi = r->block_count - 1;
+	if (!capture_read_header(r, lo, &lo_header) || !capture_read_header(r, hi, &hi_header))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	if (timestamp_ns < lo_header.timestamp_ns)
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	if (timestamp_ns >= hi_header.timestamp_ns)
+	{
+		*block = hi;
+		return HACKRF_SUCCESS;
+	}
+
+	/* Invariant: block lo starts at or before the target, block hi after it.
+	   With a steady sample rate the block times are evenly spaced and the
+	   first interpolated guess lands on (or next to) the answer; steps
+	   alternate with bisection so gaps or rate changes cost at most
+	   O(log n) header reads. */
+	while ((hi - lo) > 1)
+	{
+		if (interpolate && (hi_header.timestamp_ns > lo_header.timestamp_ns))
+		{
+			const double f = (double)(timestamp_ns - lo_header.timestamp_ns)
+					/ (double)(hi_header.timestamp_ns - lo_header.timestamp_ns);
+			mid = lo + (uint64_t)(f * (double)(hi - lo));
+		} else {
+			mid = lo + (hi - lo) / 2;
+		}
+		if (mid <= lo)
+		{
+			mid = lo + 1;
+		} else if (mid >= hi) {
+			mid = hi - 1;
+		}
+		interpolate = !interpolate;
+
+		if (!capture_read_header(r, mid, &header))
+		{
+			return HACKRF_ERROR_OTHER;
+		}
+		if (header.timestamp_ns <= timestamp_ns)
+		{
+			lo = mid;
+			lo_header = header;
+			/* Usually the guess is just short of the target: check its
+			   neighbour before widening the search again. */
+			if (((mid + 1) < hi) && capture_read_header(r, mid + 1, &header))
+			{
+				if (header.timestamp_ns > timestamp_ns)
+				{
+					break;
+				}
+				lo = mid + 1;
+				lo_header = header;
+			}
+		} else {
+			hi = mid;
+			hi_header = header;
+		}
+	}
+
+	*block = lo;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_capture_reader_read_block(hackrf_capture_reader* reader,
+		const uint64_t block, hackrf_capture_metadata* metadata, int8_t* samples)
+{
+	hackrf_capture_reader* const r = reader;
+	capture_block_header_t header;
+
+	if ((r == NULL) || (block >= r->block_count))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (!capture_read_header(r, block, &header))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	if ((samples != NULL) && (header.length > 0)
+			&& (fread(samples, 1, header.length, r->file) != header.length))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+
+	if (metadata != NULL)
+	{
+		metadata->sample_offset = header.sample_offset;
+		metadata->timestamp_ns = header.timestamp_ns;
+		metadata->freq_hz = header.freq_hz;
+		metadata->sample_rate_hz = header.sample_rate_hz;
+		metadata->length = header.length;
+		metadata->lna_gain = header.lna_gain;
+		metadata->vga_gain = header.vga_gain;
+		metadata->txvga_gain = header.txvga_gain;
+		metadata->amp_enable = header.amp_enable;
+	}
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
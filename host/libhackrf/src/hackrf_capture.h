@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_CAPTURE_H__
+#define __HACKRF_CAPTURE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hackrf.h"
+
+/*
+ * Indexed capture container (.hrfc) for raw HackRF signed 8 bit I/Q.
+ *
+ * A 64 byte file header is followed by fixed stride blocks, each a 64 byte
+ * block header (sample offset, host timestamp, frequency, sample rate,
+ * gains) and block_size bytes of samples. Only the final block may be
+ * shorter. Block n therefore always starts at
+ *
+ *   HACKRF_CAPTURE_HEADER_SIZE + n * (HACKRF_CAPTURE_BLOCK_HEADER_SIZE + block_size)
+ *
+ * so seeking to a sample is a multiplication, and the block headers form
+ * an index that grows with the data: a recorder killed mid-write leaves at
+ * most one incomplete block at the end, which readers ignore. All offsets
+ * are 64 bit and all fields little endian.
+ */
+
+#define HACKRF_CAPTURE_HEADER_SIZE (64)
+#define HACKRF_CAPTURE_BLOCK_HEADER_SIZE (64)
+#define HACKRF_CAPTURE_DEFAULT_BLOCK_SIZE (262144)
+
+typedef struct {
+	uint64_t sample_offset; /* first sample of the block since capture start */
+	uint64_t timestamp_ns;  /* host time the block started, ns since 1970 */
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+	uint32_t length;        /* bytes of I/Q in the block */
+	uint8_t lna_gain;
+	uint8_t vga_gain;
+	uint8_t txvga_gain;
+	uint8_t amp_enable;
+} hackrf_capture_metadata;
+
+typedef struct hackrf_capture_writer hackrf_capture_writer;
+typedef struct hackrf_capture_reader hackrf_capture_reader;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* file: opened for binary writing, stays owned by the caller.
+   block_size: even, 0 selects the default. */
+extern ADDAPI int ADDCALL hackrf_capture_writer_create(hackrf_capture_writer** writer,
+		FILE* file, const uint32_t block_size);
+
+/* Radio settings recorded from the next block on. sample_offset, timestamp_ns
+   and length are ignored. */
+extern ADDAPI int ADDCALL hackrf_capture_writer_set_metadata(hackrf_capture_writer* writer,
+		const hackrf_capture_metadata* metadata);
+
+extern ADDAPI int ADDCALL hackrf_capture_writer_write(hackrf_capture_writer* writer,
+		const int8_t* samples, const uint32_t length);
+
+/* Write the final partial block and free the writer. */
+extern ADDAPI int ADDCALL hackrf_capture_writer_close(hackrf_capture_writer* writer);
+
+/* file: opened for binary reading, stays owned by the caller. */
+extern ADDAPI int ADDCALL hackrf_capture_reader_open(hackrf_capture_reader** reader, FILE* file);
+extern ADDAPI int ADDCALL hackrf_capture_reader_close(hackrf_capture_reader* reader);
+
+extern ADDAPI uint32_t ADDCALL hackrf_capture_reader_block_size(hackrf_capture_reader* reader);
+extern ADDAPI uint64_t ADDCALL hackrf_capture_reader_block_count(hackrf_capture_reader* reader);
+
+/* Block holding the given sample, O(1). */
+extern ADDAPI int ADDCALL hackrf_capture_reader_find_sample(hackrf_capture_reader* reader,
+		const uint64_t sample_offset, uint64_t* block);
+
+/* Last block starting at or before timestamp_ns. Jumps straight to the
+   block predicted by the sample rate, then corrects for gaps. */
+extern ADDAPI int ADDCALL hackrf_capture_reader_find_time(hackrf_capture_reader* reader,
+		const uint64_t timestamp_ns, uint64_t* block);
+
+/* samples may be NULL to read only the metadata; otherwise it must hold
+   block_size bytes. */
+extern ADDAPI int ADDCALL hackrf_capture_reader_read_block(hackrf_capture_reader* reader,
+		const uint64_t block, hackrf_capture_metadata* metadata, int8_t* samples);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_CAPTURE_H__
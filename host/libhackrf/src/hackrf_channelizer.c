@@ -0,0 +1,520 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "hackrf_channelizer.h"
+#include "hackrf_simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <pthread.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CHANNELIZER_MAX_CHANNELS (1024)
+#define CHANNELIZER_MAX_TAPS_PER_CHANNEL (64)
+
+typedef struct {
+	hackrf_channelizer* channelizer;
+	pthread_t thread;
+	uint32_t index;
+	float* branch; /* 2 * num_channels floats: polyphase branch outputs */
+	float* fft;    /* 2 * num_channels floats: FFT work area */
+} channelizer_worker_t;
+
+struct hackrf_channelizer {
+	uint32_t num_channels;
+	uint32_t window; /* prototype filter length */
+	float* taps;     /* reversed prototype, each tap duplicated for I and Q */
+	float* twiddle;
+	uint32_t* bitrev;
+
+	float* input;    /* interleaved float history followed by new samples */
+	uint32_t input_count;
+	uint32_t input_capacity;
+
+	float** output;  /* per channel interleaved float */
+	uint32_t output_count;
+	uint32_t output_capacity;
+
+	hackrf_channel_cb_fn callback;
+	void* ctx;
+
+	uint32_t num_threads;
+	uint32_t running; /* pool threads started, the caller is worker 0 */
+	uint32_t slices;  /* workers taking part in the current block */
+	channelizer_worker_t* workers;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	uint32_t generation;
+	uint32_t pending;
+	bool shutdown;
+};
+
+/* In-place radix-2 FFT on interleaved complex with a positive exponent, so that
+ * channel k comes out at bin k.
+ */
+static void channelizer_fft(float* x, const uint32_t n, const float* twiddle,
+		const uint32_t* bitrev)
+{
+	uint32_t i, j, k, len, half, step;
+	float tr, ti;
+
+	for (i = 0; i < n; i++)
+	{
+		j = bitrev[i];
+		if (j > i)
+		{
+			tr = x[2*i]; ti = x[2*i+1];
+			x[2*i] = x[2*j]; x[2*i+1] = x[2*j+1];
+			x[2*j] = tr; x[2*j+1] = ti;
+		}
+	}
+
+	for (len = 2; len <= n; len <<= 1)
+	{
+		half = len >> 1;
+		step = n / len;
+		for (i = 0; i < n; i += len)
+		{
+			for (k = 0; k < half; k++)
+			{
+				const float wr = twiddle[2*k*step];
+				const float wi = twiddle[2*k*step+1];
+				float* const a = &x[2*(i+k)];
+				float* const b = &x[2*(i+k+half)];
+				tr = b[0] * wr - b[1] * wi;
+				ti = b[0] * wi + b[1] * wr;
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
+
+static void channelizer_run_slice(channelizer_worker_t* const worker)
+{
+	hackrf_channelizer* const ch = worker->channelizer;
+	const uint32_t m = ch->num_channels;
+	const uint32_t rows = ch->window / m;
+	const uint32_t first = (uint32_t)(((uint64_t)ch->output_count * worker->index) / ch->slices);
+	const uint32_t last = (uint32_t)(((uint64_t)ch->output_count * (worker->index + 1)) / ch->slices);
+	uint32_t n, q, k;
+
+	for (n = first; n < last; n++)
+	{
+		const float* const x = &ch->input[2 * n * m];
+
+		/* Polyphase branches: the reversed prototype folded by m. */
+		memset(worker->branch, 0, 2 * m * sizeof(float));
+		for (q = 0; q < rows; q++)
+		{
+			simd_mac(worker->branch, &ch->taps[2 * q * m], &x[2 * q * m], 2 * m);
+		}
+
+		/* Commutator order is the reverse of the fold order. */
+		for (k = 0; k < m; k++)
+		{
+			worker->fft[2*k] = worker->branch[2*(m-1-k)];
+			worker->fft[2*k+1] = worker->branch[2*(m-1-k)+1];
+		}
+		channelizer_fft(worker->fft, m, ch->twiddle, ch->bitrev);
+
+		for (k = 0; k < m; k++)
+		{
+			ch->output[k][2*n] = worker->fft[2*k];
+			ch->output[k][2*n+1] = worker->fft[2*k+1];
+		}
+	}
+}
+
+static void* channelizer_threadproc(void* arg)
+{
+	channelizer_worker_t* const worker = (channelizer_worker_t*)arg;
+	hackrf_channelizer* const ch = worker->channelizer;
+	uint32_t generation = 0;
+
+	pthread_mutex_lock(&ch->lock);
+	while (true)
+	{
+		while ((ch->generation == generation) && !ch->shutdown)
+		{
+			pthread_cond_wait(&ch->start, &ch->lock);
+		}
+		if (ch->shutdown)
+		{
+			break;
+		}
+		generation = ch->generation;
+		pthread_mutex_unlock(&ch->lock);
+
+		channelizer_run_slice(worker);
+
+		pthread_mutex_lock(&ch->lock);
+		ch->pending--;
+		if (ch->pending == 0)
+		{
+			pthread_cond_signal(&ch->done);
+		}
+	}
+	pthread_mutex_unlock(&ch->lock);
+
+	return NULL;
+}
+
+static int channelizer_reserve(hackrf_channelizer* const ch,
+		const uint32_t input_count, const uint32_t output_count)
+{
+	uint32_t k;
+	float* p;
+
+	if (input_count > ch->input_capacity)
+	{
+		p = (float*)realloc(ch->input, 2 * input_count * sizeof(float));
+		if (p == NULL)
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		ch->input = p;
+		ch->input_capacity = input_count;
+	}
+
+	if (output_count > ch->output_capacity)
+	{
+		for (k = 0; k < ch->num_channels; k++)
+		{
+			p = (float*)realloc(ch->output[k], 2 * output_count * sizeof(float));
+			if (p == NULL)
+			{
+				return HACKRF_ERROR_NO_MEM;
+			}
+			ch->output[k] = p;
+		}
+		ch->output_capacity = output_count;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+static void channelizer_design_prototype(float* h, const uint32_t length,
+		const uint32_t num_channels)
+{
+	const double cutoff = 0.5 / num_channels;
+	const double center = (length - 1) / 2.0;
+	double sum = 0.0;
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		const double t = i - center;
+		const double sinc = (t == 0.0) ? 1.0 : sin(2.0 * M_PI * cutoff * t) / (2.0 * M_PI * cutoff * t);
+		/* Blackman window */
+		const double w = (length > 1)
+			? 0.42 - 0.5 * cos(2.0 * M_PI * i / (length - 1)) + 0.08 * cos(4.0 * M_PI * i / (length - 1))
+			: 1.0;
+		h[i] = (float)(sinc * w);
+		sum += h[i];
+	}
+
+	/* Unity gain at the channel center */
+	for (i = 0; i < length; i++)
+	{
+		h[i] = (float)(h[i] / sum);
+	}
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_channelizer_create(hackrf_channelizer** channelizer,
+		const uint32_t num_channels, const uint32_t taps_per_channel,
+		const float* taps, const uint32_t num_threads,
+		hackrf_channel_cb_fn callback, void* ctx)
+{
+	hackrf_channelizer* ch;
+	float* prototype;
+	uint32_t i, j, bits;
+
+	if ((channelizer == NULL) || (callback == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if ((num_channels < 2) || (num_channels > CHANNELIZER_MAX_CHANNELS)
+			|| (num_channels & (num_channels - 1)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if ((taps_per_channel < 1) || (taps_per_channel > CHANNELIZER_MAX_TAPS_PER_CHANNEL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	ch = (hackrf_channelizer*)calloc(1, sizeof(*ch));
+	if (ch == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	pthread_mutex_init(&ch->lock, NULL);
+	pthread_cond_init(&ch->start, NULL);
+	pthread_cond_init(&ch->done, NULL);
+
+	ch->num_channels = num_channels;
+	ch->window = num_channels * taps_per_channel;
+	ch->callback = callback;
+	ch->ctx = ctx;
+	ch->num_threads = (num_threads == 0) ? 1 : num_threads;
+
+	ch->taps = (float*)malloc(2 * ch->window * sizeof(float));
+	ch->twiddle = (float*)malloc(num_channels * sizeof(float));
+	ch->bitrev = (uint32_t*)malloc(num_channels * sizeof(uint32_t));
+	ch->output = (float**)calloc(num_channels, sizeof(float*));
+	ch->workers = (channelizer_worker_t*)calloc(ch->num_threads, sizeof(channelizer_worker_t));
+	prototype = (float*)malloc(ch->window * sizeof(float));
+	if ((ch->taps == NULL) || (ch->twiddle == NULL) || (ch->bitrev == NULL)
+			|| (ch->output == NULL) || (ch->workers == NULL) || (prototype == NULL))
+	{
+		free(prototype);
+		hackrf_channelizer_destroy(ch);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	if (taps != NULL)
+	{
+		memcpy(prototype, taps, ch->window * sizeof(float));
+	} else {
+		channelizer_design_prototype(prototype, ch->window, num_channels);
+	}
+	for (i = 0; i < ch->window; i++)
+	{
+		ch->taps[2*i] = prototype[ch->window - 1 - i];
+		ch->taps[2*i+1] = prototype[ch->window - 1 - i];
+	}
+	free(prototype);
+
+	for (i = 0; i < num_channels / 2; i++)
+	{
+		ch->twiddle[2*i] = (float)cos(2.0 * M_PI * i / num_channels);
+		ch->twiddle[2*i+1] = (float)sin(2.0 * M_PI * i / num_channels);
+	}
+	for (bits = 0; (1U << bits) < num_channels; bits++);
+	for (i = 0; i < num_channels; i++)
+	{
+		uint32_t r = 0;
+		for (j = 0; j < bits; j++)
+		{
+			r |= ((i >> j) & 1) << (bits - 1 - j);
+		}
+		ch->bitrev[i] = r;
+	}
+
+	/* Start with a zeroed history of all but one block of the window. */
+	if (channelizer_reserve(ch, ch->window, 1) != HACKRF_SUCCESS)
+	{
+		hackrf_channelizer_destroy(ch);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	ch->input_count = ch->window - num_channels;
+	memset(ch->input, 0, 2 * ch->input_count * sizeof(float));
+
+	for (i = 0; i < ch->num_threads; i++)
+	{
+		channelizer_worker_t* const worker = &ch->workers[i];
+		worker->channelizer = ch;
+		worker->index = i;
+		worker->branch = (float*)malloc(2 * num_channels * sizeof(float));
+		worker->fft = (float*)malloc(2 * num_channels * sizeof(float));
+		if ((worker->branch == NULL) || (worker->fft == NULL))
+		{
+			hackrf_channelizer_destroy(ch);
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+
+	/* Worker 0 is the thread calling hackrf_channelizer_execute(). */
+	for (i = 1; i < ch->num_threads; i++)
+	{
+		if (pthread_create(&ch->workers[i].thread, NULL, channelizer_threadproc, &ch->workers[i]) != 0)
+		{
+			hackrf_channelizer_destroy(ch);
+			return HACKRF_ERROR_THREAD;
+		}
+		ch->running++;
+	}
+
+	*channelizer = ch;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_destroy(hackrf_channelizer* channelizer)
+{
+	uint32_t i;
+
+	if (channelizer == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (channelizer->running > 0)
+	{
+		pthread_mutex_lock(&channelizer->lock);
+		channelizer->shutdown = true;
+		pthread_cond_broadcast(&channelizer->start);
+		pthread_mutex_unlock(&channelizer->lock);
+		for (i = 1; i <= channelizer->running; i++)
+		{
+			pthread_join(channelizer->workers[i].thread, NULL);
+		}
+	}
+	pthread_cond_destroy(&channelizer->done);
+	pthread_cond_destroy(&channelizer->start);
+	pthread_mutex_destroy(&channelizer->lock);
+
+	if (channelizer->workers != NULL)
+	{
+		for (i = 0; i < channelizer->num_threads; i++)
+		{
+			free(channelizer->workers[i].branch);
+			free(channelizer->workers[i].fft);
+		}
+		free(channelizer->workers);
+	}
+
+	if (channelizer->output != NULL)
+	{
+		for (i = 0; i < channelizer->num_channels; i++)
+		{
+			free(channelizer->output[i]);
+		}
+		free(channelizer->output);
+	}
+
+	free(channelizer->input);
+	free(channelizer->bitrev);
+	free(channelizer->twiddle);
+	free(channelizer->taps);
+	free(channelizer);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_execute(hackrf_channelizer* channelizer,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_channelizer* const ch = channelizer;
+	const uint32_t count = length / 2;
+	uint32_t outputs, consumed, k;
+	int result;
+
+	if ((ch == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = channelizer_reserve(ch, ch->input_count + count, 0);
+	if (result != HACKRF_SUCCESS)
+	{
+		return result;
+	}
+	simd_s8_to_f32(&ch->input[2 * ch->input_count], samples, 2 * count);
+	ch->input_count += count;
+
+	if (ch->input_count < ch->window)
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	outputs = (ch->input_count - ch->window) / ch->num_channels + 1;
+	result = channelizer_reserve(ch, 0, outputs);
+	if (result != HACKRF_SUCCESS)
+	{
+		return result;
+	}
+	ch->output_count = outputs;
+
+	if ((ch->running > 0) && (outputs >= ch->num_threads))
+	{
+		pthread_mutex_lock(&ch->lock);
+		ch->slices = ch->num_threads;
+		ch->pending = ch->running;
+		ch->generation++;
+		pthread_cond_broadcast(&ch->start);
+		pthread_mutex_unlock(&ch->lock);
+
+		channelizer_run_slice(&ch->workers[0]);
+
+		pthread_mutex_lock(&ch->lock);
+		while (ch->pending != 0)
+		{
+			pthread_cond_wait(&ch->done, &ch->lock);
+		}
+		pthread_mutex_unlock(&ch->lock);
+	} else {
+		/* Too little work to be worth waking the pool. */
+		ch->slices = 1;
+		channelizer_run_slice(&ch->workers[0]);
+	}
+
+	/* Keep everything past the consumed blocks as history. */
+	consumed = outputs * ch->num_channels;
+	memmove(ch->input, &ch->input[2 * consumed],
+			2 * (ch->input_count - consumed) * sizeof(float));
+	ch->input_count -= consumed;
+
+	for (k = 0; k < ch->num_channels; k++)
+	{
+		if (ch->callback(k, ch->output[k], outputs, ch->ctx) != 0)
+		{
+			return HACKRF_ERROR_STREAMING_EXIT_CALLED;
+		}
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_channelizer_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_channelizer* const ch = (hackrf_channelizer*)transfer->rx_ctx;
+	if (hackrf_channelizer_execute(ch, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
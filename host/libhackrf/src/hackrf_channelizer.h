@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HACKRF_CHANNELIZER_H__
+#define __HACKRF_CHANNELIZER_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+
+/*
+ * Critically sampled polyphase filter bank channelizer.
+ *
+ * The input stream (HackRF interleaved signed 8 bit I/Q at rate fs) is split
+ * into num_channels channels, each decimated by num_channels. Channel k is
+ * centered on k * fs / num_channels; channels above num_channels / 2 are the
+ * negative frequencies. Channel output is interleaved float I/Q.
+ */
+
+typedef struct hackrf_channelizer hackrf_channelizer;
+
+/* Called once per channel for each block of input. Return non-zero to stop. */
+typedef int (*hackrf_channel_cb_fn)(uint32_t channel, const float* samples,
+		uint32_t sample_count, void* ctx);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* num_channels: power of two, 2-1024.
+   taps_per_channel: prototype filter length is num_channels * taps_per_channel.
+   taps: optional prototype lowpass (num_channels * taps_per_channel floats),
+         NULL selects a windowed sinc with cutoff at the channel edge.
+   num_threads: worker threads including the caller, 0 selects 1. */
+extern ADDAPI int ADDCALL hackrf_channelizer_create(hackrf_channelizer** channelizer,
+		const uint32_t num_channels, const uint32_t taps_per_channel,
+		const float* taps, const uint32_t num_threads,
+		hackrf_channel_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_channelizer_destroy(hackrf_channelizer* channelizer);
+
+/* Feed length bytes of interleaved I/Q; any length is accepted. */
+extern ADDAPI int ADDCALL hackrf_channelizer_execute(hackrf_channelizer* channelizer,
+		const int8_t* samples, const uint32_t length);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the
+   channelizer as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_channelizer_rx_callback(hackrf_transfer* transfer);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_CHANNELIZER_H__
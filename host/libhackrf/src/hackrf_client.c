@@ -0,0 +1,454 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "hackrf_client.h"
+#include "hackrf_shm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define CLIENT_MAX_NAME (256)
+#define CLIENT_POLL_MS (100)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef _WIN32
+
+struct hackrf_client {
+	int fd;
+	pthread_mutex_t lock; /* one request in flight */
+
+	hackrf_sample_block_cb_fn callback;
+	void* rx_ctx;
+	hackrf_shm_reader* reader;
+	uint8_t* buffer;
+	uint32_t buffer_size;
+	pthread_t thread;
+	bool thread_started;
+	volatile bool streaming;
+	volatile bool stop;
+};
+
+static bool client_io(const int fd, void* buffer, const uint32_t length, const bool send_data)
+{
+	uint32_t done = 0;
+	ssize_t n;
+
+	while (done < length)
+	{
+		n = send_data
+				? send(fd, (const uint8_t*)buffer + done, length - done, 0)
+				: recv(fd, (uint8_t*)buffer + done, length - done, 0);
+		if (n <= 0)
+		{
+			if ((n < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			return false;
+		}
+		done += (uint32_t)n;
+	}
+	return true;
+}
+
+/* Send a request and wait for the REPLY. A reply payload, if any, goes to
+   payload (up to payload_size bytes, the rest is discarded). */
+static int client_request(hackrf_client* c, const uint32_t type, const uint64_t value,
+		char* payload, const uint32_t payload_size)
+{
+	hackrf_client_frame frame;
+	uint8_t discard;
+	uint32_t i;
+	int result;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.type = type;
+	frame.value = value;
+
+	pthread_mutex_lock(&c->lock);
+	if (!client_io(c->fd, &frame, sizeof(frame), true)
+			|| !client_io(c->fd, &frame, sizeof(frame), false)
+			|| (frame.type != HACKRF_CLIENT_REPLY))
+	{
+		pthread_mutex_unlock(&c->lock);
+		return HACKRF_ERROR_OTHER;
+	}
+	for (i = 0; i < frame.length; i++)
+	{
+		if (!client_io(c->fd, (i < payload_size) ? (void*)&payload[i] : (void*)&discard, 1, false))
+		{
+			pthread_mutex_unlock(&c->lock);
+			return HACKRF_ERROR_OTHER;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	result = (int)(int64_t)frame.value;
+	return result;
+}
+
+/* A setter's reply comes once the daemon has started a new settings
+   generation, so from then on RX skips blocks captured before it. */
+static int client_set(hackrf_client* c, const uint32_t type, const uint64_t value)
+{
+	const int result = client_request(c, type, value, NULL, 0);
+	if ((result == HACKRF_SUCCESS) && (c->reader != NULL))
+	{
+		hackrf_shm_reader_sync(c->reader);
+	}
+	return result;
+}
+
+static void* client_threadproc(void* arg)
+{
+	hackrf_client* const c = (hackrf_client*)arg;
+	hackrf_transfer transfer;
+	hackrf_shm_block block;
+	int result;
+
+	memset(&transfer, 0, sizeof(transfer));
+	transfer.buffer = c->buffer;
+	transfer.buffer_length = (int)c->buffer_size;
+	transfer.rx_ctx = c->rx_ctx;
+
+	while (!c->stop)
+	{
+		result = hackrf_shm_reader_next(c->reader, &block, CLIENT_POLL_MS);
+		if (result == HACKRF_ERROR_NOT_FOUND)
+		{
+			continue;
+		}
+		if ((result != HACKRF_SUCCESS) || (block.length > c->buffer_size))
+		{
+			break;
+		}
+		memcpy(c->buffer, block.samples, block.length);
+		if (hackrf_shm_reader_release(c->reader, &block) != HACKRF_SUCCESS)
+		{
+			/* Overwritten while copying. */
+			continue;
+		}
+		transfer.valid_length = (int)block.length;
+		if (c->callback(&transfer) != 0)
+		{
+			break;
+		}
+	}
+	c->streaming = false;
+
+	return NULL;
+}
+
+int ADDCALL hackrf_client_open(hackrf_client** client, const char* socket_path)
+{
+	const char* path = (socket_path != NULL) ? socket_path : HACKRF_CLIENT_DEFAULT_SOCKET;
+	struct sockaddr_un addr;
+	hackrf_client* c;
+
+	if ((client == NULL) || (strlen(path) >= sizeof(addr.sun_path)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	c = (hackrf_client*)calloc(1, sizeof(*c));
+	if (c == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (c->fd < 0)
+	{
+		free(c);
+		return HACKRF_ERROR_OTHER;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if (connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		close(c->fd);
+		free(c);
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	pthread_mutex_init(&c->lock, NULL);
+
+	*client = c;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_client_close(hackrf_client* client)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	hackrf_client_stop_rx(client);
+	/* The daemon drops this client's RX interest when the socket closes. */
+	close(client->fd);
+	pthread_mutex_destroy(&client->lock);
+	free(client);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_client_start_rx(hackrf_client* client,
+		hackrf_sample_block_cb_fn callback, void* rx_ctx)
+{
+	hackrf_client* const c = client;
+	char name[CLIENT_MAX_NAME];
+	int result;
+
+	if ((c == NULL) || (callback == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (c->thread_started)
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	memset(name, 0, sizeof(name));
+	result = client_request(c, HACKRF_CLIENT_START_RX, 0, name, sizeof(name) - 1);
+	if (result != HACKRF_SUCCESS)
+	{
+		return result;
+	}
+
+	result = hackrf_shm_reader_open(&c->reader, name);
+	if (result != HACKRF_SUCCESS)
+	{
+		client_request(c, HACKRF_CLIENT_STOP_RX, 0, NULL, 0);
+		return result;
+	}
+
+	c->buffer_size = HACKRF_SHM_DEFAULT_SLOT_SIZE;
+	c->buffer = (uint8_t*)malloc(c->buffer_size);
+	if (c->buffer == NULL)
+	{
+		hackrf_client_stop_rx(c);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	c->callback = callback;
+	c->rx_ctx = rx_ctx;
+	c->stop = false;
+	c->streaming = true;
+	if (pthread_create(&c->thread, NULL, client_threadproc, c) != 0)
+	{
+		c->streaming = false;
+		hackrf_client_stop_rx(c);
+		return HACKRF_ERROR_THREAD;
+	}
+	c->thread_started = true;
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_client_stop_rx(hackrf_client* client)
+{
+	hackrf_client* const c = client;
+	int result = HACKRF_SUCCESS;
+
+	if (c == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (c->thread_started)
+	{
+		c->stop = true;
+		pthread_join(c->thread, NULL);
+		c->thread_started = false;
+	}
+	if (c->reader != NULL)
+	{
+		hackrf_shm_reader_close(c->reader);
+		c->reader = NULL;
+		result = client_request(c, HACKRF_CLIENT_STOP_RX, 0, NULL, 0);
+	}
+	free(c->buffer);
+	c->buffer = NULL;
+	c->streaming = false;
+
+	return result;
+}
+
+int ADDCALL hackrf_client_is_streaming(hackrf_client* client)
+{
+	if ((client != NULL) && client->streaming)
+	{
+		return HACKRF_TRUE;
+	}
+	return HACKRF_ERROR_STREAMING_STOPPED;
+}
+
+int ADDCALL hackrf_client_set_freq(hackrf_client* client, const uint64_t freq_hz)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_FREQ, freq_hz);
+}
+
+int ADDCALL hackrf_client_set_sample_rate(hackrf_client* client, const double freq_hz)
+{
+	if ((client == NULL) || (freq_hz < 0.0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_SAMPLE_RATE, (uint64_t)(freq_hz + 0.5));
+}
+
+int ADDCALL hackrf_client_set_baseband_filter_bandwidth(hackrf_client* client,
+		const uint32_t bandwidth_hz)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_BASEBAND_FILTER, bandwidth_hz);
+}
+
+int ADDCALL hackrf_client_set_lna_gain(hackrf_client* client, uint32_t value)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_LNA_GAIN, value);
+}
+
+int ADDCALL hackrf_client_set_vga_gain(hackrf_client* client, uint32_t value)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_VGA_GAIN, value);
+}
+
+int ADDCALL hackrf_client_set_amp_enable(hackrf_client* client, const uint8_t value)
+{
+	if (client == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return client_set(client, HACKRF_CLIENT_SET_AMP_ENABLE, value);
+}
+
+int ADDCALL hackrf_client_stats(hackrf_client* client, uint64_t* received, uint64_t* lost)
+{
+	if ((client == NULL) || (client->reader == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	return hackrf_shm_reader_stats(client->reader, received, lost);
+}
+
+#else /* _WIN32 */
+
+int ADDCALL hackrf_client_open(hackrf_client** client, const char* socket_path)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_close(hackrf_client* client)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_start_rx(hackrf_client* client,
+		hackrf_sample_block_cb_fn callback, void* rx_ctx)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_stop_rx(hackrf_client* client)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_is_streaming(hackrf_client* client)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_freq(hackrf_client* client, const uint64_t freq_hz)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_sample_rate(hackrf_client* client, const double freq_hz)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_baseband_filter_bandwidth(hackrf_client* client,
+		const uint32_t bandwidth_hz)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_lna_gain(hackrf_client* client, uint32_t value)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_vga_gain(hackrf_client* client, uint32_t value)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_set_amp_enable(hackrf_client* client, const uint8_t value)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_client_stats(hackrf_client* client, uint64_t* received, uint64_t* lost)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+#endif /* _WIN32 */
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
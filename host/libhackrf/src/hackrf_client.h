@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_CLIENT_H__
+#define __HACKRF_CLIENT_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+
+/*
+ * Client side of hackrfd, the device daemon.
+ *
+ * hackrfd keeps a board open and configured and streams RX into shared
+ * memory (hackrf_shm.h). These calls mirror their hackrf.h namesakes but
+ * go over the daemon's Unix control socket, so a short capture skips
+ * device enumeration, interface claim and configuration entirely. Settings
+ * are device wide and shared by all clients of a daemon.
+ *
+ * The RX callback runs on a client thread with a private copy of each
+ * block, so it may modify transfer->buffer as with hackrf_start_rx().
+ * transfer->device is NULL. Once a setter returns, the callback only sees
+ * blocks captured with the new settings.
+ *
+ * Not available on Windows; every call returns HACKRF_ERROR_OTHER there.
+ */
+
+#define HACKRF_CLIENT_DEFAULT_SOCKET "/tmp/hackrfd.sock"
+
+/* Wire protocol: each request is a frame header, answered by a REPLY frame
+   whose value is the hackrf_error result. The START_RX reply carries the
+   shared memory name as its payload. Host byte order. */
+typedef struct {
+	uint32_t type;
+	uint32_t length;
+	uint64_t value;
+} hackrf_client_frame;
+
+enum hackrf_client_request {
+	HACKRF_CLIENT_REPLY = 3,
+	HACKRF_CLIENT_SET_FREQ = 17,
+	HACKRF_CLIENT_SET_SAMPLE_RATE = 18,
+	HACKRF_CLIENT_SET_BASEBAND_FILTER = 19,
+	HACKRF_CLIENT_SET_LNA_GAIN = 20,
+	HACKRF_CLIENT_SET_VGA_GAIN = 21,
+	HACKRF_CLIENT_SET_TXVGA_GAIN = 22,
+	HACKRF_CLIENT_SET_AMP_ENABLE = 23,
+	HACKRF_CLIENT_START_RX = 32,
+	HACKRF_CLIENT_STOP_RX = 33,
+};
+
+typedef struct hackrf_client hackrf_client;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* socket_path: NULL selects HACKRF_CLIENT_DEFAULT_SOCKET. */
+extern ADDAPI int ADDCALL hackrf_client_open(hackrf_client** client, const char* socket_path);
+extern ADDAPI int ADDCALL hackrf_client_close(hackrf_client* client);
+
+extern ADDAPI int ADDCALL hackrf_client_start_rx(hackrf_client* client,
+		hackrf_sample_block_cb_fn callback, void* rx_ctx);
+extern ADDAPI int ADDCALL hackrf_client_stop_rx(hackrf_client* client);
+extern ADDAPI int ADDCALL hackrf_client_is_streaming(hackrf_client* client);
+
+extern ADDAPI int ADDCALL hackrf_client_set_freq(hackrf_client* client, const uint64_t freq_hz);
+extern ADDAPI int ADDCALL hackrf_client_set_sample_rate(hackrf_client* client, const double freq_hz);
+extern ADDAPI int ADDCALL hackrf_client_set_baseband_filter_bandwidth(hackrf_client* client,
+		const uint32_t bandwidth_hz);
+extern ADDAPI int ADDCALL hackrf_client_set_lna_gain(hackrf_client* client, uint32_t value);
+extern ADDAPI int ADDCALL hackrf_client_set_vga_gain(hackrf_client* client, uint32_t value);
+extern ADDAPI int ADDCALL hackrf_client_set_amp_enable(hackrf_client* client, const uint8_t value);
+
+/* lost: RX blocks this client missed because its callback fell behind. */
+extern ADDAPI int ADDCALL hackrf_client_stats(hackrf_client* client,
+		uint64_t* received, uint64_t* lost);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_CLIENT_H__
@@ -0,0 +1,1024 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "hackrf_iqz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define iqz_fseek _fseeki64
+#define iqz_ftell _ftelli64
+#else
+#define iqz_fseek fseeko
+#define iqz_ftell ftello
+#endif
+
+#define IQZ_VERSION (1)
+#define IQZ_FILE_MAGIC "HIQZ"
+#define IQZ_BLOCK_MAGIC "HIQB"
+#define IQZ_INDEX_MAGIC "HIQI"
+
+#define IQZ_METHOD_STORED (0)
+#define IQZ_METHOD_RICE (1)
+
+#define IQZ_PARTITION (256)  /* samples per Rice parameter */
+#define IQZ_ESCAPE (16)      /* unary length that escapes to a raw value */
+#define IQZ_ESCAPE_BITS (11) /* enough for any order 2 residual */
+#define IQZ_MAX_K (10)
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t block_size;
+	uint32_t reserved;
+} iqz_file_header_t;
+
+typedef struct {
+	char magic[4];
+	uint32_t raw_length;
+	uint32_t payload_length;
+	uint8_t method;
+	uint8_t reserved[3];
+} iqz_block_header_t;
+
+typedef struct {
+	char magic[4];
+	uint32_t reserved;
+	uint64_t block_count;
+	uint64_t index_offset;
+} iqz_trailer_t;
+
+/* Bit packing, MSB first. */
+
+typedef struct {
+	uint8_t* out;
+	uint32_t length;
+	uint64_t acc;
+	uint32_t bits;
+} iqz_bit_writer_t;
+
+static void iqz_put(iqz_bit_writer_t* bw, const uint32_t value, const uint32_t n)
+{
+	bw->acc = (bw->acc << n) | value;
+	bw->bits += n;
+	if (bw->bits >= 32)
+	{
+		const uint32_t v = (uint32_t)(bw->acc >> (bw->bits - 32));
+		bw->out[bw->length++] = (uint8_t)(v >> 24);
+		bw->out[bw->length++] = (uint8_t)(v >> 16);
+		bw->out[bw->length++] = (uint8_t)(v >> 8);
+		bw->out[bw->length++] = (uint8_t)v;
+		bw->bits -= 32;
+	}
+}
+
+static void iqz_flush(iqz_bit_writer_t* bw)
+{
+	while (bw->bits >= 8)
+	{
+		bw->out[bw->length++] = (uint8_t)(bw->acc >> (bw->bits - 8));
+		bw->bits -= 8;
+	}
+	if (bw->bits > 0)
+	{
+		bw->out[bw->length++] = (uint8_t)(bw->acc << (8 - bw->bits));
+		bw->bits = 0;
+	}
+}
+
+typedef struct {
+	const uint8_t* in;
+	uint32_t length;
+	uint32_t pos;
+	uint64_t acc;
+	uint32_t bits;
+} iqz_bit_reader_t;
+
+static void iqz_refill(iqz_bit_reader_t* br)
+{
+	/* Past the end reads zeros; the caller checks pos afterwards. */
+	while (br->bits <= 56)
+	{
+		br->acc = (br->acc << 8) | ((br->pos < br->length) ? br->in[br->pos] : 0);
+		br->pos++;
+		br->bits += 8;
+	}
+}
+
+static uint32_t iqz_get(iqz_bit_reader_t* br, const uint32_t n)
+{
+	uint32_t v;
+	if (n == 0)
+	{
+		return 0;
+	}
+	if (br->bits < n)
+	{
+		iqz_refill(br);
+	}
+	v = (uint32_t)(br->acc >> (br->bits - n)) & (uint32_t)((1ULL << n) - 1);
+	br->bits -= n;
+	return v;
+}
+
+static uint32_t iqz_clz32(const uint32_t v)
+{
+#if defined(__GNUC__)
+	return (uint32_t)__builtin_clz(v);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, v);
+	return 31 - index;
+#else
+	uint32_t n = 0;
+	while ((v & (0x80000000U >> n)) == 0)
+	{
+		n++;
+	}
+	return n;
+#endif
+}
+
+/* Block coding. */
+
+/* Encoding gives up once the payload reaches the raw length, which can
+   overshoot by at most one partition of escaped values. */
+static uint32_t iqz_payload_bound(const uint32_t length)
+{
+	return length + (IQZ_PARTITION * (IQZ_ESCAPE + IQZ_ESCAPE_BITS)) / 8 + 64;
+}
+
+/* Returns false as soon as the output reaches limit bytes. */
+static bool iqz_encode_channel(iqz_bit_writer_t* bw, const int8_t* raw,
+		const uint32_t count, uint16_t* residual, const uint32_t limit)
+{
+	uint32_t sum[3] = { 0, 0, 0 };
+	int32_t x1 = 0, x2 = 0;
+	uint32_t order, i, p;
+
+	for (i = 0; i < count; i++)
+	{
+		const int32_t x = raw[2*i];
+		const int32_t r1 = x - x1;
+		const int32_t r2 = x - 2*x1 + x2;
+		sum[0] += (x < 0) ? -x : x;
+		sum[1] += (r1 < 0) ? -r1 : r1;
+		sum[2] += (r2 < 0) ? -r2 : r2;
+		x2 = x1;
+		x1 = x;
+	}
+	order = 0;
+	if (sum[1] < sum[order]) order = 1;
+	if (sum[2] < sum[order]) order = 2;
+
+	x1 = 0;
+	x2 = 0;
+	for (i = 0; i < count; i++)
+	{
+		const int32_t x = raw[2*i];
+		int32_t r;
+		if (order == 0) {
+			r = x;
+		} else if (order == 1) {
+			r = x - x1;
+		} else {
+			r = x - 2*x1 + x2;
+		}
+		residual[i] = (uint16_t)((r < 0) ? ((-r << 1) - 1) : (r << 1));
+		x2 = x1;
+		x1 = x;
+	}
+
+	iqz_put(bw, order, 2);
+
+	for (p = 0; p < count; p += IQZ_PARTITION)
+	{
+		const uint32_t n = ((count - p) < IQZ_PARTITION) ? (count - p) : IQZ_PARTITION;
+		uint32_t total = 0;
+		uint32_t k = 0;
+
+		for (i = 0; i < n; i++)
+		{
+			total += residual[p + i];
+		}
+		while ((k < IQZ_MAX_K) && ((n << (k + 1)) < total))
+		{
+			k++;
+		}
+		iqz_put(bw, k, 4);
+
+		for (i = 0; i < n; i++)
+		{
+			const uint32_t u = residual[p + i];
+			const uint32_t q = u >> k;
+			if (q < IQZ_ESCAPE)
+			{
+				/* q zeros, a one, then the low k bits */
+				iqz_put(bw, (1U << k) | (u & ((1U << k) - 1)), q + 1 + k);
+			} else {
+				iqz_put(bw, 0, IQZ_ESCAPE);
+				iqz_put(bw, u, IQZ_ESCAPE_BITS);
+			}
+		}
+
+		if (bw->length >= limit)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int iqz_decode_channel(iqz_bit_reader_t* br, int8_t* raw,
+		const uint32_t count)
+{
+	const uint32_t order = iqz_get(br, 2);
+	int32_t x1 = 0, x2 = 0;
+	uint32_t i, p;
+
+	if (order > 2)
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+
+	for (p = 0; p < count; p += IQZ_PARTITION)
+	{
+		const uint32_t n = ((count - p) < IQZ_PARTITION) ? (count - p) : IQZ_PARTITION;
+		const uint32_t k = iqz_get(br, 4);
+
+		if (k > IQZ_MAX_K)
+		{
+			return HACKRF_ERROR_OTHER;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			uint32_t top, u;
+			int32_t r, x;
+
+			if (br->bits < 32)
+			{
+				iqz_refill(br);
+			}
+			top = (uint32_t)(br->acc >> (br->bits - 32));
+			if ((top >> (32 - IQZ_ESCAPE)) == 0)
+			{
+				br->bits -= IQZ_ESCAPE;
+				u = iqz_get(br, IQZ_ESCAPE_BITS);
+			} else {
+				const uint32_t q = iqz_clz32(top);
+				br->bits -= q + 1;
+				u = (q << k) | iqz_get(br, k);
+			}
+
+			r = (u & 1) ? -(int32_t)((u + 1) >> 1) : (int32_t)(u >> 1);
+			if (order == 0) {
+				x = r;
+			} else if (order == 1) {
+				x = r + x1;
+			} else {
+				x = r + 2*x1 - x2;
+			}
+			if ((x < -128) || (x > 127))
+			{
+				return HACKRF_ERROR_OTHER;
+			}
+			raw[2*(p + i)] = (int8_t)x;
+			x2 = x1;
+			x1 = x;
+		}
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+/* Returns the method; payload receives the encoded block. */
+static uint8_t iqz_encode_block(const int8_t* raw, const uint32_t length,
+		uint8_t* payload, uint32_t* payload_length, uint16_t* residual)
+{
+	iqz_bit_writer_t bw;
+
+	if ((length & 1) == 0)
+	{
+		bw.out = payload;
+		bw.length = 0;
+		bw.acc = 0;
+		bw.bits = 0;
+		if (iqz_encode_channel(&bw, &raw[0], length / 2, residual, length)
+				&& iqz_encode_channel(&bw, &raw[1], length / 2, residual, length))
+		{
+			iqz_flush(&bw);
+		}
+		if (bw.length < length)
+		{
+			*payload_length = bw.length;
+			return IQZ_METHOD_RICE;
+		}
+	}
+
+	memcpy(payload, raw, length);
+	*payload_length = length;
+	return IQZ_METHOD_STORED;
+}
+
+static int iqz_decode_block(const uint8_t method, const uint8_t* payload,
+		const uint32_t payload_length, int8_t* raw, const uint32_t length)
+{
+	iqz_bit_reader_t br;
+	int result;
+
+	if (method == IQZ_METHOD_STORED)
+	{
+		if (payload_length != length)
+		{
+			return HACKRF_ERROR_OTHER;
+		}
+		memcpy(raw, payload, length);
+		return HACKRF_SUCCESS;
+	}
+
+	if ((method != IQZ_METHOD_RICE) || (length & 1))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+
+	br.in = payload;
+	br.length = payload_length;
+	br.pos = 0;
+	br.acc = 0;
+	br.bits = 0;
+	result = iqz_decode_channel(&br, &raw[0], length / 2);
+	if (result == HACKRF_SUCCESS)
+	{
+		result = iqz_decode_channel(&br, &raw[1], length / 2);
+	}
+	if ((result == HACKRF_SUCCESS) && ((br.pos - br.bits / 8) > payload_length))
+	{
+		result = HACKRF_ERROR_OTHER;
+	}
+	return result;
+}
+
+/* Writer. */
+
+typedef enum {
+	IQZ_SLOT_FREE = 0,
+	IQZ_SLOT_READY,   /* full, waiting for a worker */
+	IQZ_SLOT_BUSY,    /* being compressed */
+	IQZ_SLOT_DONE,    /* compressed, waiting for its turn to be written */
+} iqz_slot_state_t;
+
+typedef struct {
+	iqz_slot_state_t state;
+	uint64_t sequence;
+	int8_t* raw;
+	uint32_t raw_length;
+	uint8_t* payload;
+	uint32_t payload_length;
+	uint8_t method;
+	uint16_t* residual;
+} iqz_slot_t;
+
+struct hackrf_iqz_writer {
+	FILE* file;
+	uint32_t block_size;
+	int error;
+
+	iqz_slot_t* slots;
+	uint32_t num_slots;
+	iqz_slot_t* filling; /* slot being filled by the caller, NULL if none */
+	uint64_t next_sequence;
+	uint64_t next_write;
+	bool writing;
+
+	uint64_t* index;
+	uint64_t index_count;
+	uint64_t index_capacity;
+	uint64_t raw_bytes;
+	uint64_t file_bytes;
+
+	pthread_t* threads;
+	uint32_t num_threads;
+	uint32_t running;
+	pthread_mutex_t lock;
+	pthread_cond_t work;  /* a slot became READY, or shutdown */
+	pthread_cond_t freed; /* a slot became FREE */
+	bool shutdown;
+};
+
+/* Called with the lock held. Writes every compressed block that is next in
+   sequence; the lock is dropped around the file I/O. */
+static void iqz_write_ready(hackrf_iqz_writer* w)
+{
+	uint32_t i;
+	bool found;
+
+	if (w->writing)
+	{
+		return;
+	}
+	w->writing = true;
+
+	do {
+		iqz_slot_t* slot = NULL;
+		found = false;
+		for (i = 0; i < w->num_slots; i++)
+		{
+			if ((w->slots[i].state == IQZ_SLOT_DONE) && (w->slots[i].sequence == w->next_write))
+			{
+				slot = &w->slots[i];
+				found = true;
+				break;
+			}
+		}
+
+		if (found)
+		{
+			iqz_block_header_t header;
+			uint64_t offset = w->file_bytes;
+			int error = HACKRF_SUCCESS;
+
+			memcpy(header.magic, IQZ_BLOCK_MAGIC, 4);
+			header.raw_length = slot->raw_length;
+			header.payload_length = slot->payload_length;
+			header.method = slot->method;
+			memset(header.reserved, 0, sizeof(header.reserved));
+
+			if ((w->index_count == w->index_capacity) && (w->error == HACKRF_SUCCESS))
+			{
+				const uint64_t capacity = (w->index_capacity == 0) ? 1024 : (w->index_capacity * 2);
+				uint64_t* p = (uint64_t*)realloc(w->index, (size_t)capacity * sizeof(uint64_t));
+				if (p == NULL)
+				{
+					w->error = HACKRF_ERROR_NO_MEM;
+				} else {
+					w->index = p;
+					w->index_capacity = capacity;
+				}
+			}
+
+			pthread_mutex_unlock(&w->lock);
+			if ((fwrite(&header, sizeof(header), 1, w->file) != 1)
+					|| (fwrite(slot->payload, 1, slot->payload_length, w->file) != slot->payload_length))
+			{
+				error = HACKRF_ERROR_OTHER;
+			}
+			pthread_mutex_lock(&w->lock);
+
+			if (error != HACKRF_SUCCESS)
+			{
+				w->error = error;
+			}
+			if (w->error == HACKRF_SUCCESS)
+			{
+				w->index[w->index_count++] = offset;
+			}
+			w->file_bytes += sizeof(header) + slot->payload_length;
+			w->next_write++;
+			slot->state = IQZ_SLOT_FREE;
+			pthread_cond_broadcast(&w->freed);
+		}
+	} while (found);
+
+	w->writing = false;
+}
+
+static void iqz_compress_slot(iqz_slot_t* slot)
+{
+	slot->method = iqz_encode_block(slot->raw, slot->raw_length,
+			slot->payload, &slot->payload_length, slot->residual);
+}
+
+static void* iqz_threadproc(void* arg)
+{
+	hackrf_iqz_writer* const w = (hackrf_iqz_writer*)arg;
+	uint32_t i;
+
+	pthread_mutex_lock(&w->lock);
+	while (true)
+	{
+		iqz_slot_t* slot = NULL;
+		for (i = 0; i < w->num_slots; i++)
+		{
+			if ((w->slots[i].state == IQZ_SLOT_READY)
+					&& ((slot == NULL) || (w->slots[i].sequence < slot->sequence)))
+			{
+				slot = &w->slots[i];
+			}
+		}
+
+		if (slot == NULL)
+		{
+			if (w->shutdown)
+			{
+				break;
+			}
+			pthread_cond_wait(&w->work, &w->lock);
+			continue;
+		}
+
+		slot->state = IQZ_SLOT_BUSY;
+		pthread_mutex_unlock(&w->lock);
+		iqz_compress_slot(slot);
+		pthread_mutex_lock(&w->lock);
+		slot->state = IQZ_SLOT_DONE;
+		iqz_write_ready(w);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+/* Hand the slot being filled over for compression. */
+static void iqz_submit(hackrf_iqz_writer* w)
+{
+	iqz_slot_t* const slot = w->filling;
+
+	w->filling = NULL;
+	pthread_mutex_lock(&w->lock);
+	slot->sequence = w->next_sequence++;
+	if (w->running > 0)
+	{
+		slot->state = IQZ_SLOT_READY;
+		pthread_cond_signal(&w->work);
+	} else {
+		slot->state = IQZ_SLOT_BUSY;
+		pthread_mutex_unlock(&w->lock);
+		iqz_compress_slot(slot);
+		pthread_mutex_lock(&w->lock);
+		slot->state = IQZ_SLOT_DONE;
+		iqz_write_ready(w);
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void iqz_writer_free(hackrf_iqz_writer* w)
+{
+	uint32_t i;
+
+	if (w->running > 0)
+	{
+		pthread_mutex_lock(&w->lock);
+		w->shutdown = true;
+		pthread_cond_broadcast(&w->work);
+		pthread_mutex_unlock(&w->lock);
+		for (i = 0; i < w->running; i++)
+		{
+			pthread_join(w->threads[i], NULL);
+		}
+	}
+	pthread_cond_destroy(&w->freed);
+	pthread_cond_destroy(&w->work);
+	pthread_mutex_destroy(&w->lock);
+
+	if (w->slots != NULL)
+	{
+		for (i = 0; i < w->num_slots; i++)
+		{
+			free(w->slots[i].raw);
+			free(w->slots[i].payload);
+			free(w->slots[i].residual);
+		}
+		free(w->slots);
+	}
+	free(w->threads);
+	free(w->index);
+	free(w);
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_iqz_writer_create(hackrf_iqz_writer** writer,
+		FILE* file, const uint32_t block_size, const uint32_t num_threads)
+{
+	hackrf_iqz_writer* w;
+	iqz_file_header_t header;
+	uint32_t i;
+
+	if ((writer == NULL) || (file == NULL) || (block_size & 1)
+			|| (block_size > HACKRF_IQZ_MAX_BLOCK_SIZE))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	w = (hackrf_iqz_writer*)calloc(1, sizeof(*w));
+	if (w == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->work, NULL);
+	pthread_cond_init(&w->freed, NULL);
+
+	w->file = file;
+	w->block_size = (block_size == 0) ? HACKRF_IQZ_DEFAULT_BLOCK_SIZE : block_size;
+	w->error = HACKRF_SUCCESS;
+	w->num_threads = num_threads;
+	/* Double buffer each thread so the caller never waits on a block that
+	   is being written. */
+	w->num_slots = (num_threads == 0) ? 1 : (2 * num_threads + 1);
+
+	w->slots = (iqz_slot_t*)calloc(w->num_slots, sizeof(iqz_slot_t));
+	w->threads = (pthread_t*)calloc((num_threads == 0) ? 1 : num_threads, sizeof(pthread_t));
+	if ((w->slots == NULL) || (w->threads == NULL))
+	{
+		iqz_writer_free(w);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	for (i = 0; i < w->num_slots; i++)
+	{
+		w->slots[i].raw = (int8_t*)malloc(w->block_size);
+		w->slots[i].payload = (uint8_t*)malloc(iqz_payload_bound(w->block_size));
+		w->slots[i].residual = (uint16_t*)malloc((w->block_size / 2 + 1) * sizeof(uint16_t));
+		if ((w->slots[i].raw == NULL) || (w->slots[i].payload == NULL)
+				|| (w->slots[i].residual == NULL))
+		{
+			iqz_writer_free(w);
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+
+	memcpy(header.magic, IQZ_FILE_MAGIC, 4);
+	header.version = IQZ_VERSION;
+	header.block_size = w->block_size;
+	header.reserved = 0;
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		iqz_writer_free(w);
+		return HACKRF_ERROR_OTHER;
+	}
+	w->file_bytes = sizeof(header);
+
+	for (i = 0; i < num_threads; i++)
+	{
+		if (pthread_create(&w->threads[i], NULL, iqz_threadproc, w) != 0)
+		{
+			iqz_writer_free(w);
+			return HACKRF_ERROR_THREAD;
+		}
+		w->running++;
+	}
+
+	*writer = w;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_iqz_writer_write(hackrf_iqz_writer* writer,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_iqz_writer* const w = writer;
+	uint32_t done = 0;
+	uint32_t i;
+
+	if ((w == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	while (done < length)
+	{
+		uint32_t n;
+
+		if (w->filling == NULL)
+		{
+			pthread_mutex_lock(&w->lock);
+			while (w->filling == NULL)
+			{
+				for (i = 0; i < w->num_slots; i++)
+				{
+					if (w->slots[i].state == IQZ_SLOT_FREE)
+					{
+						w->filling = &w->slots[i];
+						w->filling->raw_length = 0;
+						break;
+					}
+				}
+				if (w->filling == NULL)
+				{
+					pthread_cond_wait(&w->freed, &w->lock);
+				}
+			}
+			pthread_mutex_unlock(&w->lock);
+		}
+
+		n = w->block_size - w->filling->raw_length;
+		if (n > (length - done))
+		{
+			n = length - done;
+		}
+		memcpy(&w->filling->raw[w->filling->raw_length], &samples[done], n);
+		w->filling->raw_length += n;
+		done += n;
+
+		if (w->filling->raw_length == w->block_size)
+		{
+			iqz_submit(w);
+		}
+	}
+
+	pthread_mutex_lock(&w->lock);
+	w->raw_bytes += length;
+	pthread_mutex_unlock(&w->lock);
+
+	return w->error;
+}
+
+int ADDCALL hackrf_iqz_writer_stats(hackrf_iqz_writer* writer,
+		uint64_t* raw_bytes, uint64_t* compressed_bytes)
+{
+	if (writer == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	if (raw_bytes != NULL)
+	{
+		*raw_bytes = writer->raw_bytes;
+	}
+	if (compressed_bytes != NULL)
+	{
+		*compressed_bytes = writer->file_bytes;
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_iqz_writer_close(hackrf_iqz_writer* writer)
+{
+	hackrf_iqz_writer* const w = writer;
+	iqz_trailer_t trailer;
+	int result;
+
+	if (w == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if ((w->filling != NULL) && (w->filling->raw_length > 0))
+	{
+		iqz_submit(w);
+	}
+
+	/* Wait for every block to reach the file. */
+	pthread_mutex_lock(&w->lock);
+	while (w->next_write != w->next_sequence)
+	{
+		pthread_cond_wait(&w->freed, &w->lock);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	result = w->error;
+	if (result == HACKRF_SUCCESS)
+	{
+		memcpy(trailer.magic, IQZ_INDEX_MAGIC, 4);
+		trailer.reserved = 0;
+		trailer.block_count = w->index_count;
+		trailer.index_offset = w->file_bytes;
+		if ((w->index_count > 0)
+				&& (fwrite(w->index, sizeof(uint64_t), (size_t)w->index_count, w->file) != w->index_count))
+		{
+			result = HACKRF_ERROR_OTHER;
+		}
+		if ((result == HACKRF_SUCCESS) && (fwrite(&trailer, sizeof(trailer), 1, w->file) != 1))
+		{
+			result = HACKRF_ERROR_OTHER;
+		}
+		if ((result == HACKRF_SUCCESS) && (fflush(w->file) != 0))
+		{
+			result = HACKRF_ERROR_OTHER;
+		}
+	}
+
+	iqz_writer_free(w);
+	return result;
+}
+
+/* Reader. */
+
+struct hackrf_iqz_reader {
+	FILE* file;
+	uint32_t block_size;
+	uint64_t* index;
+	uint64_t block_count;
+	uint8_t* payload;
+};
+
+static int iqz_reader_load_index(hackrf_iqz_reader* r)
+{
+	iqz_trailer_t trailer;
+	int64_t end;
+
+	if (iqz_fseek(r->file, 0, SEEK_END) != 0)
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+	end = iqz_ftell(r->file);
+	if (end < (int64_t)(sizeof(iqz_file_header_t) + sizeof(trailer)))
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	if ((iqz_fseek(r->file, end - sizeof(trailer), SEEK_SET) != 0)
+			|| (fread(&trailer, sizeof(trailer), 1, r->file) != 1)
+			|| (memcmp(trailer.magic, IQZ_INDEX_MAGIC, 4) != 0)
+			|| ((trailer.index_offset + trailer.block_count * sizeof(uint64_t) + sizeof(trailer)) != (uint64_t)end))
+	{
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+
+	r->index = (uint64_t*)malloc((size_t)(trailer.block_count + 1) * sizeof(uint64_t));
+	if (r->index == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	if ((iqz_fseek(r->file, (int64_t)trailer.index_offset, SEEK_SET) != 0)
+			|| (fread(r->index, sizeof(uint64_t), (size_t)trailer.block_count, r->file) != trailer.block_count))
+	{
+		free(r->index);
+		r->index = NULL;
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	r->block_count = trailer.block_count;
+	return HACKRF_SUCCESS;
+}
+
+/* No trailer: walk the block headers up to the first incomplete block. */
+static int iqz_reader_scan_index(hackrf_iqz_reader* r)
+{
+	iqz_block_header_t header;
+	uint64_t offset = sizeof(iqz_file_header_t);
+	uint64_t capacity = 0;
+	uint64_t* p;
+
+	while (true)
+	{
+		if ((iqz_fseek(r->file, (int64_t)offset, SEEK_SET) != 0)
+				|| (fread(&header, sizeof(header), 1, r->file) != 1)
+				|| (memcmp(header.magic, IQZ_BLOCK_MAGIC, 4) != 0)
+				|| (header.raw_length > r->block_size)
+				|| (header.payload_length > iqz_payload_bound(r->block_size)))
+		{
+			break;
+		}
+		/* Make sure the payload is all there. */
+		if ((iqz_fseek(r->file, (int64_t)(offset + sizeof(header) + header.payload_length) - 1, SEEK_SET) != 0)
+				|| (fgetc(r->file) == EOF))
+		{
+			break;
+		}
+
+		if (r->block_count == capacity)
+		{
+			capacity = (capacity == 0) ? 1024 : (capacity * 2);
+			p = (uint64_t*)realloc(r->index, (size_t)capacity * sizeof(uint64_t));
+			if (p == NULL)
+			{
+				return HACKRF_ERROR_NO_MEM;
+			}
+			r->index = p;
+		}
+		r->index[r->block_count++] = offset;
+		offset += sizeof(header) + header.payload_length;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_iqz_reader_open(hackrf_iqz_reader** reader, FILE* file)
+{
+	hackrf_iqz_reader* r;
+	iqz_file_header_t header;
+	int result;
+
+	if ((reader == NULL) || (file == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if ((iqz_fseek(file, 0, SEEK_SET) != 0)
+			|| (fread(&header, sizeof(header), 1, file) != 1)
+			|| (memcmp(header.magic, IQZ_FILE_MAGIC, 4) != 0)
+			|| (header.version != IQZ_VERSION)
+			|| (header.block_size == 0) || (header.block_size > HACKRF_IQZ_MAX_BLOCK_SIZE))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	r = (hackrf_iqz_reader*)calloc(1, sizeof(*r));
+	if (r == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	r->file = file;
+	r->block_size = header.block_size;
+	r->payload = (uint8_t*)malloc(iqz_payload_bound(r->block_size));
+	if (r->payload == NULL)
+	{
+		hackrf_iqz_reader_close(r);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	result = iqz_reader_load_index(r);
+	if (result == HACKRF_ERROR_NOT_FOUND)
+	{
+		result = iqz_reader_scan_index(r);
+	}
+	if (result != HACKRF_SUCCESS)
+	{
+		hackrf_iqz_reader_close(r);
+		return result;
+	}
+
+	*reader = r;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_iqz_reader_close(hackrf_iqz_reader* reader)
+{
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	free(reader->payload);
+	free(reader->index);
+	free(reader);
+	return HACKRF_SUCCESS;
+}
+
+uint32_t ADDCALL hackrf_iqz_reader_block_size(hackrf_iqz_reader* reader)
+{
+	return reader->block_size;
+}
+
+uint64_t ADDCALL hackrf_iqz_reader_block_count(hackrf_iqz_reader* reader)
+{
+	return reader->block_count;
+}
+
+int ADDCALL hackrf_iqz_reader_read_block(hackrf_iqz_reader* reader,
+		const uint64_t index, int8_t* samples, uint32_t* length)
+{
+	hackrf_iqz_reader* const r = reader;
+	iqz_block_header_t header;
+	int result;
+
+	if ((r == NULL) || (samples == NULL) || (length == NULL) || (index >= r->block_count))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if ((iqz_fseek(r->file, (int64_t)r->index[index], SEEK_SET) != 0)
+			|| (fread(&header, sizeof(header), 1, r->file) != 1)
+			|| (memcmp(header.magic, IQZ_BLOCK_MAGIC, 4) != 0)
+			|| (header.raw_length > r->block_size)
+			|| (header.payload_length > iqz_payload_bound(r->block_size))
+			|| (fread(r->payload, 1, header.payload_length, r->file) != header.payload_length))
+	{
+		return HACKRF_ERROR_OTHER;
+	}
+
+	result = iqz_decode_block(header.method, r->payload, header.payload_length,
+			samples, header.raw_length);
+	if (result == HACKRF_SUCCESS)
+	{
+		*length = header.raw_length;
+	}
+	return result;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_IQZ_H__
+#define __HACKRF_IQZ_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hackrf.h"
+
+/*
+ * Lossless compression for HackRF signed 8 bit I/Q captures.
+ *
+ * Samples are cut into fixed size blocks. Each block is compressed on its own
+ * (per channel fixed polynomial prediction, order 0-2, plus partitioned Rice
+ * coding of the residual), so blocks can be compressed in parallel and
+ * decoded independently.
+ *
+ * File layout (little endian):
+ *   file header   "HIQZ", version, block size
+ *   blocks        "HIQB", raw length, payload length, method, payload
+ *   index         one 64 bit file offset per block
+ *   trailer       "HIQI", block count, index offset
+ *
+ * The index is written on close. If it is missing (e.g. the recorder was
+ * killed) the reader rebuilds it by walking the block headers.
+ */
+
+#define HACKRF_IQZ_DEFAULT_BLOCK_SIZE (65536)
+#define HACKRF_IQZ_MAX_BLOCK_SIZE (16777216)
+
+typedef struct hackrf_iqz_writer hackrf_iqz_writer;
+typedef struct hackrf_iqz_reader hackrf_iqz_reader;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* file: opened for binary writing, stays owned by the caller.
+   block_size: raw bytes per block, even, 0 selects the default.
+   num_threads: compression threads, 0 compresses in the calling thread. */
+extern ADDAPI int ADDCALL hackrf_iqz_writer_create(hackrf_iqz_writer** writer,
+		FILE* file, const uint32_t block_size, const uint32_t num_threads);
+
+/* Queue raw interleaved I/Q. Only blocks when every block buffer is waiting
+   on compression. */
+extern ADDAPI int ADDCALL hackrf_iqz_writer_write(hackrf_iqz_writer* writer,
+		const int8_t* samples, const uint32_t length);
+
+/* Flush the last partial block, write the index and free the writer. */
+extern ADDAPI int ADDCALL hackrf_iqz_writer_close(hackrf_iqz_writer* writer);
+
+/* Bytes handed to hackrf_iqz_writer_write() and bytes written to the file
+   so far. */
+extern ADDAPI int ADDCALL hackrf_iqz_writer_stats(hackrf_iqz_writer* writer,
+		uint64_t* raw_bytes, uint64_t* compressed_bytes);
+
+/* file: opened for binary reading, stays owned by the caller. */
+extern ADDAPI int ADDCALL hackrf_iqz_reader_open(hackrf_iqz_reader** reader, FILE* file);
+extern ADDAPI int ADDCALL hackrf_iqz_reader_close(hackrf_iqz_reader* reader);
+
+extern ADDAPI uint32_t ADDCALL hackrf_iqz_reader_block_size(hackrf_iqz_reader* reader);
+extern ADDAPI uint64_t ADDCALL hackrf_iqz_reader_block_count(hackrf_iqz_reader* reader);
+
+/* Decode block index into samples, which must hold block_size bytes.
+   Block index covers raw bytes index * block_size onwards. */
+extern ADDAPI int ADDCALL hackrf_iqz_reader_read_block(hackrf_iqz_reader* reader,
+		const uint64_t index, int8_t* samples, uint32_t* length);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_IQZ_H__
@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "hackrf_nco.h"
+#include "hackrf_simd.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void hackrf_nco_init(hackrf_nco* nco)
+{
+	nco->phase = 0.0;
+	nco->freq = 1.0; /* force the table to be built */
+	hackrf_nco_set_freq(nco, 0.0);
+}
+
+void hackrf_nco_set_freq(hackrf_nco* nco, const double freq)
+{
+	uint32_t k;
+
+	if (freq == nco->freq)
+	{
+		return;
+	}
+	nco->freq = freq;
+
+	/* Computed directly rather than by recurrence so there is no drift
+	   within a block. */
+	for (k = 0; k < HACKRF_NCO_BLOCK; k++)
+	{
+		nco->rotation[2*k] = (float)cos(2.0 * M_PI * freq * k);
+		nco->rotation[2*k+1] = (float)sin(2.0 * M_PI * freq * k);
+	}
+}
+
+void hackrf_nco_mix_s8(hackrf_nco* nco, int8_t* buffer, const uint32_t count)
+{
+	uint32_t done, n, k;
+
+	if (nco->freq == 0.0)
+	{
+		return;
+	}
+
+	for (done = 0; done < count; done += n)
+	{
+		const float sr = (float)cos(2.0 * M_PI * nco->phase);
+		const float si = (float)sin(2.0 * M_PI * nco->phase);
+
+		n = count - done;
+		if (n > HACKRF_NCO_BLOCK)
+		{
+			n = HACKRF_NCO_BLOCK;
+		}
+
+		for (k = 0; k < n; k++)
+		{
+			const float rr = nco->rotation[2*k];
+			const float ri = nco->rotation[2*k+1];
+			nco->phasor[2*k] = sr * rr - si * ri;
+			nco->phasor[2*k+1] = sr * ri + si * rr;
+		}
+		simd_cmul_s8(&buffer[2 * done], nco->phasor, n);
+
+		nco->phase += nco->freq * n;
+		nco->phase -= floor(nco->phase);
+	}
+}
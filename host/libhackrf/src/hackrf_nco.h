@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Numerically controlled oscillator used by the libhackrf frequency
+   shifting. Internal, not installed. */
+
+#ifndef __HACKRF_NCO_H__
+#define __HACKRF_NCO_H__
+
+#include <stdint.h>
+
+#define HACKRF_NCO_BLOCK (256)
+
+typedef struct {
+	double phase;    /* cycles, 0 to 1 */
+	double freq;     /* cycles per sample */
+	float rotation[2 * HACKRF_NCO_BLOCK]; /* e^(j 2 pi freq k) */
+	float phasor[2 * HACKRF_NCO_BLOCK];
+} hackrf_nco;
+
+void hackrf_nco_init(hackrf_nco* nco);
+
+/* freq: cycles per sample, -0.5 to 0.5. Phase is continuous across changes. */
+void hackrf_nco_set_freq(hackrf_nco* nco, const double freq);
+
+/* Multiply count interleaved signed 8 bit I/Q samples in place by the
+   oscillator. */
+void hackrf_nco_mix_s8(hackrf_nco* nco, int8_t* buffer, const uint32_t count);
+
+#endif//__HACKRF_NCO_H__
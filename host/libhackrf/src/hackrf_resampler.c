@@ -0,0 +1,300 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "hackrf_resampler.h"
+#include "hackrf_simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RESAMPLER_DEFAULT_TAPS_PER_PHASE (32)
+#define RESAMPLER_MAX_TAPS_PER_PHASE (256)
+
+struct hackrf_resampler {
+	uint32_t interpolation; /* L */
+	uint32_t decimation;    /* M */
+	uint32_t taps_per_phase;
+	float* taps;            /* per phase, reversed, each tap duplicated for I and Q */
+
+	float* input;           /* interleaved float history followed by new samples */
+	uint32_t input_count;
+	uint32_t input_capacity;
+	uint32_t newest;        /* newest input sample needed by the next output */
+	uint32_t phase;         /* polyphase branch of the next output, 0 to L-1 */
+
+	float* output;
+	uint32_t output_capacity;
+
+	hackrf_resampler_cb_fn callback;
+	void* ctx;
+};
+
+static uint32_t resampler_gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0)
+	{
+		const uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* Blackman windowed sinc at the upsampled rate, passband gain L. */
+static void resampler_design_prototype(float* h, const uint32_t length,
+		const uint32_t interpolation, const uint32_t decimation)
+{
+	const uint32_t widest = (interpolation > decimation) ? interpolation : decimation;
+	const double cutoff = 0.5 / widest;
+	const double center = (length - 1) / 2.0;
+	double sum = 0.0;
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		const double t = i - center;
+		const double sinc = (t == 0.0) ? 1.0 : sin(2.0 * M_PI * cutoff * t) / (2.0 * M_PI * cutoff * t);
+		const double w = (length > 1)
+			? 0.42 - 0.5 * cos(2.0 * M_PI * i / (length - 1)) + 0.08 * cos(4.0 * M_PI * i / (length - 1))
+			: 1.0;
+		h[i] = (float)(sinc * w);
+		sum += h[i];
+	}
+
+	for (i = 0; i < length; i++)
+	{
+		h[i] = (float)(h[i] * interpolation / sum);
+	}
+}
+
+static int resampler_reserve(hackrf_resampler* const rs,
+		const uint32_t input_count, const uint32_t output_count)
+{
+	float* p;
+
+	if (input_count > rs->input_capacity)
+	{
+		p = (float*)realloc(rs->input, 2 * input_count * sizeof(float));
+		if (p == NULL)
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		rs->input = p;
+		rs->input_capacity = input_count;
+	}
+
+	if (output_count > rs->output_capacity)
+	{
+		p = (float*)realloc(rs->output, 2 * output_count * sizeof(float));
+		if (p == NULL)
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+		rs->output = p;
+		rs->output_capacity = output_count;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_resampler_create(hackrf_resampler** resampler,
+		const uint32_t input_rate, const uint32_t output_rate,
+		const uint32_t taps_per_phase,
+		hackrf_resampler_cb_fn callback, void* ctx)
+{
+	hackrf_resampler* rs;
+	float* prototype;
+	uint32_t divisor, length, p, k;
+
+	if ((resampler == NULL) || (callback == NULL)
+			|| (input_rate == 0) || (output_rate == 0)
+			|| (taps_per_phase > RESAMPLER_MAX_TAPS_PER_PHASE))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	divisor = resampler_gcd(input_rate, output_rate);
+	if ((output_rate / divisor) > HACKRF_RESAMPLER_MAX_PHASES)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	rs = (hackrf_resampler*)calloc(1, sizeof(*rs));
+	if (rs == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	rs->interpolation = output_rate / divisor;
+	rs->decimation = input_rate / divisor;
+	rs->taps_per_phase = (taps_per_phase == 0) ? RESAMPLER_DEFAULT_TAPS_PER_PHASE : taps_per_phase;
+	rs->callback = callback;
+	rs->ctx = ctx;
+
+	/* Keep enough taps to reach the same transition band when decimating. */
+	if (rs->decimation > rs->interpolation)
+	{
+		const uint64_t scaled = ((uint64_t)rs->taps_per_phase * rs->decimation
+				+ rs->interpolation - 1) / rs->interpolation;
+		rs->taps_per_phase = (scaled > RESAMPLER_MAX_TAPS_PER_PHASE)
+				? RESAMPLER_MAX_TAPS_PER_PHASE : (uint32_t)scaled;
+	}
+
+	length = rs->interpolation * rs->taps_per_phase;
+	rs->taps = (float*)malloc(2 * length * sizeof(float));
+	prototype = (float*)malloc(length * sizeof(float));
+	if ((rs->taps == NULL) || (prototype == NULL))
+	{
+		free(prototype);
+		hackrf_resampler_destroy(rs);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	resampler_design_prototype(prototype, length, rs->interpolation, rs->decimation);
+
+	/* Branch p holds h[p + k * L], reversed so it lines up with the oldest
+	   input sample first. */
+	for (p = 0; p < rs->interpolation; p++)
+	{
+		float* const branch = &rs->taps[2 * p * rs->taps_per_phase];
+		for (k = 0; k < rs->taps_per_phase; k++)
+		{
+			const float tap = prototype[p + k * rs->interpolation];
+			branch[2 * (rs->taps_per_phase - 1 - k)] = tap;
+			branch[2 * (rs->taps_per_phase - 1 - k) + 1] = tap;
+		}
+	}
+	free(prototype);
+
+	/* Zeroed history so the first output only needs one new sample. */
+	if (resampler_reserve(rs, rs->taps_per_phase, 1) != HACKRF_SUCCESS)
+	{
+		hackrf_resampler_destroy(rs);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	rs->input_count = rs->taps_per_phase - 1;
+	rs->newest = rs->taps_per_phase - 1;
+	memset(rs->input, 0, 2 * rs->input_count * sizeof(float));
+
+	*resampler = rs;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_resampler_destroy(hackrf_resampler* resampler)
+{
+	if (resampler == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	free(resampler->output);
+	free(resampler->input);
+	free(resampler->taps);
+	free(resampler);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_resampler_execute(hackrf_resampler* resampler,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_resampler* const rs = resampler;
+	const uint32_t count = length / 2;
+	const uint32_t taps = (rs != NULL) ? rs->taps_per_phase : 0;
+	uint32_t newest, phase, outputs, consumed;
+	uint64_t max_outputs;
+	int result;
+
+	if ((rs == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	max_outputs = ((uint64_t)(count + 1) * rs->interpolation) / rs->decimation + 1;
+	result = resampler_reserve(rs, rs->input_count + count, (uint32_t)max_outputs);
+	if (result != HACKRF_SUCCESS)
+	{
+		return result;
+	}
+	simd_s8_to_f32(&rs->input[2 * rs->input_count], samples, 2 * count);
+	rs->input_count += count;
+
+	/* Output n uses the branch at the fractional input position and the
+	   taps_per_phase samples ending at the newest one it depends on. */
+	newest = rs->newest;
+	phase = rs->phase;
+	outputs = 0;
+	while (newest < rs->input_count)
+	{
+		simd_dot_iq(&rs->output[2 * outputs], &rs->output[2 * outputs + 1],
+				&rs->taps[2 * phase * taps], &rs->input[2 * (newest + 1 - taps)], taps);
+		outputs++;
+
+		phase += rs->decimation;
+		newest += phase / rs->interpolation;
+		phase %= rs->interpolation;
+	}
+	rs->phase = phase;
+
+	/* Retain the samples the next output still needs. When decimating the
+	   next output may start past the end of this block. */
+	consumed = newest + 1 - taps;
+	if (consumed > rs->input_count)
+	{
+		consumed = rs->input_count;
+	}
+	memmove(rs->input, &rs->input[2 * consumed],
+			2 * (rs->input_count - consumed) * sizeof(float));
+	rs->input_count -= consumed;
+	rs->newest = newest - consumed;
+
+	if ((outputs > 0) && (rs->callback(rs->output, outputs, rs->ctx) != 0))
+	{
+		return HACKRF_ERROR_STREAMING_EXIT_CALLED;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_resampler_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_resampler* const rs = (hackrf_resampler*)transfer->rx_ctx;
+	if (hackrf_resampler_execute(rs, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
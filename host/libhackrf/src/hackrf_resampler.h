@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_RESAMPLER_H__
+#define __HACKRF_RESAMPLER_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+
+/*
+ * Rational polyphase resampler.
+ *
+ * The Si5351C cannot hit every sample rate exactly (e.g. 2.048 MS/s or the
+ * LTE 1.92 MS/s). Run the HackRF at a clean integer rate instead and let the
+ * resampler convert to the exact target: the ratio output_rate / input_rate
+ * is reduced to L / M and every output sample is computed with a single
+ * polyphase branch of an L-phase anti-aliasing filter.
+ *
+ * Input is HackRF interleaved signed 8 bit I/Q, output is interleaved float.
+ */
+
+#define HACKRF_RESAMPLER_MAX_PHASES (4096)
+
+typedef struct hackrf_resampler hackrf_resampler;
+
+/* Called with each block of output. Return non-zero to stop. */
+typedef int (*hackrf_resampler_cb_fn)(const float* samples, uint32_t sample_count,
+		void* ctx);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* input_rate, output_rate: in Hz; after reduction by their greatest common
+   divisor the interpolation factor must not exceed HACKRF_RESAMPLER_MAX_PHASES.
+   taps_per_phase: 0 selects a default (32). */
+extern ADDAPI int ADDCALL hackrf_resampler_create(hackrf_resampler** resampler,
+		const uint32_t input_rate, const uint32_t output_rate,
+		const uint32_t taps_per_phase,
+		hackrf_resampler_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL hackrf_resampler_destroy(hackrf_resampler* resampler);
+
+/* Feed length bytes of interleaved I/Q; any length is accepted. */
+extern ADDAPI int ADDCALL hackrf_resampler_execute(hackrf_resampler* resampler,
+		const int8_t* samples, const uint32_t length);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the
+   resampler as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_resampler_rx_callback(hackrf_transfer* transfer);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_RESAMPLER_H__
@@ -0,0 +1,476 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifdef __linux__
+/* fallocate() */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#endif
+
+#include "hackrf_rotate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define rotate_fsync(fd) _commit(fd)
+#define rotate_fileno(f) _fileno(f)
+#else
+#include <unistd.h>
+#define rotate_fsync(fd) fsync(fd)
+#define rotate_fileno(f) fileno(f)
+#endif
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define ROTATE_FILE_BUFFER_SIZE (1048576)
+/* Finished files waiting for the worker to close them. */
+#define ROTATE_MAX_PENDING (8)
+
+typedef struct {
+	FILE* file;
+	hackrf_capture_writer* capture;
+} rotate_file_t;
+
+struct hackrf_rotator {
+	char* prefix;
+	uint64_t file_bytes;
+	bool capture;
+
+	/* RX thread only */
+	rotate_file_t current;
+	uint64_t current_bytes;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;  /* worker has something to do */
+	pthread_cond_t ready; /* next file opened */
+	pthread_t thread;
+	bool running;
+	bool shutdown;
+	rotate_file_t next;
+	uint32_t next_index;
+	rotate_file_t pending[ROTATE_MAX_PENDING];
+	uint32_t pending_count;
+	hackrf_capture_metadata metadata;
+	bool metadata_changed;
+	uint32_t files;
+	uint32_t stalls;
+	uint32_t errors;
+};
+
+static char* rotate_path(const hackrf_rotator* r, const uint32_t index)
+{
+	const size_t length = strlen(r->prefix) + 32;
+	char* path = (char*)malloc(length);
+	if (path != NULL)
+	{
+		snprintf(path, length, "%s_%06u.%s", r->prefix, index,
+				r->capture ? "hrfc" : "bin");
+	}
+	return path;
+}
+
+static bool rotate_open(hackrf_rotator* r, const uint32_t index, rotate_file_t* out)
+{
+	char* path = rotate_path(r, index);
+	rotate_file_t f;
+
+	memset(&f, 0, sizeof(f));
+	if (path == NULL)
+	{
+		return false;
+	}
+	f.file = fopen(path, "wb");
+	free(path);
+	if (f.file == NULL)
+	{
+		return false;
+	}
+	setvbuf(f.file, NULL, _IOFBF, ROTATE_FILE_BUFFER_SIZE);
+
+#ifdef __linux__
+	{
+		/* Reserve the extents up front so the file system does not have to
+		   find space mid-stream. KEEP_SIZE leaves the visible length alone,
+		   so a file cut short by a crash has no zero filled tail. */
+		uint64_t size = r->file_bytes;
+		if (r->capture)
+		{
+			const uint64_t blocks = (r->file_bytes + HACKRF_CAPTURE_DEFAULT_BLOCK_SIZE - 1)
+					/ HACKRF_CAPTURE_DEFAULT_BLOCK_SIZE;
+			size += HACKRF_CAPTURE_HEADER_SIZE + blocks * HACKRF_CAPTURE_BLOCK_HEADER_SIZE;
+		}
+		/* Best effort: not every file system supports it. */
+		(void)fallocate(rotate_fileno(f.file), FALLOC_FL_KEEP_SIZE, 0, (off_t)size);
+	}
+#endif
+
+	if (r->capture
+			&& (hackrf_capture_writer_create(&f.capture, f.file, 0) != HACKRF_SUCCESS))
+	{
+		fclose(f.file);
+		return false;
+	}
+
+	*out = f;
+	return true;
+}
+
+static bool rotate_finalize(rotate_file_t* f)
+{
+	bool ok = true;
+
+	if (f->capture != NULL)
+	{
+		ok = (hackrf_capture_writer_close(f->capture) == HACKRF_SUCCESS);
+	}
+	ok = (fflush(f->file) == 0) && ok;
+	ok = (rotate_fsync(rotate_fileno(f->file)) == 0) && ok;
+	ok = (fclose(f->file) == 0) && ok;
+	memset(f, 0, sizeof(*f));
+	return ok;
+}
+
+static void* rotate_threadproc(void* arg)
+{
+	hackrf_rotator* const r = (hackrf_rotator*)arg;
+	rotate_file_t f;
+	uint32_t index;
+	bool ok;
+
+	pthread_mutex_lock(&r->lock);
+	while (true)
+	{
+		if (r->pending_count > 0)
+		{
+			f = r->pending[0];
+			r->pending_count--;
+			memmove(&r->pending[0], &r->pending[1], r->pending_count * sizeof(rotate_file_t));
+			/* A slot opened up for a waiting RX thread. */
+			pthread_cond_broadcast(&r->ready);
+			pthread_mutex_unlock(&r->lock);
+
+			ok = rotate_finalize(&f);
+
+			pthread_mutex_lock(&r->lock);
+			r->files++;
+			r->errors += ok ? 0 : 1;
+		} else if (r->shutdown) {
+			break;
+		} else if (r->next.file == NULL) {
+			index = r->next_index;
+			pthread_mutex_unlock(&r->lock);
+
+			ok = rotate_open(r, index, &f);
+
+			pthread_mutex_lock(&r->lock);
+			if (ok)
+			{
+				r->next = f;
+				r->next_index++;
+			} else {
+				r->errors++;
+				/* Retry on the next rotation rather than spinning. */
+				pthread_cond_broadcast(&r->ready);
+				pthread_cond_wait(&r->wake, &r->lock);
+			}
+			pthread_cond_broadcast(&r->ready);
+		} else {
+			pthread_cond_wait(&r->wake, &r->lock);
+		}
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	return NULL;
+}
+
+/* Hand the current file to the worker and take the pre-opened one. Runs on
+   the RX thread. */
+static int rotate_next(hackrf_rotator* r)
+{
+	bool stalled = false;
+	uint32_t errors;
+
+	pthread_mutex_lock(&r->lock);
+	if (r->current.file != NULL)
+	{
+		while ((r->pending_count == ROTATE_MAX_PENDING) && !r->shutdown)
+		{
+			stalled = true;
+			pthread_cond_wait(&r->ready, &r->lock);
+		}
+		r->pending[r->pending_count++] = r->current;
+		memset(&r->current, 0, sizeof(r->current));
+	}
+	errors = r->errors;
+	while ((r->next.file == NULL) && (r->errors == errors))
+	{
+		stalled = true;
+		pthread_cond_signal(&r->wake);
+		pthread_cond_wait(&r->ready, &r->lock);
+	}
+	if (r->next.file != NULL)
+	{
+		r->current = r->next;
+		memset(&r->next, 0, sizeof(r->next));
+		r->current_bytes = 0;
+		r->metadata_changed = true;
+	}
+	r->stalls += stalled ? 1 : 0;
+	pthread_cond_signal(&r->wake);
+	pthread_mutex_unlock(&r->lock);
+
+	return (r->current.file != NULL) ? HACKRF_SUCCESS : HACKRF_ERROR_OTHER;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_rotator_create(hackrf_rotator** rotator,
+		const char* path_prefix, const uint64_t file_bytes, const int capture)
+{
+	hackrf_rotator* r;
+
+	if ((rotator == NULL) || (path_prefix == NULL) || (file_bytes == 0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	r = (hackrf_rotator*)calloc(1, sizeof(*r));
+	if (r == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->wake, NULL);
+	pthread_cond_init(&r->ready, NULL);
+
+	/* Even sizes keep I/Q pairs together in each file. */
+	r->file_bytes = (file_bytes + 1) & ~1ULL;
+	r->capture = (capture != 0);
+
+	r->prefix = (char*)malloc(strlen(path_prefix) + 1);
+	if (r->prefix == NULL)
+	{
+		hackrf_rotator_destroy(r);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	strcpy(r->prefix, path_prefix);
+
+	/* The first file is opened here so that open errors surface now. */
+	if (!rotate_open(r, 0, &r->current))
+	{
+		hackrf_rotator_destroy(r);
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	r->next_index = 1;
+
+	if (pthread_create(&r->thread, NULL, rotate_threadproc, r) != 0)
+	{
+		hackrf_rotator_destroy(r);
+		return HACKRF_ERROR_THREAD;
+	}
+	r->running = true;
+
+	*rotator = r;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_rotator_destroy(hackrf_rotator* rotator)
+{
+	hackrf_rotator* const r = rotator;
+	int result = HACKRF_SUCCESS;
+	char* path;
+
+	if (r == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (r->running)
+	{
+		pthread_mutex_lock(&r->lock);
+		r->shutdown = true;
+		pthread_cond_broadcast(&r->wake);
+		pthread_cond_broadcast(&r->ready);
+		pthread_mutex_unlock(&r->lock);
+		pthread_join(r->thread, NULL);
+	}
+
+	if ((r->current.file != NULL) && !rotate_finalize(&r->current))
+	{
+		result = HACKRF_ERROR_OTHER;
+	}
+	if (r->next.file != NULL)
+	{
+		rotate_finalize(&r->next);
+		path = rotate_path(r, r->next_index - 1);
+		if (path != NULL)
+		{
+			remove(path);
+			free(path);
+		}
+	}
+	if ((result == HACKRF_SUCCESS) && (r->errors > 0))
+	{
+		result = HACKRF_ERROR_OTHER;
+	}
+
+	pthread_cond_destroy(&r->ready);
+	pthread_cond_destroy(&r->wake);
+	pthread_mutex_destroy(&r->lock);
+
+	free(r->prefix);
+	free(r);
+
+	return result;
+}
+
+int ADDCALL hackrf_rotator_set_metadata(hackrf_rotator* rotator,
+		const hackrf_capture_metadata* metadata)
+{
+	if ((rotator == NULL) || (metadata == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&rotator->lock);
+	rotator->metadata = *metadata;
+	rotator->metadata_changed = true;
+	pthread_mutex_unlock(&rotator->lock);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_rotator_execute(hackrf_rotator* rotator,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_rotator* const r = rotator;
+	hackrf_capture_metadata metadata;
+	bool metadata_changed;
+	uint32_t pos, n;
+	int result;
+
+	if ((r == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	for (pos = 0; pos < length; pos += n)
+	{
+		if ((r->current.file == NULL) || (r->current_bytes == r->file_bytes))
+		{
+			result = rotate_next(r);
+			if (result != HACKRF_SUCCESS)
+			{
+				return result;
+			}
+		}
+
+		if (r->capture)
+		{
+			pthread_mutex_lock(&r->lock);
+			metadata = r->metadata;
+			metadata_changed = r->metadata_changed;
+			r->metadata_changed = false;
+			pthread_mutex_unlock(&r->lock);
+			if (metadata_changed)
+			{
+				hackrf_capture_writer_set_metadata(r->current.capture, &metadata);
+			}
+		}
+
+		n = length - pos;
+		if (n > (r->file_bytes - r->current_bytes))
+		{
+			n = (uint32_t)(r->file_bytes - r->current_bytes);
+		}
+		if (r->capture)
+		{
+			result = hackrf_capture_writer_write(r->current.capture, &samples[pos], n);
+		} else {
+			result = (fwrite(&samples[pos], 1, n, r->current.file) == n)
+					? HACKRF_SUCCESS : HACKRF_ERROR_OTHER;
+		}
+		if (result != HACKRF_SUCCESS)
+		{
+			pthread_mutex_lock(&r->lock);
+			r->errors++;
+			pthread_mutex_unlock(&r->lock);
+			return result;
+		}
+		r->current_bytes += n;
+	}
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_rotator_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_rotator* const r = (hackrf_rotator*)transfer->rx_ctx;
+	if (hackrf_rotator_execute(r, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int ADDCALL hackrf_rotator_stats(hackrf_rotator* rotator,
+		uint32_t* files, uint32_t* stalls, uint32_t* errors)
+{
+	if (rotator == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&rotator->lock);
+	if (files != NULL)
+	{
+		*files = rotator->files;
+	}
+	if (stalls != NULL)
+	{
+		*stalls = rotator->stalls;
+	}
+	if (errors != NULL)
+	{
+		*errors = rotator->errors;
+	}
+	pthread_mutex_unlock(&rotator->lock);
+
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_ROTATE_H__
+#define __HACKRF_ROTATE_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+#include "hackrf_capture.h"
+
+/*
+ * Continuous recording split across files of a fixed size.
+ *
+ * Samples go to <prefix>_<n>.bin (or .hrfc captures) and roll over to the
+ * next file at an exact byte count, splitting a transfer if needed, so no
+ * sample is lost or duplicated between files. A worker thread keeps the
+ * next file open and preallocated ahead of time and flushes, syncs and
+ * closes finished files, so the RX callback never waits on the file system
+ * at a rotation.
+ */
+
+typedef struct hackrf_rotator hackrf_rotator;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* path_prefix: file name prefix, files are numbered from 0.
+   file_bytes: I/Q bytes per file, rounded up to an even count.
+   capture: non-zero writes .hrfc captures (see hackrf_capture.h). */
+extern ADDAPI int ADDCALL hackrf_rotator_create(hackrf_rotator** rotator,
+		const char* path_prefix, const uint64_t file_bytes, const int capture);
+
+/* Finalizes the current file and removes the unused pre-opened one. */
+extern ADDAPI int ADDCALL hackrf_rotator_destroy(hackrf_rotator* rotator);
+
+/* Metadata for .hrfc captures, applied from the next block on. */
+extern ADDAPI int ADDCALL hackrf_rotator_set_metadata(hackrf_rotator* rotator,
+		const hackrf_capture_metadata* metadata);
+
+extern ADDAPI int ADDCALL hackrf_rotator_execute(hackrf_rotator* rotator,
+		const int8_t* samples, const uint32_t length);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the rotator
+   as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_rotator_rx_callback(hackrf_transfer* transfer);
+
+/* files: files completed. stalls: rotations that had to wait for the next
+   file to be opened. errors: failed opens, writes or closes. */
+extern ADDAPI int ADDCALL hackrf_rotator_stats(hackrf_rotator* rotator,
+		uint32_t* files, uint32_t* stalls, uint32_t* errors);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_ROTATE_H__
@@ -0,0 +1,616 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "hackrf_shm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define SHM_MAGIC (0x4d485348) /* "HSHM" */
+#define SHM_VERSION (2)
+#define SHM_ALIGN (64)
+#define SHM_MAX_SLOT_COUNT (65536)
+#define SHM_POLL_NS (200000)
+
+/* Full barrier; orders the slot counters against the sample data. */
+#if defined(__GNUC__)
+#define shm_barrier() __sync_synchronize()
+#else
+#define shm_barrier()
+#endif
+
+/* Shared layout: header, then slot_count slots of slot_stride bytes, each a
+   slot header followed by the samples. Host byte order; readers run on the
+   same host as the publisher. */
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_size;
+	uint32_t slot_count;
+	uint64_t slot_stride;
+	volatile uint64_t head;          /* blocks published */
+	volatile uint32_t running;
+	volatile uint32_t metadata_seq;  /* odd while metadata is updated */
+	volatile uint64_t generation;    /* newest settings generation */
+	hackrf_capture_metadata metadata;
+	uint8_t reserved[SHM_ALIGN];
+} shm_header_t;
+
+typedef struct {
+	volatile uint64_t seq;
+	uint32_t length;
+	uint32_t reserved0;
+	uint64_t sample_offset;
+	uint64_t timestamp_ns;
+	uint64_t generation;
+	uint8_t reserved[SHM_ALIGN - 40];
+} shm_slot_t;
+
+#define SHM_HEADER_SIZE (((sizeof(shm_header_t) + SHM_ALIGN - 1) / SHM_ALIGN) * SHM_ALIGN)
+
+struct hackrf_shm_publisher {
+	char* name;
+	int fd;
+	uint8_t* base;
+	uint64_t size;
+	shm_header_t* header;
+	uint64_t sample_offset;
+	volatile uint64_t generation_block; /* first block of header->generation */
+	uint64_t slot_generation;           /* stamped on the blocks being written */
+};
+
+struct hackrf_shm_reader {
+	int fd;
+	uint8_t* base;
+	uint64_t size;
+	shm_header_t* header;
+	uint64_t next;
+	volatile uint64_t generation; /* oldest generation delivered */
+	uint64_t received;
+	uint64_t lost;
+};
+
+#ifndef _WIN32
+
+static shm_slot_t* shm_slot(const shm_header_t* header, const uint64_t block)
+{
+	return (shm_slot_t*)((uint8_t*)header + SHM_HEADER_SIZE
+			+ (block % header->slot_count) * header->slot_stride);
+}
+
+static uint64_t shm_time_ns(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000;
+}
+
+/* shm_open() wants a leading slash. */
+static char* shm_name(const char* name)
+{
+	const char* n = (name != NULL) ? name : HACKRF_SHM_DEFAULT_NAME;
+	char* out = (char*)malloc(strlen(n) + 2);
+	if (out != NULL)
+	{
+		out[0] = '/';
+		strcpy(&out[1], (n[0] == '/') ? &n[1] : n);
+	}
+	return out;
+}
+
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef _WIN32
+
+int ADDCALL hackrf_shm_publisher_create(hackrf_shm_publisher** publisher,
+		const char* name, const uint32_t slot_size, const uint32_t slot_count)
+{
+	hackrf_shm_publisher* p;
+	const uint32_t size = (slot_size == 0) ? HACKRF_SHM_DEFAULT_SLOT_SIZE : slot_size;
+	const uint32_t count = (slot_count == 0) ? HACKRF_SHM_DEFAULT_SLOT_COUNT : slot_count;
+	shm_header_t* header;
+	uint64_t stride;
+
+	if ((publisher == NULL) || (count < 2) || (count > SHM_MAX_SLOT_COUNT))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	p = (hackrf_shm_publisher*)calloc(1, sizeof(*p));
+	if (p == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	p->fd = -1;
+	p->name = shm_name(name);
+	if (p->name == NULL)
+	{
+		free(p);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	stride = sizeof(shm_slot_t) + (((uint64_t)size + SHM_ALIGN - 1) / SHM_ALIGN) * SHM_ALIGN;
+	p->size = SHM_HEADER_SIZE + stride * count;
+
+	/* A stale object from a publisher that crashed is replaced. */
+	shm_unlink(p->name);
+	p->fd = shm_open(p->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if ((p->fd < 0) || (ftruncate(p->fd, (off_t)p->size) != 0))
+	{
+		hackrf_shm_publisher_destroy(p);
+		return HACKRF_ERROR_OTHER;
+	}
+	p->base = (uint8_t*)mmap(NULL, (size_t)p->size, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+	if (p->base == (uint8_t*)MAP_FAILED)
+	{
+		p->base = NULL;
+		hackrf_shm_publisher_destroy(p);
+		return HACKRF_ERROR_OTHER;
+	}
+
+	/* ftruncate() zero fills, so every slot starts with seq 0: empty. */
+	header = (shm_header_t*)p->base;
+	header->slot_size = size;
+	header->slot_count = count;
+	header->slot_stride = stride;
+	header->head = 0;
+	header->running = 1;
+	header->version = SHM_VERSION;
+	shm_barrier();
+	header->magic = SHM_MAGIC;
+	p->header = header;
+
+	*publisher = p;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_publisher_destroy(hackrf_shm_publisher* publisher)
+{
+	if (publisher == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (publisher->header != NULL)
+	{
+		publisher->header->running = 0;
+		shm_barrier();
+	}
+	if (publisher->base != NULL)
+	{
+		munmap(publisher->base, (size_t)publisher->size);
+	}
+	if (publisher->fd >= 0)
+	{
+		close(publisher->fd);
+		shm_unlink(publisher->name);
+	}
+	free(publisher->name);
+	free(publisher);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_publisher_set_metadata(hackrf_shm_publisher* publisher,
+		const hackrf_capture_metadata* metadata)
+{
+	shm_header_t* header;
+
+	if ((publisher == NULL) || (metadata == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	header = publisher->header;
+	header->metadata_seq++;
+	shm_barrier();
+	header->metadata = *metadata;
+	shm_barrier();
+	header->metadata_seq++;
+
+	return HACKRF_SUCCESS;
+}
+
+/* Runs on the caller's thread while the publisher writes on another; the
+   block number goes out before the generation so that a writer seeing the
+   new generation also sees where it starts. */
+int ADDCALL hackrf_shm_publisher_new_generation(hackrf_shm_publisher* publisher,
+		const uint32_t drain_blocks)
+{
+	shm_header_t* header;
+
+	if (publisher == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	header = publisher->header;
+	publisher->generation_block = header->head + drain_blocks;
+	shm_barrier();
+	header->generation++;
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_publisher_write(hackrf_shm_publisher* publisher,
+		const int8_t* samples, const uint32_t length)
+{
+	shm_header_t* header;
+	shm_slot_t* slot;
+	uint64_t block, generation;
+
+	if ((publisher == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	header = publisher->header;
+	if (length > header->slot_size)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	block = header->head;
+	slot = shm_slot(header, block);
+	generation = header->generation;
+	shm_barrier();
+	if ((generation > publisher->slot_generation) && (block >= publisher->generation_block))
+	{
+		publisher->slot_generation = generation;
+	}
+
+	slot->seq = 2 * block + 1;
+	shm_barrier();
+	memcpy((uint8_t*)slot + sizeof(shm_slot_t), samples, length);
+	slot->length = length;
+	slot->sample_offset = publisher->sample_offset;
+	slot->timestamp_ns = shm_time_ns();
+	slot->generation = publisher->slot_generation;
+	shm_barrier();
+	slot->seq = 2 * block + 2;
+	shm_barrier();
+	header->head = block + 1;
+
+	publisher->sample_offset += length / 2;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_publisher_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_shm_publisher* const p = (hackrf_shm_publisher*)transfer->rx_ctx;
+	if (hackrf_shm_publisher_write(p, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int ADDCALL hackrf_shm_reader_open(hackrf_shm_reader** reader, const char* name)
+{
+	hackrf_shm_reader* r;
+	shm_header_t header;
+	struct stat st;
+	char* path;
+
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	path = shm_name(name);
+	if (path == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	r = (hackrf_shm_reader*)calloc(1, sizeof(*r));
+	if (r == NULL)
+	{
+		free(path);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	r->fd = shm_open(path, O_RDONLY, 0);
+	free(path);
+	if (r->fd < 0)
+	{
+		free(r);
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+	if ((fstat(r->fd, &st) != 0) || ((uint64_t)st.st_size < SHM_HEADER_SIZE)
+			|| (pread(r->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+			|| (header.magic != SHM_MAGIC) || (header.version != SHM_VERSION)
+			|| ((SHM_HEADER_SIZE + header.slot_stride * header.slot_count) > (uint64_t)st.st_size))
+	{
+		close(r->fd);
+		free(r);
+		return HACKRF_ERROR_NOT_FOUND;
+	}
+
+	r->size = (uint64_t)st.st_size;
+	r->base = (uint8_t*)mmap(NULL, (size_t)r->size, PROT_READ, MAP_SHARED, r->fd, 0);
+	if (r->base == (uint8_t*)MAP_FAILED)
+	{
+		close(r->fd);
+		free(r);
+		return HACKRF_ERROR_OTHER;
+	}
+	r->header = (shm_header_t*)r->base;
+	r->next = r->header->head;
+	r->generation = r->header->generation;
+
+	*reader = r;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_reader_close(hackrf_shm_reader* reader)
+{
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	munmap(reader->base, (size_t)reader->size);
+	close(reader->fd);
+	free(reader);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_reader_next(hackrf_shm_reader* reader,
+		hackrf_shm_block* block, const uint32_t timeout_ms)
+{
+	hackrf_shm_reader* const r = reader;
+	const struct timespec poll_interval = { 0, SHM_POLL_NS };
+	uint64_t waited_ns = 0;
+	uint64_t head, lost = 0;
+	shm_slot_t* slot;
+
+	if ((r == NULL) || (block == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	while (true)
+	{
+		head = r->header->head;
+		shm_barrier();
+
+		if (r->next >= head)
+		{
+			if (!r->header->running)
+			{
+				r->lost += lost;
+				return HACKRF_ERROR_STREAMING_STOPPED;
+			}
+			if (waited_ns >= (uint64_t)timeout_ms * 1000000ULL)
+			{
+				r->lost += lost;
+				return HACKRF_ERROR_NOT_FOUND;
+			}
+			nanosleep(&poll_interval, NULL);
+			waited_ns += SHM_POLL_NS;
+			continue;
+		}
+
+		if ((head - r->next) >= r->header->slot_count)
+		{
+			/* Lapped: everything up to the newest block is gone or about
+			   to be. */
+			lost += head - 1 - r->next;
+			r->next = head - 1;
+		}
+
+		slot = shm_slot(r->header, r->next);
+		block->sequence = r->next;
+		block->samples = (const int8_t*)((uint8_t*)slot + sizeof(shm_slot_t));
+		block->length = slot->length;
+		block->sample_offset = slot->sample_offset;
+		block->timestamp_ns = slot->timestamp_ns;
+		block->generation = slot->generation;
+		shm_barrier();
+		if (slot->seq != (2 * r->next + 2))
+		{
+			/* Overwritten between reading head and the slot. */
+			lost++;
+			r->next++;
+			continue;
+		}
+		if (block->generation < r->generation)
+		{
+			/* Captured before the settings the reader synced to. */
+			r->next++;
+			continue;
+		}
+
+		block->lost = lost;
+		r->lost += lost;
+		r->next++;
+		return HACKRF_SUCCESS;
+	}
+}
+
+int ADDCALL hackrf_shm_reader_release(hackrf_shm_reader* reader,
+		const hackrf_shm_block* block)
+{
+	if ((reader == NULL) || (block == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	shm_barrier();
+	if (shm_slot(reader->header, block->sequence)->seq != (2 * block->sequence + 2))
+	{
+		reader->lost++;
+		return HACKRF_ERROR_BUSY;
+	}
+	reader->received++;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_reader_sync(hackrf_shm_reader* reader)
+{
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	reader->generation = reader->header->generation;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_reader_metadata(hackrf_shm_reader* reader,
+		hackrf_capture_metadata* metadata)
+{
+	uint32_t seq;
+
+	if ((reader == NULL) || (metadata == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	do {
+		seq = reader->header->metadata_seq;
+		shm_barrier();
+		*metadata = reader->header->metadata;
+		shm_barrier();
+	} while (((seq & 1) != 0) || (seq != reader->header->metadata_seq));
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_shm_reader_stats(hackrf_shm_reader* reader,
+		uint64_t* received, uint64_t* lost)
+{
+	if (reader == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (received != NULL)
+	{
+		*received = reader->received;
+	}
+	if (lost != NULL)
+	{
+		*lost = reader->lost;
+	}
+	return HACKRF_SUCCESS;
+}
+
+#else /* _WIN32 */
+
+int ADDCALL hackrf_shm_publisher_create(hackrf_shm_publisher** publisher,
+		const char* name, const uint32_t slot_size, const uint32_t slot_count)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_publisher_destroy(hackrf_shm_publisher* publisher)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_publisher_set_metadata(hackrf_shm_publisher* publisher,
+		const hackrf_capture_metadata* metadata)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_publisher_write(hackrf_shm_publisher* publisher,
+		const int8_t* samples, const uint32_t length)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_publisher_new_generation(hackrf_shm_publisher* publisher,
+		const uint32_t drain_blocks)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_publisher_rx_callback(hackrf_transfer* transfer)
+{
+	return -1;
+}
+
+int ADDCALL hackrf_shm_reader_open(hackrf_shm_reader** reader, const char* name)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_close(hackrf_shm_reader* reader)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_next(hackrf_shm_reader* reader,
+		hackrf_shm_block* block, const uint32_t timeout_ms)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_release(hackrf_shm_reader* reader,
+		const hackrf_shm_block* block)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_sync(hackrf_shm_reader* reader)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_metadata(hackrf_shm_reader* reader,
+		hackrf_capture_metadata* metadata)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_shm_reader_stats(hackrf_shm_reader* reader,
+		uint64_t* received, uint64_t* lost)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+#endif /* _WIN32 */
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_SHM_H__
+#define __HACKRF_SHM_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+#include "hackrf_capture.h"
+
+/*
+ * Single producer, many consumer RX fan-out through POSIX shared memory.
+ *
+ * The process that owns the device publishes each block into a ring of
+ * fixed size slots in a named shared memory object. Any number of local
+ * processes attach read only and get a pointer straight into the ring, so
+ * adding a consumer costs no copies and takes no locks: every slot has a
+ * sequence counter that the publisher makes odd while writing and sets to
+ * 2 * (block + 1) once the block is complete. A reader checks the counter
+ * before and after using a block to learn whether the publisher lapped it.
+ *
+ * Every slot also carries the settings generation it was captured under.
+ * The publisher starts a new generation after a retune, but only stamps it
+ * on blocks once the transfers that were already in flight have drained,
+ * so a reader that syncs to the new generation never sees samples taken
+ * with the old settings.
+ *
+ * Not available on Windows; every call returns HACKRF_ERROR_OTHER there.
+ */
+
+#define HACKRF_SHM_DEFAULT_NAME "/hackrf"
+#define HACKRF_SHM_DEFAULT_SLOT_SIZE (262144)
+#define HACKRF_SHM_DEFAULT_SLOT_COUNT (64)
+
+typedef struct hackrf_shm_publisher hackrf_shm_publisher;
+typedef struct hackrf_shm_reader hackrf_shm_reader;
+
+typedef struct {
+	const int8_t* samples; /* points into shared memory, valid until released */
+	uint32_t length;
+	uint64_t sequence;      /* block number since the publisher started */
+	uint64_t sample_offset;
+	uint64_t timestamp_ns;  /* host time the block was published */
+	uint64_t lost;          /* blocks skipped since the previous one */
+	uint64_t generation;    /* settings generation the block was captured under */
+} hackrf_shm_block;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* name: shared memory object name, NULL selects HACKRF_SHM_DEFAULT_NAME.
+   slot_size: largest block in bytes, 0 selects the default.
+   slot_count: ring length, 0 selects the default. */
+extern ADDAPI int ADDCALL hackrf_shm_publisher_create(hackrf_shm_publisher** publisher,
+		const char* name, const uint32_t slot_size, const uint32_t slot_count);
+
+/* Marks the stream stopped and unlinks the name. Attached readers keep
+   their mapping until they close. */
+extern ADDAPI int ADDCALL hackrf_shm_publisher_destroy(hackrf_shm_publisher* publisher);
+
+/* Stream settings shown to readers; sample_offset, timestamp_ns and length
+   are ignored. */
+extern ADDAPI int ADDCALL hackrf_shm_publisher_set_metadata(hackrf_shm_publisher* publisher,
+		const hackrf_capture_metadata* metadata);
+
+extern ADDAPI int ADDCALL hackrf_shm_publisher_write(hackrf_shm_publisher* publisher,
+		const int8_t* samples, const uint32_t length);
+
+/* Call once a settings change has taken effect on the device. Readers
+   that sync afterwards skip every block published before drain_blocks
+   more have been written, i.e. the device's transfers in flight. */
+extern ADDAPI int ADDCALL hackrf_shm_publisher_new_generation(hackrf_shm_publisher* publisher,
+		const uint32_t drain_blocks);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the
+   publisher as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_shm_publisher_rx_callback(hackrf_transfer* transfer);
+
+/* Starts at the next block to be published, synced to the current
+   generation. */
+extern ADDAPI int ADDCALL hackrf_shm_reader_open(hackrf_shm_reader** reader, const char* name);
+extern ADDAPI int ADDCALL hackrf_shm_reader_close(hackrf_shm_reader* reader);
+
+/* Wait up to timeout_ms for the next block. A reader that has fallen a
+   whole ring behind skips to the newest block and reports the gap in
+   block->lost. Returns HACKRF_ERROR_NOT_FOUND on timeout and
+   HACKRF_ERROR_STREAMING_STOPPED once the publisher has gone. */
+extern ADDAPI int ADDCALL hackrf_shm_reader_next(hackrf_shm_reader* reader,
+		hackrf_shm_block* block, const uint32_t timeout_ms);
+
+/* Finish with a block from hackrf_shm_reader_next(). Returns
+   HACKRF_ERROR_BUSY if the publisher overwrote it while it was in use, in
+   which case the samples read from it must be discarded. */
+extern ADDAPI int ADDCALL hackrf_shm_reader_release(hackrf_shm_reader* reader,
+		const hackrf_shm_block* block);
+
+/* Skip blocks from settings generations older than the current one, from
+   now on. Call after a settings change has been acknowledged. */
+extern ADDAPI int ADDCALL hackrf_shm_reader_sync(hackrf_shm_reader* reader);
+
+extern ADDAPI int ADDCALL hackrf_shm_reader_metadata(hackrf_shm_reader* reader,
+		hackrf_capture_metadata* metadata);
+
+/* received: blocks released intact. lost: blocks skipped or overwritten. */
+extern ADDAPI int ADDCALL hackrf_shm_reader_stats(hackrf_shm_reader* reader,
+		uint64_t* received, uint64_t* lost);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_SHM_H__
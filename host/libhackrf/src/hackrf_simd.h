@@ -0,0 +1,222 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Internal SIMD kernels shared by the libhackrf DSP blocks. Not installed. */
+
+#ifndef __HACKRF_SIMD_H__
+#define __HACKRF_SIMD_H__
+
+#include <stdint.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define HACKRF_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define HACKRF_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define HACKRF_INLINE static __inline
+#else
+#define HACKRF_INLINE static __inline__
+#endif
+
+/* acc[i] += a[i] * b[i] */
+HACKRF_INLINE void simd_mac(float* acc, const float* a, const float* b,
+		const uint32_t length)
+{
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE
+	for (; (i + 4) <= length; i += 4)
+	{
+		const __m128 p = _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i]));
+		_mm_storeu_ps(&acc[i], _mm_add_ps(_mm_loadu_ps(&acc[i]), p));
+	}
+#endif
+	for (; i < length; i++)
+	{
+		acc[i] += a[i] * b[i];
+	}
+}
+
+/* Convert HackRF signed 8 bit samples to float, scaled to [-1.0, 1.0). */
+HACKRF_INLINE void simd_s8_to_f32(float* out, const int8_t* in,
+		const uint32_t length)
+{
+	const float scale = 1.0f / 128.0f;
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE2
+	const __m128 vscale = _mm_set1_ps(scale);
+	for (; (i + 16) <= length; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)&in[i]);
+		/* Sign extend 8 -> 16 -> 32 bits by duplicating and shifting. */
+		const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+		_mm_storeu_ps(&out[i + 0], _mm_mul_ps(vscale,
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16))));
+		_mm_storeu_ps(&out[i + 4], _mm_mul_ps(vscale,
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16))));
+		_mm_storeu_ps(&out[i + 8], _mm_mul_ps(vscale,
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16))));
+		_mm_storeu_ps(&out[i + 12], _mm_mul_ps(vscale,
+			_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16))));
+	}
+#endif
+	for (; i < length; i++)
+	{
+		out[i] = in[i] * scale;
+	}
+}
+
+/* Dot product of real taps (each duplicated for I and Q) with interleaved
+   I/Q, length complex samples. Returns the complex sum in *i and *q. */
+HACKRF_INLINE void simd_dot_iq(float* i_out, float* q_out, const float* taps,
+		const float* x, const uint32_t length)
+{
+	float acc_i = 0.0f;
+	float acc_q = 0.0f;
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	float lanes[4];
+	for (; (i + 4) <= length; i += 4)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&taps[2*i]), _mm_loadu_ps(&x[2*i])));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&taps[2*i+4]), _mm_loadu_ps(&x[2*i+4])));
+	}
+	_mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+	acc_i = lanes[0] + lanes[2];
+	acc_q = lanes[1] + lanes[3];
+#endif
+	for (; i < length; i++)
+	{
+		acc_i += taps[2*i] * x[2*i];
+		acc_q += taps[2*i+1] * x[2*i+1];
+	}
+	*i_out = acc_i;
+	*q_out = acc_q;
+}
+
+/* In place complex multiply of HackRF interleaved signed 8 bit I/Q by
+   interleaved float phasors, count complex samples. Rounds and saturates. */
+HACKRF_INLINE void simd_cmul_s8(int8_t* buf, const float* phasor,
+		const uint32_t count)
+{
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE2
+	const __m128 sign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+	for (; (i + 4) <= count; i += 4)
+	{
+		const __m128i v = _mm_loadl_epi64((const __m128i*)&buf[2*i]);
+		const __m128i w = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		const __m128 a0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16));
+		const __m128 a1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16));
+		const __m128 p0 = _mm_loadu_ps(&phasor[2*i]);
+		const __m128 p1 = _mm_loadu_ps(&phasor[2*i+4]);
+		/* (ar + j ai)(pr + j pi) = (ar pr - ai pi) + j (ai pr + ar pi) */
+		const __m128 r0 = _mm_add_ps(
+			_mm_mul_ps(a0, _mm_shuffle_ps(p0, p0, _MM_SHUFFLE(2, 2, 0, 0))),
+			_mm_mul_ps(sign, _mm_mul_ps(_mm_shuffle_ps(a0, a0, _MM_SHUFFLE(2, 3, 0, 1)),
+				_mm_shuffle_ps(p0, p0, _MM_SHUFFLE(3, 3, 1, 1)))));
+		const __m128 r1 = _mm_add_ps(
+			_mm_mul_ps(a1, _mm_shuffle_ps(p1, p1, _MM_SHUFFLE(2, 2, 0, 0))),
+			_mm_mul_ps(sign, _mm_mul_ps(_mm_shuffle_ps(a1, a1, _MM_SHUFFLE(2, 3, 0, 1)),
+				_mm_shuffle_ps(p1, p1, _MM_SHUFFLE(3, 3, 1, 1)))));
+		const __m128i s16 = _mm_packs_epi32(_mm_cvtps_epi32(r0), _mm_cvtps_epi32(r1));
+		_mm_storel_epi64((__m128i*)&buf[2*i], _mm_packs_epi16(s16, s16));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float ar = buf[2*i];
+		const float ai = buf[2*i+1];
+		const float r = ar * phasor[2*i] - ai * phasor[2*i+1];
+		const float q = ai * phasor[2*i] + ar * phasor[2*i+1];
+		const long lr = (long)((r < 0.0f) ? (r - 0.5f) : (r + 0.5f));
+		const long lq = (long)((q < 0.0f) ? (q - 0.5f) : (q + 0.5f));
+		buf[2*i] = (int8_t)((lr > 127) ? 127 : ((lr < -128) ? -128 : lr));
+		buf[2*i+1] = (int8_t)((lq > 127) ? 127 : ((lq < -128) ? -128 : lq));
+	}
+}
+
+/* Convert float I/Q in [-1.0, 1.0) back to HackRF signed 8 bit samples,
+   rounding and saturating. */
+HACKRF_INLINE void simd_f32_to_s8(int8_t* out, const float* in,
+		const uint32_t length)
+{
+	const float scale = 128.0f;
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE2
+	const __m128 vscale = _mm_set1_ps(scale);
+	for (; (i + 8) <= length; i += 8)
+	{
+		const __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(vscale, _mm_loadu_ps(&in[i])));
+		const __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(vscale, _mm_loadu_ps(&in[i + 4])));
+		const __m128i s16 = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i*)&out[i], _mm_packs_epi16(s16, s16));
+	}
+#endif
+	for (; i < length; i++)
+	{
+		const float v = in[i] * scale;
+		const long l = (long)((v < 0.0f) ? (v - 0.5f) : (v + 0.5f));
+		out[i] = (int8_t)((l > 127) ? 127 : ((l < -128) ? -128 : l));
+	}
+}
+
+/* Sum of squares of HackRF signed 8 bit samples (I^2 + Q^2 over I/Q pairs). */
+HACKRF_INLINE uint64_t simd_power_s8(const int8_t* in, const uint32_t length)
+{
+	uint64_t total = 0;
+	uint32_t i = 0;
+#ifdef HACKRF_SIMD_SSE2
+	while ((i + 16) <= length)
+	{
+		/* Each lane grows by at most 2 * 2 * 128^2 per step; flush well
+		   before 32 bits overflow. */
+		__m128i acc = _mm_setzero_si128();
+		uint32_t steps = 0;
+		uint32_t lanes[4];
+		for (; ((i + 16) <= length) && (steps < 8192); i += 16, steps++)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i*)&in[i]);
+			const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+			const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+		}
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		total += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#endif
+	for (; i < length; i++)
+	{
+		total += (uint32_t)(in[i] * in[i]);
+	}
+	return total;
+}
+
+#endif//__HACKRF_SIMD_H__
@@ -0,0 +1,418 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "hackrf_trigger.h"
+#include "hackrf_simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#define TRIGGER_DEFAULT_WINDOW_SAMPLES (1024)
+#define TRIGGER_MAX_WINDOW_SAMPLES (1048576)
+/* Ring space beyond pre + post that absorbs writer latency. */
+#define TRIGGER_MIN_SLACK_BYTES (16777216)
+#define TRIGGER_WRITE_CHUNK (1048576)
+#define TRIGGER_FILE_BUFFER_SIZE (1048576)
+
+struct hackrf_trigger {
+	char* prefix;
+	uint64_t pre_bytes;
+	uint64_t post_bytes;
+	uint32_t window_bytes;
+	uint64_t threshold_sum; /* per window, in squared 8 bit units */
+
+	int8_t* ring;
+	uint64_t capacity;
+
+	/* RX thread only */
+	uint64_t window_fill;
+	uint64_t window_sum;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_t thread;
+	bool running;
+	uint64_t written;      /* absolute bytes appended to the ring */
+	uint32_t max_length;   /* largest block seen, may be mid-copy */
+	bool active;           /* an event is being captured */
+	uint64_t trigger_pos;  /* absolute position of the event */
+	uint32_t events;
+	uint32_t overruns;
+	uint64_t peak_sum;
+	bool shutdown;
+};
+
+/* True while [from, to) has not been overwritten. Lock held. */
+static bool trigger_valid(const hackrf_trigger* t, const uint64_t from)
+{
+	return (t->written + t->max_length) <= (from + t->capacity);
+}
+
+static bool trigger_write_range(hackrf_trigger* t, FILE* file,
+		uint64_t from, const uint64_t to)
+{
+	bool ok = true;
+
+	while (ok && (from < to))
+	{
+		const uint64_t offset = from % t->capacity;
+		uint64_t n = to - from;
+		if (n > (t->capacity - offset))
+		{
+			n = t->capacity - offset;
+		}
+		if (n > TRIGGER_WRITE_CHUNK)
+		{
+			n = TRIGGER_WRITE_CHUNK;
+		}
+
+		pthread_mutex_lock(&t->lock);
+		ok = trigger_valid(t, from);
+		pthread_mutex_unlock(&t->lock);
+
+		if (ok)
+		{
+			ok = (fwrite(&t->ring[offset], 1, (size_t)n, file) == n);
+		}
+
+		/* The RX thread may have lapped us during the write. */
+		pthread_mutex_lock(&t->lock);
+		ok = ok && trigger_valid(t, from);
+		pthread_mutex_unlock(&t->lock);
+
+		from += n;
+	}
+
+	return ok;
+}
+
+static FILE* trigger_open(hackrf_trigger* t, const uint32_t event, const char* suffix)
+{
+	const size_t length = strlen(t->prefix) + 32;
+	char* path = (char*)malloc(length);
+	FILE* file = NULL;
+
+	if (path != NULL)
+	{
+		snprintf(path, length, "%s_%04u_%s.bin", t->prefix, event, suffix);
+		file = fopen(path, "wb");
+		if (file != NULL)
+		{
+			setvbuf(file, NULL, _IOFBF, TRIGGER_FILE_BUFFER_SIZE);
+		}
+		free(path);
+	}
+	return file;
+}
+
+static void* trigger_threadproc(void* arg)
+{
+	hackrf_trigger* const t = (hackrf_trigger*)arg;
+	uint64_t trigger_pos, pre_start, pos, end, available;
+	uint32_t event;
+	FILE* file;
+	bool ok, stop;
+
+	pthread_mutex_lock(&t->lock);
+	while (true)
+	{
+		while (!t->active && !t->shutdown)
+		{
+			pthread_cond_wait(&t->wake, &t->lock);
+		}
+		if (!t->active)
+		{
+			break;
+		}
+		trigger_pos = t->trigger_pos;
+		event = t->events + t->overruns;
+		pthread_mutex_unlock(&t->lock);
+
+		/* Pre-trigger window, already complete in the ring. */
+		pre_start = (trigger_pos > t->pre_bytes) ? (trigger_pos - t->pre_bytes) : 0;
+		file = trigger_open(t, event, "pre");
+		ok = (file != NULL);
+		if (ok)
+		{
+			ok = trigger_write_range(t, file, pre_start, trigger_pos);
+			ok = (fclose(file) == 0) && ok;
+		}
+
+		/* Post-trigger window, followed as it arrives. */
+		file = ok ? trigger_open(t, event, "post") : NULL;
+		ok = ok && (file != NULL);
+		pos = trigger_pos;
+		end = trigger_pos + t->post_bytes;
+		while (ok && (pos < end))
+		{
+			pthread_mutex_lock(&t->lock);
+			while ((t->written <= pos) && !t->shutdown)
+			{
+				pthread_cond_wait(&t->wake, &t->lock);
+			}
+			available = (t->written < end) ? t->written : end;
+			stop = (t->written <= pos);
+			pthread_mutex_unlock(&t->lock);
+
+			if (stop)
+			{
+				break;
+			}
+			ok = trigger_write_range(t, file, pos, available);
+			pos = available;
+		}
+		if (file != NULL)
+		{
+			ok = (fclose(file) == 0) && ok;
+		}
+
+		pthread_mutex_lock(&t->lock);
+		if (ok)
+		{
+			t->events++;
+		} else {
+			t->overruns++;
+		}
+		t->active = false;
+	}
+	pthread_mutex_unlock(&t->lock);
+
+	return NULL;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int ADDCALL hackrf_trigger_create(hackrf_trigger** trigger,
+		const char* path_prefix, const uint64_t pre_bytes, const uint64_t post_bytes,
+		const float threshold, const uint32_t window_samples)
+{
+	hackrf_trigger* t;
+	const uint32_t samples = (window_samples == 0) ? TRIGGER_DEFAULT_WINDOW_SAMPLES : window_samples;
+	uint64_t slack;
+
+	if ((trigger == NULL) || (path_prefix == NULL) || (threshold < 0.0f)
+			|| (samples > TRIGGER_MAX_WINDOW_SAMPLES) || (post_bytes == 0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	t = (hackrf_trigger*)calloc(1, sizeof(*t));
+	if (t == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->wake, NULL);
+
+	/* Even sizes keep I/Q pairs together in the files. */
+	t->pre_bytes = pre_bytes & ~1ULL;
+	t->post_bytes = (post_bytes + 1) & ~1ULL;
+	t->window_bytes = 2 * samples;
+	t->threshold_sum = (uint64_t)((double)threshold * 128.0 * 128.0 * samples);
+
+	slack = t->pre_bytes / 2;
+	if (slack < TRIGGER_MIN_SLACK_BYTES)
+	{
+		slack = TRIGGER_MIN_SLACK_BYTES;
+	}
+	t->capacity = t->pre_bytes + t->post_bytes + slack;
+
+	t->prefix = (char*)malloc(strlen(path_prefix) + 1);
+	t->ring = ((size_t)t->capacity == t->capacity) ? (int8_t*)malloc((size_t)t->capacity) : NULL;
+	if ((t->prefix == NULL) || (t->ring == NULL))
+	{
+		hackrf_trigger_destroy(t);
+		return HACKRF_ERROR_NO_MEM;
+	}
+	strcpy(t->prefix, path_prefix);
+
+	if (pthread_create(&t->thread, NULL, trigger_threadproc, t) != 0)
+	{
+		hackrf_trigger_destroy(t);
+		return HACKRF_ERROR_THREAD;
+	}
+	t->running = true;
+
+	*trigger = t;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_trigger_destroy(hackrf_trigger* trigger)
+{
+	if (trigger == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	if (trigger->running)
+	{
+		pthread_mutex_lock(&trigger->lock);
+		trigger->shutdown = true;
+		pthread_cond_broadcast(&trigger->wake);
+		pthread_mutex_unlock(&trigger->lock);
+		pthread_join(trigger->thread, NULL);
+	}
+	pthread_cond_destroy(&trigger->wake);
+	pthread_mutex_destroy(&trigger->lock);
+
+	free(trigger->ring);
+	free(trigger->prefix);
+	free(trigger);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_trigger_execute(hackrf_trigger* trigger,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_trigger* const t = trigger;
+	uint64_t start, offset, first;
+	uint64_t trigger_pos = 0;
+	uint64_t peak_sum = 0;
+	bool triggered = false;
+	uint32_t pos, n;
+
+	if ((t == NULL) || ((samples == NULL) && (length > 0)))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (length > t->capacity)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&t->lock);
+	start = t->written;
+	if (length > t->max_length)
+	{
+		t->max_length = length;
+	}
+	pthread_mutex_unlock(&t->lock);
+
+	/* Append to the ring. */
+	offset = start % t->capacity;
+	first = t->capacity - offset;
+	if (first > length)
+	{
+		first = length;
+	}
+	memcpy(&t->ring[offset], samples, (size_t)first);
+	memcpy(t->ring, &samples[first], (size_t)(length - first));
+
+	/* Detection windows run continuously across blocks. */
+	for (pos = 0; pos < length; pos += n)
+	{
+		n = t->window_bytes - (uint32_t)t->window_fill;
+		if (n > (length - pos))
+		{
+			n = length - pos;
+		}
+		t->window_sum += simd_power_s8(&samples[pos], n);
+		t->window_fill += n;
+
+		if (t->window_fill == t->window_bytes)
+		{
+			if (t->window_sum > peak_sum)
+			{
+				peak_sum = t->window_sum;
+			}
+			if (!triggered && (t->window_sum >= t->threshold_sum))
+			{
+				triggered = true;
+				trigger_pos = start + pos + n - t->window_bytes;
+			}
+			t->window_sum = 0;
+			t->window_fill = 0;
+		}
+	}
+
+	pthread_mutex_lock(&t->lock);
+	t->written = start + length;
+	if (peak_sum > t->peak_sum)
+	{
+		t->peak_sum = peak_sum;
+	}
+	if (triggered && !t->active)
+	{
+		t->active = true;
+		t->trigger_pos = trigger_pos;
+	}
+	if (t->active)
+	{
+		pthread_cond_signal(&t->wake);
+	}
+	pthread_mutex_unlock(&t->lock);
+
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_trigger_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_trigger* const t = (hackrf_trigger*)transfer->rx_ctx;
+	if (hackrf_trigger_execute(t, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int ADDCALL hackrf_trigger_stats(hackrf_trigger* trigger,
+		uint32_t* events, uint32_t* overruns, float* peak)
+{
+	if (trigger == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&trigger->lock);
+	if (events != NULL)
+	{
+		*events = trigger->events;
+	}
+	if (overruns != NULL)
+	{
+		*overruns = trigger->overruns;
+	}
+	if (peak != NULL)
+	{
+		*peak = (float)((double)trigger->peak_sum / (128.0 * 128.0 * (trigger->window_bytes / 2)));
+	}
+	pthread_mutex_unlock(&trigger->lock);
+
+	return HACKRF_SUCCESS;
+}
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
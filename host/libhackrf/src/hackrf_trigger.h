@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_TRIGGER_H__
+#define __HACKRF_TRIGGER_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+
+/*
+ * Triggered capture of burst signals.
+ *
+ * RX samples are kept in a memory ring covering at least the pre-trigger
+ * window. The mean power of every detection window is compared against a
+ * threshold; on a trigger the pre-trigger window and the following
+ * post-trigger window are written to <prefix>_<n>_pre.bin and
+ * <prefix>_<n>_post.bin by a writer thread, so the RX callback only copies
+ * and measures. Triggers are ignored while an event is still being captured.
+ */
+
+typedef struct hackrf_trigger hackrf_trigger;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* path_prefix: file name prefix for captured events.
+   pre_bytes, post_bytes: window sizes in bytes of interleaved I/Q.
+   threshold: mean I^2 + Q^2 per sample, full scale 1.0.
+   window_samples: detection granularity, 0 selects 1024. */
+extern ADDAPI int ADDCALL hackrf_trigger_create(hackrf_trigger** trigger,
+		const char* path_prefix, const uint64_t pre_bytes, const uint64_t post_bytes,
+		const float threshold, const uint32_t window_samples);
+
+/* Finishes writing the event in progress, if any. */
+extern ADDAPI int ADDCALL hackrf_trigger_destroy(hackrf_trigger* trigger);
+
+extern ADDAPI int ADDCALL hackrf_trigger_execute(hackrf_trigger* trigger,
+		const int8_t* samples, const uint32_t length);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the trigger
+   as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_trigger_rx_callback(hackrf_transfer* transfer);
+
+/* events: captures completed. overruns: captures cut short because the
+   writer fell behind the ring or a write failed. peak: highest window
+   power seen. */
+extern ADDAPI int ADDCALL hackrf_trigger_stats(hackrf_trigger* trigger,
+		uint32_t* events, uint32_t* overruns, float* peak);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_TRIGGER_H__
@@ -0,0 +1,809 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifdef __linux__
+/* sendmmsg(), recvmmsg() */
+#define _GNU_SOURCE
+#endif
+
+#include "hackrf_udp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+/* Datagrams per sendmmsg()/recvmmsg() call. */
+#define UDP_BATCH (64)
+#define UDP_MAX_DATAGRAM (HACKRF_UDP_HEADER_SIZE + HACKRF_UDP_MAX_PAYLOAD)
+#define UDP_SOCKET_BUFFER (8 * 1024 * 1024)
+/* Sequence numbers this far behind mean the sender restarted, not that a
+   datagram was reordered. */
+#define UDP_RESYNC_GAP (4096)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef _WIN32
+
+typedef struct {
+	uint32_t sequence;
+	uint32_t block;
+	uint32_t block_length;
+	uint32_t offset;
+	uint8_t format;
+	uint64_t sample_offset;
+	uint64_t timestamp_ns;
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+} udp_header_t;
+
+struct hackrf_udp_sender {
+	int fd;
+	struct sockaddr_in destination;
+	uint32_t payload_size;
+	uint32_t sequence;
+	uint32_t block;
+	uint64_t sample_offset;
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+	uint8_t headers[UDP_BATCH][HACKRF_UDP_HEADER_SIZE];
+	struct iovec iov[UDP_BATCH][2];
+#ifdef __linux__
+	struct mmsghdr msgs[UDP_BATCH];
+#else
+	struct msghdr msgs[UDP_BATCH];
+#endif
+	uint64_t datagrams;
+	uint64_t bytes;
+	uint64_t errors;
+};
+
+struct hackrf_udp_receiver {
+	int fd;
+
+	/* Datagrams from the last receive, consumed from cursor. */
+	uint8_t* batch;
+	uint32_t lengths[UDP_BATCH];
+	uint32_t count;
+	uint32_t cursor;
+
+	/* Block under reassembly. */
+	uint8_t* buffer;
+	uint32_t capacity;
+	bool pending;
+	udp_header_t current;
+	uint32_t received;
+
+	bool have_sequence;
+	uint32_t expected;
+
+	uint64_t datagrams;
+	uint64_t lost;
+	uint64_t blocks;
+	uint64_t partial;
+	uint64_t invalid;
+};
+
+static void put_u16(uint8_t* p, const uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t* p, const uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+static void put_u64(uint8_t* p, const uint64_t v)
+{
+	put_u32(p, (uint32_t)(v >> 32));
+	put_u32(p + 4, (uint32_t)v);
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+	return ((uint64_t)get_u32(p) << 32) | get_u32(p + 4);
+}
+
+static void udp_pack(uint8_t* p, const udp_header_t* h)
+{
+	memset(p, 0, HACKRF_UDP_HEADER_SIZE);
+	put_u32(&p[0], HACKRF_UDP_MAGIC);
+	p[4] = HACKRF_UDP_VERSION;
+	p[5] = h->format;
+	put_u16(&p[6], HACKRF_UDP_HEADER_SIZE);
+	put_u32(&p[8], h->sequence);
+	put_u32(&p[12], h->block);
+	put_u32(&p[16], h->block_length);
+	put_u32(&p[20], h->offset);
+	put_u64(&p[24], h->sample_offset);
+	put_u64(&p[32], h->timestamp_ns);
+	put_u64(&p[40], h->freq_hz);
+	put_u32(&p[48], h->sample_rate_hz);
+}
+
+/* Returns the header size, or 0 if the datagram is not a valid one of ours. */
+static uint32_t udp_unpack(const uint8_t* p, const uint32_t length, udp_header_t* h)
+{
+	uint32_t header_size;
+
+	if ((length < HACKRF_UDP_HEADER_SIZE) || (get_u32(&p[0]) != HACKRF_UDP_MAGIC)
+			|| (p[4] != HACKRF_UDP_VERSION) || (p[5] != HACKRF_UDP_FORMAT_CS8))
+	{
+		return 0;
+	}
+	header_size = get_u16(&p[6]);
+	if ((header_size < HACKRF_UDP_HEADER_SIZE) || (header_size > length))
+	{
+		return 0;
+	}
+	h->format = p[5];
+	h->sequence = get_u32(&p[8]);
+	h->block = get_u32(&p[12]);
+	h->block_length = get_u32(&p[16]);
+	h->offset = get_u32(&p[20]);
+	h->sample_offset = get_u64(&p[24]);
+	h->timestamp_ns = get_u64(&p[32]);
+	h->freq_hz = get_u64(&p[40]);
+	h->sample_rate_hz = get_u32(&p[48]);
+	if ((h->block_length > HACKRF_UDP_MAX_BLOCK) || (h->offset > h->block_length)
+			|| ((length - header_size) > (h->block_length - h->offset)))
+	{
+		return 0;
+	}
+	return header_size;
+}
+
+static uint64_t udp_time_ns(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000;
+}
+
+static bool udp_address(const char* address, const uint16_t port, struct sockaddr_in* addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(port);
+	if (address == NULL)
+	{
+		addr->sin_addr.s_addr = htonl(INADDR_ANY);
+		return true;
+	}
+	return inet_pton(AF_INET, address, &addr->sin_addr) == 1;
+}
+
+int ADDCALL hackrf_udp_sender_create(hackrf_udp_sender** sender,
+		const char* address, const uint16_t port, const char* interface_address,
+		const uint32_t payload_size, const uint32_t ttl)
+{
+	hackrf_udp_sender* s;
+	struct in_addr local;
+	const int buffer_size = UDP_SOCKET_BUFFER;
+	const unsigned char loop = 1;
+	const unsigned char hops = (unsigned char)((ttl > 255) ? 255 : ttl);
+	uint32_t i;
+
+	if ((sender == NULL) || (address == NULL) || (payload_size > HACKRF_UDP_MAX_PAYLOAD)
+			|| ((payload_size & 1) != 0))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	s = (hackrf_udp_sender*)calloc(1, sizeof(*s));
+	if (s == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	s->payload_size = (payload_size != 0) ? payload_size : HACKRF_UDP_DEFAULT_PAYLOAD;
+	if (!udp_address(address, port, &s->destination)
+			|| ((interface_address != NULL) && (inet_pton(AF_INET, interface_address, &local) != 1)))
+	{
+		free(s);
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s->fd < 0)
+	{
+		free(s);
+		return HACKRF_ERROR_OTHER;
+	}
+	setsockopt(s->fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+	if (IN_MULTICAST(ntohl(s->destination.sin_addr.s_addr)))
+	{
+		/* Loopback on, so receivers on this host (and tests) see the group. */
+		setsockopt(s->fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+		setsockopt(s->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+		if ((interface_address != NULL)
+				&& (setsockopt(s->fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) != 0))
+		{
+			close(s->fd);
+			free(s);
+			return HACKRF_ERROR_INVALID_PARAM;
+		}
+	}
+
+	/* The message array is fixed; only lengths and payload pointers change
+	   per block. */
+	for (i = 0; i < UDP_BATCH; i++)
+	{
+#ifdef __linux__
+		struct msghdr* const msg = &s->msgs[i].msg_hdr;
+#else
+		struct msghdr* const msg = &s->msgs[i];
+#endif
+		s->iov[i][0].iov_base = s->headers[i];
+		s->iov[i][0].iov_len = HACKRF_UDP_HEADER_SIZE;
+		msg->msg_name = &s->destination;
+		msg->msg_namelen = sizeof(s->destination);
+		msg->msg_iov = s->iov[i];
+		msg->msg_iovlen = 2;
+	}
+
+	*sender = s;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_udp_sender_destroy(hackrf_udp_sender* sender)
+{
+	if (sender == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	close(sender->fd);
+	free(sender);
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_udp_sender_set_metadata(hackrf_udp_sender* sender,
+		const hackrf_capture_metadata* metadata)
+{
+	if ((sender == NULL) || (metadata == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	sender->freq_hz = metadata->freq_hz;
+	sender->sample_rate_hz = metadata->sample_rate_hz;
+	return HACKRF_SUCCESS;
+}
+
+/* Send msgs[0, count), retrying partial batches. Returns datagrams sent. */
+static uint32_t udp_send_batch(hackrf_udp_sender* s, const uint32_t count)
+{
+	uint32_t sent = 0;
+	int n;
+
+	while (sent < count)
+	{
+#ifdef __linux__
+		n = sendmmsg(s->fd, &s->msgs[sent], count - sent, 0);
+#else
+		n = (sendmsg(s->fd, &s->msgs[sent], 0) < 0) ? -1 : 1;
+#endif
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			/* Drop the rest of the batch; the sequence gap tells receivers. */
+			s->errors += count - sent;
+			break;
+		}
+		sent += (uint32_t)n;
+	}
+	return sent;
+}
+
+int ADDCALL hackrf_udp_sender_write(hackrf_udp_sender* sender,
+		const int8_t* samples, const uint32_t length)
+{
+	hackrf_udp_sender* const s = sender;
+	udp_header_t header;
+	uint32_t offset = 0;
+	uint32_t count, sent, chunk, i;
+
+	if ((s == NULL) || (samples == NULL) || (length > HACKRF_UDP_MAX_BLOCK))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	header.format = HACKRF_UDP_FORMAT_CS8;
+	header.block = s->block;
+	header.block_length = length;
+	header.sample_offset = s->sample_offset;
+	header.timestamp_ns = udp_time_ns();
+	header.freq_hz = s->freq_hz;
+	header.sample_rate_hz = s->sample_rate_hz;
+
+	while (offset < length)
+	{
+		for (count = 0; (count < UDP_BATCH) && (offset < length); count++)
+		{
+			chunk = length - offset;
+			if (chunk > s->payload_size)
+			{
+				chunk = s->payload_size;
+			}
+			header.sequence = s->sequence + count;
+			header.offset = offset;
+			udp_pack(s->headers[count], &header);
+			s->iov[count][1].iov_base = (void*)&samples[offset];
+			s->iov[count][1].iov_len = chunk;
+			offset += chunk;
+		}
+		/* Lost datagrams still consume sequence numbers. */
+		sent = udp_send_batch(s, count);
+		s->sequence += count;
+		s->datagrams += sent;
+		for (i = 0; i < sent; i++)
+		{
+			s->bytes += s->iov[i][1].iov_len;
+		}
+	}
+
+	s->block++;
+	s->sample_offset += length / 2;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_udp_sender_rx_callback(hackrf_transfer* transfer)
+{
+	hackrf_udp_sender* const s = (hackrf_udp_sender*)transfer->rx_ctx;
+	if (hackrf_udp_sender_write(s, (const int8_t*)transfer->buffer,
+			transfer->valid_length) != HACKRF_SUCCESS)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int ADDCALL hackrf_udp_sender_stats(hackrf_udp_sender* sender,
+		uint64_t* datagrams, uint64_t* bytes, uint64_t* errors)
+{
+	if (sender == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (datagrams != NULL)
+	{
+		*datagrams = sender->datagrams;
+	}
+	if (bytes != NULL)
+	{
+		*bytes = sender->bytes;
+	}
+	if (errors != NULL)
+	{
+		*errors = sender->errors;
+	}
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_udp_receiver_open(hackrf_udp_receiver** receiver,
+		const char* address, const uint16_t port, const char* interface_address)
+{
+	hackrf_udp_receiver* r;
+	struct sockaddr_in group, local;
+	struct ip_mreq mreq;
+	const int buffer_size = UDP_SOCKET_BUFFER;
+	const int reuse = 1;
+	bool multicast;
+
+	if ((receiver == NULL) || !udp_address(address, port, &group))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.imr_multiaddr = group.sin_addr;
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	if ((interface_address != NULL)
+			&& (inet_pton(AF_INET, interface_address, &mreq.imr_interface) != 1))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	multicast = IN_MULTICAST(ntohl(group.sin_addr.s_addr));
+
+	r = (hackrf_udp_receiver*)calloc(1, sizeof(*r));
+	if (r == NULL)
+	{
+		return HACKRF_ERROR_NO_MEM;
+	}
+	r->batch = (uint8_t*)malloc(UDP_BATCH * UDP_MAX_DATAGRAM);
+	if (r->batch == NULL)
+	{
+		free(r);
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	r->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (r->fd < 0)
+	{
+		free(r->batch);
+		free(r);
+		return HACKRF_ERROR_OTHER;
+	}
+	setsockopt(r->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	setsockopt(r->fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+	/* A multicast receiver binds the group itself so it only sees that
+	   group's traffic on the port. */
+	udp_address(NULL, port, &local);
+	if (multicast)
+	{
+		local.sin_addr = group.sin_addr;
+	}
+	if ((bind(r->fd, (struct sockaddr*)&local, sizeof(local)) != 0)
+			|| (multicast && (setsockopt(r->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+					&mreq, sizeof(mreq)) != 0)))
+	{
+		close(r->fd);
+		free(r->batch);
+		free(r);
+		return HACKRF_ERROR_OTHER;
+	}
+
+	*receiver = r;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_udp_receiver_close(hackrf_udp_receiver* receiver)
+{
+	if (receiver == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	close(receiver->fd);
+	free(receiver->batch);
+	free(receiver->buffer);
+	free(receiver);
+	return HACKRF_SUCCESS;
+}
+
+/* Fill the batch with whatever is queued, without blocking. */
+static int udp_receive_batch(hackrf_udp_receiver* r)
+{
+	uint32_t i;
+	int n;
+#ifdef __linux__
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < UDP_BATCH; i++)
+	{
+		iov[i].iov_base = &r->batch[i * UDP_MAX_DATAGRAM];
+		iov[i].iov_len = UDP_MAX_DATAGRAM;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	n = recvmmsg(r->fd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+	for (i = 0; (n > 0) && (i < (uint32_t)n); i++)
+	{
+		r->lengths[i] = msgs[i].msg_len;
+	}
+#else
+	ssize_t length;
+
+	for (n = 0; n < UDP_BATCH; n++)
+	{
+		length = recv(r->fd, &r->batch[n * UDP_MAX_DATAGRAM], UDP_MAX_DATAGRAM, MSG_DONTWAIT);
+		if (length < 0)
+		{
+			break;
+		}
+		r->lengths[n] = (uint32_t)length;
+	}
+	if (n == 0)
+	{
+		n = -1;
+	}
+#endif
+	if (n < 0)
+	{
+		return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+				? HACKRF_ERROR_NOT_FOUND : HACKRF_ERROR_OTHER;
+	}
+	r->count = (uint32_t)n;
+	r->cursor = 0;
+	return HACKRF_SUCCESS;
+}
+
+static void udp_emit(hackrf_udp_receiver* r, hackrf_udp_block* block)
+{
+	block->samples = (const int8_t*)r->buffer;
+	block->length = r->current.block_length;
+	block->block = r->current.block;
+	block->missing = r->current.block_length - r->received;
+	block->format = r->current.format;
+	block->sample_offset = r->current.sample_offset;
+	block->timestamp_ns = r->current.timestamp_ns;
+	block->freq_hz = r->current.freq_hz;
+	block->sample_rate_hz = r->current.sample_rate_hz;
+	r->pending = false;
+	r->blocks++;
+	if (block->missing != 0)
+	{
+		r->partial++;
+	}
+}
+
+int ADDCALL hackrf_udp_receiver_read(hackrf_udp_receiver* receiver,
+		hackrf_udp_block* block, const uint32_t timeout_ms)
+{
+	hackrf_udp_receiver* const r = receiver;
+	struct pollfd pfd;
+	udp_header_t header;
+	const uint8_t* datagram;
+	uint32_t header_size, payload;
+	int32_t gap;
+	int result;
+
+	if ((r == NULL) || (block == NULL))
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	for (;;)
+	{
+		if (r->cursor == r->count)
+		{
+			result = udp_receive_batch(r);
+			if (result == HACKRF_ERROR_NOT_FOUND)
+			{
+				pfd.fd = r->fd;
+				pfd.events = POLLIN;
+				if (poll(&pfd, 1, (int)timeout_ms) > 0)
+				{
+					continue;
+				}
+				/* Quiet: hand out what we have rather than hold it. */
+				if (r->pending)
+				{
+					udp_emit(r, block);
+					return HACKRF_SUCCESS;
+				}
+				return HACKRF_ERROR_NOT_FOUND;
+			}
+			if (result != HACKRF_SUCCESS)
+			{
+				return result;
+			}
+		}
+
+		datagram = &r->batch[r->cursor * UDP_MAX_DATAGRAM];
+		header_size = udp_unpack(datagram, r->lengths[r->cursor], &header);
+		if (header_size == 0)
+		{
+			r->invalid++;
+			r->cursor++;
+			continue;
+		}
+
+		if (!r->have_sequence)
+		{
+			r->have_sequence = true;
+			r->expected = header.sequence;
+		}
+		gap = (int32_t)(header.sequence - r->expected);
+		if (gap < -UDP_RESYNC_GAP)
+		{
+			/* Start over from the restarted sender; a block in progress
+			   belongs to the old stream and is handed out as it is. */
+			r->expected = header.sequence;
+			if (r->pending)
+			{
+				udp_emit(r, block);
+				return HACKRF_SUCCESS;
+			}
+			gap = 0;
+		}
+		else if (gap < 0)
+		{
+			/* Duplicate or reordered past a block we already handed out. */
+			r->invalid++;
+			r->cursor++;
+			continue;
+		}
+		r->lost += (uint32_t)gap;
+		r->expected = header.sequence + 1;
+
+		/* A new block closes the current one; this datagram is kept for
+		   the next call. */
+		if (r->pending && (header.block != r->current.block))
+		{
+			r->expected = header.sequence;
+			udp_emit(r, block);
+			return HACKRF_SUCCESS;
+		}
+
+		if (!r->pending)
+		{
+			if (header.block_length > r->capacity)
+			{
+				uint8_t* buffer = (uint8_t*)realloc(r->buffer, header.block_length);
+				if (buffer == NULL)
+				{
+					return HACKRF_ERROR_NO_MEM;
+				}
+				r->buffer = buffer;
+				r->capacity = header.block_length;
+			}
+			memset(r->buffer, 0, header.block_length);
+			r->current = header;
+			r->received = 0;
+			r->pending = true;
+		}
+
+		payload = r->lengths[r->cursor] - header_size;
+		/* udp_unpack() only checks the datagram against its own header. */
+		if ((header.block_length != r->current.block_length)
+				|| (header.offset + payload > r->current.block_length))
+		{
+			r->invalid++;
+			r->cursor++;
+			continue;
+		}
+		memcpy(&r->buffer[header.offset], &datagram[header_size], payload);
+		r->received += payload;
+		r->datagrams++;
+		r->cursor++;
+
+		if (r->received >= r->current.block_length)
+		{
+			udp_emit(r, block);
+			return HACKRF_SUCCESS;
+		}
+	}
+}
+
+int ADDCALL hackrf_udp_receiver_stats(hackrf_udp_receiver* receiver,
+		uint64_t* datagrams, uint64_t* lost, uint64_t* blocks, uint64_t* partial,
+		uint64_t* invalid)
+{
+	if (receiver == NULL)
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+	if (datagrams != NULL)
+	{
+		*datagrams = receiver->datagrams;
+	}
+	if (lost != NULL)
+	{
+		*lost = receiver->lost;
+	}
+	if (blocks != NULL)
+	{
+		*blocks = receiver->blocks;
+	}
+	if (partial != NULL)
+	{
+		*partial = receiver->partial;
+	}
+	if (invalid != NULL)
+	{
+		*invalid = receiver->invalid;
+	}
+	return HACKRF_SUCCESS;
+}
+
+#else /* _WIN32 */
+
+int ADDCALL hackrf_udp_sender_create(hackrf_udp_sender** sender,
+		const char* address, const uint16_t port, const char* interface_address,
+		const uint32_t payload_size, const uint32_t ttl)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_sender_destroy(hackrf_udp_sender* sender)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_sender_set_metadata(hackrf_udp_sender* sender,
+		const hackrf_capture_metadata* metadata)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_sender_write(hackrf_udp_sender* sender,
+		const int8_t* samples, const uint32_t length)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_sender_rx_callback(hackrf_transfer* transfer)
+{
+	return -1;
+}
+
+int ADDCALL hackrf_udp_sender_stats(hackrf_udp_sender* sender,
+		uint64_t* datagrams, uint64_t* bytes, uint64_t* errors)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_receiver_open(hackrf_udp_receiver** receiver,
+		const char* address, const uint16_t port, const char* interface_address)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_receiver_close(hackrf_udp_receiver* receiver)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_receiver_read(hackrf_udp_receiver* receiver,
+		hackrf_udp_block* block, const uint32_t timeout_ms)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+int ADDCALL hackrf_udp_receiver_stats(hackrf_udp_receiver* receiver,
+		uint64_t* datagrams, uint64_t* lost, uint64_t* blocks, uint64_t* partial,
+		uint64_t* invalid)
+{
+	return HACKRF_ERROR_OTHER;
+}
+
+#endif /* _WIN32 */
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
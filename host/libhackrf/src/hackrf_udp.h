@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2014, Great Scott Gadgets
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __HACKRF_UDP_H__
+#define __HACKRF_UDP_H__
+
+#include <stdint.h>
+
+#include "hackrf.h"
+#include "hackrf_capture.h"
+
+/*
+ * RX streaming over UDP, typically to a multicast group so that any number
+ * of processing nodes receive one radio's output without per client
+ * connections.
+ *
+ * Each block (normally one USB transfer) is split into datagrams of at
+ * most payload_size bytes, each led by a HACKRF_UDP_HEADER_SIZE byte
+ * header, big endian:
+ *
+ *   0  magic "HRFU"         24 sample_offset of the block (u64)
+ *   4  version (u8)         32 timestamp_ns of the block, host clock (u64)
+ *   5  format (u8)          40 freq_hz (u64)
+ *   6  header_size (u16)    48 sample_rate_hz (u32)
+ *   8  sequence (u32)       52 reserved
+ *  12  block (u32)
+ *  16  block_length (u32)
+ *  20  offset in block (u32)
+ *
+ * The sequence counts datagrams, so a receiver knows exactly how many were
+ * lost. The default payload fits a 9000 byte jumbo frame; use 1400 or less
+ * on a standard 1500 byte MTU. Datagrams are sent in batches with
+ * sendmmsg() where available.
+ *
+ * Not available on Windows; every call returns HACKRF_ERROR_OTHER there.
+ */
+
+#define HACKRF_UDP_MAGIC (0x48524655) /* "HRFU" */
+#define HACKRF_UDP_VERSION (1)
+#define HACKRF_UDP_HEADER_SIZE (56)
+#define HACKRF_UDP_DEFAULT_PAYLOAD (8192)
+#define HACKRF_UDP_MAX_PAYLOAD (9216 - HACKRF_UDP_HEADER_SIZE)
+#define HACKRF_UDP_MAX_BLOCK (1048576)
+
+enum hackrf_udp_format {
+	HACKRF_UDP_FORMAT_CS8 = 1, /* interleaved signed 8 bit I/Q */
+};
+
+typedef struct hackrf_udp_sender hackrf_udp_sender;
+typedef struct hackrf_udp_receiver hackrf_udp_receiver;
+
+typedef struct {
+	const int8_t* samples; /* receiver owned, valid until the next read */
+	uint32_t length;
+	uint32_t block;
+	uint32_t missing;       /* bytes lost in transit, zero filled */
+	uint8_t format;
+	uint64_t sample_offset;
+	uint64_t timestamp_ns;
+	uint64_t freq_hz;
+	uint32_t sample_rate_hz;
+} hackrf_udp_block;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* address: dotted IPv4 destination, unicast or multicast.
+   interface_address: local address of the interface to send multicast on,
+   NULL for the default route.
+   payload_size: sample bytes per datagram, 0 selects the default.
+   ttl: multicast hop limit, 1 keeps the stream on the local subnet. */
+extern ADDAPI int ADDCALL hackrf_udp_sender_create(hackrf_udp_sender** sender,
+		const char* address, const uint16_t port, const char* interface_address,
+		const uint32_t payload_size, const uint32_t ttl);
+extern ADDAPI int ADDCALL hackrf_udp_sender_destroy(hackrf_udp_sender* sender);
+
+/* Frequency and sample rate carried in every header; other fields ignored. */
+extern ADDAPI int ADDCALL hackrf_udp_sender_set_metadata(hackrf_udp_sender* sender,
+		const hackrf_capture_metadata* metadata);
+
+/* Network errors are counted rather than returned, so a congested link
+   never stops the radio. */
+extern ADDAPI int ADDCALL hackrf_udp_sender_write(hackrf_udp_sender* sender,
+		const int8_t* samples, const uint32_t length);
+
+/* hackrf_sample_block_cb_fn to pass to hackrf_start_rx() with the sender
+   as rx_ctx. */
+extern ADDAPI int ADDCALL hackrf_udp_sender_rx_callback(hackrf_transfer* transfer);
+
+extern ADDAPI int ADDCALL hackrf_udp_sender_stats(hackrf_udp_sender* sender,
+		uint64_t* datagrams, uint64_t* bytes, uint64_t* errors);
+
+/* Listen on port; joins address if it is a multicast group, on
+   interface_address as for the sender. Several receivers on one host may
+   share a group. */
+extern ADDAPI int ADDCALL hackrf_udp_receiver_open(hackrf_udp_receiver** receiver,
+		const char* address, const uint16_t port, const char* interface_address);
+extern ADDAPI int ADDCALL hackrf_udp_receiver_close(hackrf_udp_receiver* receiver);
+
+/* Wait up to timeout_ms for the next reassembled block. A block is handed
+   out once complete, or with block->missing set once a later block starts
+   or the stream goes quiet for timeout_ms. Returns HACKRF_ERROR_NOT_FOUND
+   on timeout with nothing pending. */
+extern ADDAPI int ADDCALL hackrf_udp_receiver_read(hackrf_udp_receiver* receiver,
+		hackrf_udp_block* block, const uint32_t timeout_ms);
+
+/* lost: datagrams missing from the sequence. partial: blocks handed out
+   with missing bytes. invalid: datagrams that were not ours or arrived out
+   of order. */
+extern ADDAPI int ADDCALL hackrf_udp_receiver_stats(hackrf_udp_receiver* receiver,
+		uint64_t* datagrams, uint64_t* lost, uint64_t* blocks, uint64_t* partial,
+		uint64_t* invalid);
+
+#ifdef __cplusplus
+} // __cplusplus defined.
+#endif
+
+#endif//__HACKRF_UDP_H__